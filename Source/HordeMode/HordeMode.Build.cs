@@ -8,6 +8,19 @@ public class HordeMode : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "NavigationSystem" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "NavigationSystem", "AIModule", "ReplicationGraph" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "RenderCore" });
+
+		// Push model replication was added in 4.25 (Net/HMPushModel.h)
+		if (Target.Version.MajorVersion > 4 || Target.Version.MinorVersion >= 25)
+		{
+			PublicDependencyModuleNames.Add("NetCore");
+			PublicDefinitions.Add("HM_WITH_PUSH_MODEL=1");
+		}
+		else
+		{
+			PublicDefinitions.Add("HM_WITH_PUSH_MODEL=0");
+		}
 	}
 }
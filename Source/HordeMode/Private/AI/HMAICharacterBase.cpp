@@ -2,8 +2,228 @@
 
 
 #include "AI/HMAICharacterBase.h"
+#include "Subsystems/HMCorpseSubsystem.h"
+#include "Subsystems/HMMeleeSubsystem.h"
+#include "Subsystems/HMPerceptionSubsystem.h"
+#include "Subsystems/HMSignificanceSubsystem.h"
+#include "Subsystems/HMZombiePoolSubsystem.h"
+
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Net/UnrealNetwork.h"
 
 AHMAICharacterBase::AHMAICharacterBase(const class FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer)
+	: Super(ObjectInitializer), m_bPooled(false), m_MeshRelativeTransform(FTransform::Identity), m_MeshCollision(ECollisionEnabled::QueryAndPhysics), m_CapsuleCollision(ECollisionEnabled::QueryAndPhysics),
+	m_PoolState(1), m_PerceptionSlot(INDEX_NONE), m_MeleeDamage(20.0f), m_MeleeRange(150.0f), m_MeleeHalfAngle(60.0f), m_MeleeCooldown(1.5f), m_MeleeWindup(0.4f), m_MeleeWindow(0.2f), m_MeleeAttackAnim(nullptr)
+{
+	m_TeamType = ETeamType::Enemy;
+}
+
+void AHMAICharacterBase::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AHMAICharacterBase, m_PoolState);
+}
+
+void AHMAICharacterBase::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (const USkeletalMeshComponent* const SkelComp = GetMesh())
+	{
+		m_MeshRelativeTransform = SkelComp->GetRelativeTransform();
+		m_MeshCollision = SkelComp->GetCollisionEnabled();
+	}
+
+	if (const UCapsuleComponent* const Comp = GetCapsuleComponent())
+	{
+		m_CapsuleCollision = Comp->GetCollisionEnabled();
+	}
+
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		if (UHMSignificanceSubsystem* const Significance = GetWorld()->GetSubsystem<UHMSignificanceSubsystem>())
+		{
+			Significance->RegisterCharacter(this);
+		}
+
+		if (UHMMeleeSubsystem* const Melee = GetWorld()->GetSubsystem<UHMMeleeSubsystem>())
+		{
+			Melee->RegisterAttacker(this);
+		}
+
+		if (UHMPerceptionSubsystem* const Perception = GetWorld()->GetSubsystem<UHMPerceptionSubsystem>())
+		{
+			m_PerceptionSlot = Perception->RegisterZombie(this);
+		}
+	}
+}
+
+void AHMAICharacterBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		if (UHMSignificanceSubsystem* const Significance = GetWorld()->GetSubsystem<UHMSignificanceSubsystem>())
+		{
+			Significance->UnregisterCharacter(this);
+		}
+
+		if (UHMMeleeSubsystem* const Melee = GetWorld()->GetSubsystem<UHMMeleeSubsystem>())
+		{
+			Melee->UnregisterAttacker(this);
+		}
+	}
+
+	if (m_PerceptionSlot != INDEX_NONE)
+	{
+		if (UHMPerceptionSubsystem* const Perception = GetWorld()->GetSubsystem<UHMPerceptionSubsystem>())
+		{
+			Perception->UnregisterZombie(m_PerceptionSlot);
+		}
+
+		m_PerceptionSlot = INDEX_NONE;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AHMAICharacterBase::OnDied()
+{
+	if (m_bPooled)
+	{
+		if (UHMZombiePoolSubsystem* const ZombiePool = GetWorld()->GetSubsystem<UHMZombiePoolSubsystem>())
+		{
+			// The corpse stays until the pool takes it back
+			ZombiePool->OnZombieDied(this);
+			return;
+		}
+	}
+
+	Super::OnDied();
+}
+
+void AHMAICharacterBase::DeactivateForPool()
+{
+	if (AAIController* const AIController = Cast<AAIController>(GetController()))
+	{
+		AIController->StopMovement();
+
+		if (UBrainComponent* const Brain = AIController->GetBrainComponent())
+		{
+			Brain->PauseLogic(TEXT("Pooled"));
+		}
+	}
+
+	m_PoolState &= ~1;
+	ApplyPoolState(false);
+}
+
+bool AHMAICharacterBase::ActivateFromPool(const FTransform& Transform)
+{
+	// Same as spawning with AdjustIfPossibleButDontSpawnIfColliding
+	FVector Location = Transform.GetLocation();
+	FRotator Rotation = Transform.Rotator();
+	if (!GetWorld()->FindTeleportSpot(this, Location, Rotation))
+	{
+		return false;
+	}
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+
+	SetHealth(GetDefaultHealth());
+
+	m_PoolState = ((m_PoolState + 2) & ~1) | 1;
+	ApplyPoolState(false);
+	ApplyPoolState(true);
+
+	if (AAIController* const AIController = Cast<AAIController>(GetController()))
+	{
+		if (UBrainComponent* const Brain = AIController->GetBrainComponent())
+		{
+			Brain->ResumeLogic(TEXT("Pooled"));
+		}
+	}
+
+	ForceNetUpdate();
+
+	return true;
+}
+
+void AHMAICharacterBase::Multi_PlayMeleeAttack_Implementation()
 {
-}
\ No newline at end of file
+	// Nobody sees the anim on a dedicated server, the hit doesn't depend on it
+	if (GetNetMode() != NM_DedicatedServer && m_MeleeAttackAnim != nullptr)
+	{
+		PlayAnimMontage(m_MeleeAttackAnim);
+	}
+}
+
+void AHMAICharacterBase::OnRep_PoolState()
+{
+	// Always undo the ragdoll, the zombie might have died and been reactivated since the last update
+	ApplyPoolState(false);
+
+	if (m_PoolState & 1)
+	{
+		ApplyPoolState(true);
+	}
+}
+
+void AHMAICharacterBase::ApplyPoolState(bool bActive)
+{
+	if (!bActive)
+	{
+		if (UHMCorpseSubsystem* const Corpses = GetWorld()->GetSubsystem<UHMCorpseSubsystem>())
+		{
+			Corpses->RemoveCharacter(this);
+		}
+	}
+
+	SetActorHiddenInGame(!bActive);
+	SetActorEnableCollision(bActive);
+	SetActorTickEnabled(bActive);
+
+	// Undo the ragdoll
+	if (USkeletalMeshComponent* const SkelComp = GetMesh())
+	{
+		if (!bActive)
+		{
+			SkelComp->bNoSkeletonUpdate = false;
+			SkelComp->SetSimulatePhysics(false);
+			SkelComp->SetAllBodiesSimulatePhysics(false);
+			SkelComp->bBlendPhysics = false;
+			SkelComp->AttachToComponent(GetCapsuleComponent(), FAttachmentTransformRules::KeepWorldTransform);
+			SkelComp->SetRelativeTransform(m_MeshRelativeTransform);
+			SkelComp->SetCollisionEnabled(m_MeshCollision);
+			StopAnimMontage();
+		}
+
+		SkelComp->SetComponentTickEnabled(bActive);
+	}
+
+	if (UCapsuleComponent* const Comp = GetCapsuleComponent())
+	{
+		Comp->SetCollisionEnabled(m_CapsuleCollision);
+	}
+
+	UCharacterMovementComponent* CharacterComp = Cast<UCharacterMovementComponent>(GetMovementComponent());
+	if (CharacterComp)
+	{
+		CharacterComp->StopMovementImmediately();
+
+		if (bActive)
+		{
+			CharacterComp->SetDefaultMovementMode();
+		}
+		else
+		{
+			CharacterComp->DisableMovement();
+		}
+
+		CharacterComp->SetComponentTickEnabled(bActive);
+	}
+}
@@ -2,9 +2,63 @@
 
 
 #include "AI/HMAIController.h"
+#include "AI/HMAICharacterBase.h"
+#include "Subsystems/HMFlowFieldSubsystem.h"
+#include "Subsystems/HMPerceptionSubsystem.h"
 
 AHMAIController::AHMAIController(const class FObjectInitializer& ObjectInitializer) :
-	Super(ObjectInitializer)
+	Super(ObjectInitializer), m_bUseFlowField(true)
 {
-	bWantsPlayerState = true;
+	// Zombies don't need a player state - it would be replicated to every connection and keep the controller alive after
+	// its pawn is destroyed (AController::PawnPendingDestroy only destroys controllers without one)
+	bWantsPlayerState = false;
+
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AHMAIController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	APawn* const ControlledPawn = GetPawn();
+	if (!m_bUseFlowField || ControlledPawn == nullptr)
+	{
+		return;
+	}
+
+	const AHMCharacterBase* const Character = Cast<AHMCharacterBase>(ControlledPawn);
+	if (Character != nullptr && Character->IsDead())
+	{
+		return;
+	}
+
+	UHMFlowFieldSubsystem* const FlowField = GetWorld()->GetSubsystem<UHMFlowFieldSubsystem>();
+	if (FlowField == nullptr)
+	{
+		return;
+	}
+
+	FVector Direction;
+	APawn* Target = nullptr;
+	if (FlowField->GetSteeringDirection(ControlledPawn->GetActorLocation(), Direction, Target))
+	{
+		ControlledPawn->AddMovementInput(Direction);
+
+		// Face the player the zombie saw, the flow field only knows the closest one by path
+		const AHMAICharacterBase* const Zombie = Cast<AHMAICharacterBase>(ControlledPawn);
+		const UHMPerceptionSubsystem* const Perception = GetWorld()->GetSubsystem<UHMPerceptionSubsystem>();
+		if (Zombie != nullptr && Perception != nullptr)
+		{
+			if (APawn* const PerceivedTarget = Perception->GetTarget(Zombie->GetPerceptionSlot()))
+			{
+				Target = PerceivedTarget;
+			}
+		}
+
+		if (m_FlowFieldTarget != Target)
+		{
+			m_FlowFieldTarget = Target;
+			SetFocus(Target);
+		}
+	}
 }
@@ -2,16 +2,21 @@
 
 
 #include "Actors/HMDoorActor.h"
+#include "Net/HMPushModel.h"
 #include "HordeMode.h"
 
 #include "Player/HMPlayerCharacter.h"
 #include "Player/HMPlayerState.h"
+#include "Subsystems/HMCurrencyLedgerSubsystem.h"
 
 AHMDoorActor::AHMDoorActor() : m_Cost(1000)
 {
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 
 	SetReplicates(true);
+
+	// Nothing to send until someone pays towards the door
+	NetDormancy = DORM_Initial;
 }
 
 void AHMDoorActor::BeginPlay()
@@ -19,16 +24,11 @@ void AHMDoorActor::BeginPlay()
 	Super::BeginPlay();
 }
 
-void AHMDoorActor::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-}
-
 void AHMDoorActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(AHMDoorActor, m_Cost);
+	HM_DOREPLIFETIME_PUSH(AHMDoorActor, m_Cost);
 }
 
 void AHMDoorActor::Interact_Implementation(AHMPlayerCharacter* Player)
@@ -38,15 +38,18 @@ void AHMDoorActor::Interact_Implementation(AHMPlayerCharacter* Player)
 		return;
 	}
 
-	if (AHMPlayerState* const PS = Cast<AHMPlayerState>(Player->GetPlayerState()))
+	AHMPlayerState* const PS = Cast<AHMPlayerState>(Player->GetPlayerState());
+	UHMCurrencyLedgerSubsystem* const Ledger = GetWorld()->GetSubsystem<UHMCurrencyLedgerSubsystem>();
+	if (PS != nullptr && Ledger != nullptr)
 	{
-		int32 CostPaid = FMath::Clamp(PS->GetCurrency(), 0, m_Cost);
+		// Checks what the player can afford and takes it in one go, nothing else can spend the same currency in between
+		const int32 CostPaid = Ledger->Spend(PS, m_Cost);
 
 		if (CostPaid > 0)
 		{
-			PS->SetCurrency(PS->GetCurrency() - CostPaid);
-
 			m_Cost -= CostPaid;
+			HM_MARK_PROPERTY_DIRTY(AHMDoorActor, m_Cost, this);
+			FlushNetDormancy();
 
 			m_OnDoorPayToward.Broadcast(PS, CostPaid);
 		}
@@ -3,6 +3,10 @@
 #include "Base/HMCharacterBase.h"
 #include "Base/HMGameModeBase.h"
 #include "Player/HMPlayerState.h"
+#include "Subsystems/HMCorpseSubsystem.h"
+#include "Subsystems/HMLagCompensationSubsystem.h"
+#include "Subsystems/HMSpatialHashSubsystem.h"
+#include "Net/HMPushModel.h"
 #include "Net/UnrealNetwork.h"
 #include "HordeMode.h"
 
@@ -11,7 +15,7 @@
 #include "GameFramework/CharacterMovementComponent.h"
 
 AHMCharacterBase::AHMCharacterBase(const class FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer), m_Health(100.0f), m_MaxHealth(100.0f)
+	: Super(ObjectInitializer), m_Health(100.0f), m_MaxHealth(100.0f), m_TeamType(ETeamType::Player), m_LagCompensationSlot(INDEX_NONE)
 {
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -22,7 +26,7 @@ void AHMCharacterBase::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(AHMCharacterBase, m_Health);
+	HM_DOREPLIFETIME_PUSH(AHMCharacterBase, m_Health);
 }
 
 float AHMCharacterBase::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
@@ -36,7 +40,7 @@ float AHMCharacterBase::TakeDamage(float Damage, struct FDamageEvent const& Dama
 
 	if (ActualDamage > 0.0f)
 	{
-		m_Health -= ActualDamage;
+		SetHealth(m_Health - ActualDamage);
 
 		if (IsDead())
 		{
@@ -47,6 +51,12 @@ float AHMCharacterBase::TakeDamage(float Damage, struct FDamageEvent const& Dama
 	return ActualDamage;
 }
 
+void AHMCharacterBase::SetHealth(float NewHealth)
+{
+	m_Health = NewHealth;
+	HM_MARK_PROPERTY_DIRTY(AHMCharacterBase, m_Health, this);
+}
+
 void AHMCharacterBase::Die(float Damage, AController* EventInstigator, AActor* DamageCauser)
 {
 	// No clue why this was called while the character is alive so lets just return
@@ -55,8 +65,8 @@ void AHMCharacterBase::Die(float Damage, AController* EventInstigator, AActor* D
 		return;
 	}
 
-	AHMPlayerState* const KillerPS = Cast<AHMPlayerState>(EventInstigator->PlayerState);
-	AHMPlayerState* const VictimPS = Cast<AHMPlayerState>(Controller->PlayerState);
+	AHMPlayerState* const KillerPS = EventInstigator ? Cast<AHMPlayerState>(EventInstigator->PlayerState) : nullptr;
+	AHMPlayerState* const VictimPS = Controller ? Cast<AHMPlayerState>(Controller->PlayerState) : nullptr;
 	if (KillerPS && VictimPS)
 	{
 		if (!AHMPlayerState::IsFriendly(KillerPS, VictimPS))
@@ -65,23 +75,59 @@ void AHMCharacterBase::Die(float Damage, AController* EventInstigator, AActor* D
 
 			Multi_Ragdoll();
 
-			SetReplicateMovement(false);
-			TearOff();
+			OnDied();
+		}
+	}
+	else if (VictimPS && !IsEnemy())
+	{
+		// Players killed by something without a player state - zombies' melee, falling, the environment
+		GetWorld()->GetAuthGameMode<AHMGameModeBase>()->Killed(EventInstigator, Controller);
+
+		Multi_Ragdoll();
 
-			SetLifeSpan(90.0f);
+		OnDied();
+	}
+	else if (IsEnemy())
+	{
+		// Zombies don't have a player state
+		if (KillerPS && Controller)
+		{
+			GetWorld()->GetAuthGameMode<AHMGameModeBase>()->Killed(EventInstigator, Controller);
 		}
+
+		Multi_Ragdoll();
+
+		OnDied();
 	}
 }
 
+void AHMCharacterBase::OnDied()
+{
+	SetReplicateMovement(false);
+	TearOff();
+
+	SetLifeSpan(90.0f);
+}
+
 void AHMCharacterBase::Multi_Ragdoll_Implementation()
 {
+	// Nobody sees the ragdoll on a dedicated server
+	const bool bSimulate = GetNetMode() != NM_DedicatedServer;
+
 	if (USkeletalMeshComponent* const SkelComp = GetMesh())
 	{
-		SkelComp->SetAllBodiesSimulatePhysics(true);
-		SkelComp->SetSimulatePhysics(true);
-		SkelComp->WakeAllRigidBodies();
-		SkelComp->bBlendPhysics = true;
-		SkelComp->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
+		if (bSimulate)
+		{
+			SkelComp->SetAllBodiesSimulatePhysics(true);
+			SkelComp->SetSimulatePhysics(true);
+			SkelComp->WakeAllRigidBodies();
+			SkelComp->bBlendPhysics = true;
+			SkelComp->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
+		}
+		else
+		{
+			SkelComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		}
 	}
 
 	if (UCapsuleComponent* const Comp = GetCapsuleComponent())
@@ -96,11 +142,49 @@ void AHMCharacterBase::Multi_Ragdoll_Implementation()
 		CharacterComp->DisableMovement();
 		CharacterComp->SetComponentTickEnabled(false);
 	}
+
+	if (UHMCorpseSubsystem* const Corpses = GetWorld()->GetSubsystem<UHMCorpseSubsystem>())
+	{
+		Corpses->AddCorpse(this, bSimulate);
+	}
 }
 
 void AHMCharacterBase::BeginPlay()
 {
 	Super::BeginPlay();
+
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		if (UHMLagCompensationSubsystem* const LagCompensation = GetWorld()->GetSubsystem<UHMLagCompensationSubsystem>())
+		{
+			m_LagCompensationSlot = LagCompensation->RegisterCharacter(this);
+		}
+	}
+
+	if (UHMSpatialHashSubsystem* const SpatialHash = GetWorld()->GetSubsystem<UHMSpatialHashSubsystem>())
+	{
+		SpatialHash->RegisterCharacter(this);
+	}
+}
+
+void AHMCharacterBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UHMSpatialHashSubsystem* const SpatialHash = GetWorld()->GetSubsystem<UHMSpatialHashSubsystem>())
+	{
+		SpatialHash->UnregisterCharacter(this);
+	}
+
+	if (m_LagCompensationSlot != INDEX_NONE)
+	{
+		if (UHMLagCompensationSubsystem* const LagCompensation = GetWorld()->GetSubsystem<UHMLagCompensationSubsystem>())
+		{
+			LagCompensation->UnregisterCharacter(m_LagCompensationSlot);
+		}
+
+		m_LagCompensationSlot = INDEX_NONE;
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AHMCharacterBase::Tick(float DeltaTime)
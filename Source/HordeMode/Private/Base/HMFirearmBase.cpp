@@ -4,9 +4,16 @@
 #include "Player/HMPlayerCharacter.h"
 #include "Player/HMPlayerController.h"
 #include "Player/HMPlayerState.h"
+#include "Subsystems/HMShotQueueSubsystem.h"
+#include "Subsystems/HMFirearmRegistry.h"
+#include "Subsystems/HMEffectPoolSubsystem.h"
+#include "Subsystems/HMFireSchedulerSubsystem.h"
+#include "Subsystems/HMProjectileSubsystem.h"
+#include "Net/HMPushModel.h"
 #include "HordeMode.h"
 
 #include "Net/UnrealNetwork.h"
+#include "GameFramework/GameStateBase.h"
 #include "TimerManager.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Kismet/GameplayStatics.h"
@@ -16,7 +23,17 @@
 #include "Particles/ParticleSystemComponent.h"
 #include "Curves/CurveVector.h"
 
-AHMFirearmBase::AHMFirearmBase() : m_FirearmID("Default"), m_CurrentFireMode(EFireMode::FullAuto), m_WeaponStatus(EWeaponStatus::Idle)
+/** How far a hitscan shot is traced. */
+static const float HITSCAN_RANGE = 10000.0f;
+
+/** How far (in uu) the view point that a client fired from can be from the server's before the server's is used instead. */
+static const float MAX_SHOT_ORIGIN_ERROR = 250.0f;
+
+AHMFirearmBase::AHMFirearmBase() : m_FirearmID("Default"), m_FirearmStats(&UHMFirearmRegistry::GetDefaultStats()),
+	m_HotStats(&UHMFirearmRegistry::GetDefaultHotStats()), m_HitZones(&UHMFirearmRegistry::GetDefaultHitZones()), m_bStatsResolved(false),
+	m_CurrentFireMode(EFireMode::FullAuto), m_WeaponStatus(EWeaponStatus::Idle), m_AppliedRecoil(FVector2D::ZeroVector), m_RecoilPatternIndex(0),
+	m_LastFireTime(-BIG_NUMBER), m_NextShotEventId(0), m_LastReplayedShotEventId(MAX_uint16), m_NumNewFireInputShots(0), m_bTriggerDown(false),
+	m_TriggerSendsLeft(0), m_LastFireInputFrame(0)
 {
 	PrimaryActorTick.bCanEverTick = true;
 }
@@ -25,22 +42,56 @@ void AHMFirearmBase::BeginPlay()
 {
 	Super::BeginPlay();
 
-	m_FirearmStats = UHMHelpers::GetFirearmStats(GetWorld(), m_FirearmID);
-	m_TimeBetweenShots = 60 / m_FirearmStats.ShotsPerMinute;
-	m_CurrentAmmo = m_FirearmStats.WeaponInfo.GetDefaultAmmo();
-	m_CurrentAmmoInMag = m_FirearmStats.WeaponInfo.MagCapacity;
-	m_CurrentFireMode = m_FirearmStats.AllowedFireModes[0];
+	// On clients the game state can replicate after the firearm, Tick looks it up again until the registry is built
+	ResolveStats();
+
+	SetAmmo(m_HotStats->MagCapacity, m_HotStats->GetDefaultAmmo());
+	m_CurrentFireMode = m_HotStats->AllowedFireModes[0];
+
+	PRINT("Firearm Selected : " + m_FirearmStats->WeaponInfo.Title);
+}
+
+bool AHMFirearmBase::ResolveStats()
+{
+	UHMFirearmRegistry* const Registry = UHMFirearmRegistry::Get(this);
+	if (Registry == nullptr)
+	{
+		return false;
+	}
+
+	const FHMFirearmHandle Handle = Registry->FindFirearm(this, m_FirearmID);
+	if (!Registry->IsBuilt())
+	{
+		return false;
+	}
 
-	PRINT("Firearm Selected : " + m_FirearmStats.WeaponInfo.Title);
+	m_FirearmHandle = Handle;
+	m_FirearmStats = &Registry->GetStats(m_FirearmHandle);
+	m_HotStats = &Registry->GetHotStats(m_FirearmHandle);
+	m_HitZones = &Registry->GetHitZones();
+	m_bStatsResolved = true;
+
+	return true;
 }
 
 void AHMFirearmBase::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	if (IsFiring() && HasAmmoInMag() && m_FirearmStats.HasRecoil())
+	// The ammo replicates from the server, only the local fire mode has to follow the real stats
+	if (!m_bStatsResolved && ResolveStats() && !m_HotStats->AllowedFireModes.Contains(m_CurrentFireMode))
 	{
-		HandleRecoil();
+		m_CurrentFireMode = m_HotStats->AllowedFireModes[0];
+	}
+
+	// The release after the trigger was let go, while firing UHMFireSchedulerSubsystem flushes the input right after the shots
+	if (m_TriggerSendsLeft > 0)
+	{
+		const UHMFireSchedulerSubsystem* const FireScheduler = GetWorld()->GetSubsystem<UHMFireSchedulerSubsystem>();
+		if (FireScheduler == nullptr || !FireScheduler->IsFiring(this))
+		{
+			FlushFireInput();
+		}
 	}
 }
 
@@ -48,180 +99,593 @@ void AHMFirearmBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLi
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(AHMFirearmBase, m_HitScanTrace, COND_SkipOwner);
-	DOREPLIFETIME(AHMFirearmBase, m_WeaponStatus);
+	HM_DOREPLIFETIME_CONDITION_PUSH(AHMFirearmBase, m_ShotEvents, COND_SkipOwner);
+	HM_DOREPLIFETIME_PUSH(AHMFirearmBase, m_WeaponStatus);
 }
 
-void AHMFirearmBase::Fire()
+void AHMFirearmBase::SetWeaponStatus(EWeaponStatus NewStatus)
 {
-	if (!HasAmmoInMag() || IsReloading())
+	if (m_WeaponStatus == NewStatus)
 	{
 		return;
 	}
 
-	if (GetLocalRole() < ROLE_Authority)
+	WakeForReplication();
+
+	m_WeaponStatus = NewStatus;
+	HM_MARK_PROPERTY_DIRTY(AHMFirearmBase, m_WeaponStatus, this);
+}
+
+bool AHMFirearmBase::FireScheduledShot(float TimeSinceShot)
+{
+	FVector EyeLocation;
+	FRotator EyeRotation;
+	GetShotViewPoint(EyeLocation, EyeRotation);
+
+	return FireAlong(EyeLocation, EyeRotation.Vector(), -1.0f, TimeSinceShot);
+}
+
+bool AHMFirearmBase::FireAlong(const FVector& EyeLocation, const FVector& ShotDirection, float RewindTime, float TimeSinceShot)
+{
+	if (!HasAmmoInMag() || IsReloading())
 	{
-		Server_Fire();
+		return false;
 	}
 
-	if (m_CurrentFireMode == EFireMode::ThreeBurst && m_ShotCount == 3)
+	if (GetLocalRole() < ROLE_Authority)
 	{
-		StopFire();
-		return;
-	}
+		// Send the server time that we fired at so the server can rewind the characters to what we saw
+		const AGameStateBase* const GameState = GetWorld()->GetGameState();
+		const float FireTime = (GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds()) - TimeSinceShot;
 
-	++m_ShotCount;
+		// The shot and its ammo are predicted until the server acks its id
+		const uint16 ShotId = PredictShot();
+		if (FHMFireInput::IsBatchingEnabled())
+		{
+			QueueFireInput(ShotId, EyeLocation, ShotDirection, FireTime);
+		}
+		else
+		{
+			FHMFireInput::CountUnbatchedShot(EyeLocation);
+			Server_Fire(EyeLocation, ShotDirection, FireTime, ShotId);
+		}
+	}
 
-	m_WeaponStatus = EWeaponStatus::Firing;
+	SetWeaponStatus(EWeaponStatus::Firing);
 	if (AActor* const MyOwner = GetOwner())
 	{
-		FVector EyeLocation;
-		FRotator EyeRotation;
-		AHMPlayerCharacter* const Character = Cast<AHMPlayerCharacter>(MyOwner);
-		if (Character)
+		if (m_HotStats->HasProjectile())
+		{
+			for (int32 Pellet = 0; Pellet < m_HotStats->ShotCount; ++Pellet)
+			{
+				LaunchProjectile(EyeLocation, GetPelletDirection(ShotDirection));
+			}
+		}
+		else
+		{
+			TArray<FVector, TInlineAllocator<16>> TraceEnds;
+			for (int32 Pellet = 0; Pellet < m_HotStats->ShotCount; ++Pellet)
+			{
+				TraceEnds.Add(EyeLocation + (GetPelletDirection(ShotDirection) * HITSCAN_RANGE));
+			}
+
+			FCollisionQueryParams QueryParams;
+			QueryParams.AddIgnoredActor(MyOwner);
+			QueryParams.AddIgnoredActor(this);
+			QueryParams.bTraceComplex = true;
+			QueryParams.bReturnPhysicalMaterial = true;
+
+			// The hits get resolved in ResolveShot, either next frame with the rest of the batch or right away
+			if (UHMShotQueueSubsystem* const ShotQueue = GetWorld()->GetSubsystem<UHMShotQueueSubsystem>())
+			{
+				if (UHMShotQueueSubsystem::IsBatchingEnabled())
+				{
+					ShotQueue->QueueShot(this, EyeLocation, TraceEnds, QueryParams, RewindTime);
+				}
+				else
+				{
+					ShotQueue->TraceShotNow(this, EyeLocation, TraceEnds, QueryParams, RewindTime);
+				}
+			}
+
+#ifdef _DEBUGDRAW
+			for (const FVector& TraceEnd : TraceEnds)
+			{
+				DrawDebugLine(GetWorld(), EyeLocation, TraceEnd, FColor::White, false, 1.0f, 0, 1.0f);
+			}
+#endif // _DEBUGDRAW
+		}
+
+		++m_RecoilPatternIndex;
+
+		// Only the owning client's controller cares about recoil
+		if (m_HotStats->HasRecoil() && IsOwnerLocallyControlled())
 		{
-			Character->GetController()->GetPlayerViewPoint(EyeLocation, EyeRotation);
+			HandleRecoil();
 		}
-		// MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
 
-		FVector ShotDirection = EyeRotation.Vector();
+		SetAmmo(m_CurrentAmmoInMag - 1, m_CurrentAmmo);
+
+		m_LastFireTime = GetWorld()->TimeSeconds - TimeSinceShot;
+	}
+
+	return true;
+}
+
+void AHMFirearmBase::ResolveShot(const FVector& TraceStart, TArrayView<const FHMShotTraceResult> Pellets)
+{
+	AActor* const MyOwner = GetOwner();
+	if (MyOwner == nullptr)
+	{
+		return;
+	}
 
-		// TODO: consider shotguns also...
-		// TODO: spread
+	/** Everything the pellets of this shot did to one actor. */
+	struct FTargetDamage
+	{
+		AActor* Actor;
+		const FHitResult* Hit;
+		FVector ShotDirection;
+		float Damage;
+	};
 
-		FVector TraceEnd = EyeLocation + (ShotDirection * 10000);
+	TArray<FTargetDamage, TInlineAllocator<8>> Targets;
+	int32 Currency = 0;
 
-		FCollisionQueryParams QueryParams;
-		QueryParams.AddIgnoredActor(MyOwner);
-		QueryParams.AddIgnoredActor(this);
-		QueryParams.bTraceComplex = true;
-		QueryParams.bReturnPhysicalMaterial = true;
+	for (int32 PelletIndex = 0; PelletIndex < Pellets.Num(); ++PelletIndex)
+	{
+		const FHMShotTraceResult& Pellet = Pellets[PelletIndex];
+		const FVector ShotDirection = (Pellet.TraceEnd - TraceStart).GetSafeNormal();
 
-		FVector TracerEndPoint = TraceEnd;
+		FVector TracerEndPoint = Pellet.TraceEnd;
 
 		EPhysicalSurface SurfaceType = SurfaceType_Default;
 
-		FHitResult Hit;
-		if (GetWorld()->LineTraceSingleByChannel(Hit, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams))
+		if (Pellet.bHit)
 		{
-			SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
-
-			float ActualDamage = m_FirearmStats.WeaponInfo.HitBaseDamage;
-			int32 Currency = 25;
+			float Damage = 0.0f;
+			int32 HitCurrency = 0;
+			SurfaceType = GetHitDamage(Pellet.Hit, Damage, HitCurrency);
 
-			switch (SurfaceType)
-			{
-			case SURFACE_ZOMBIEVULNERABLE:
-				ActualDamage = m_FirearmStats.WeaponInfo.HitHeadshotDamage * 1.5;
-				break;
-			case SURFACE_ZOMBIEHEAD:
-				ActualDamage = m_FirearmStats.WeaponInfo.HitHeadshotDamage;
-				Currency = 100;
-				break;
-			case SURFACE_ZOMBIEBODY:
-				ActualDamage = m_FirearmStats.WeaponInfo.HitBodyDamage;
-				break;
-			case SURFACE_ZOMBIELIMB:
-				ActualDamage = m_FirearmStats.WeaponInfo.HitLimbDamage;
-				break;
-			default:
-			case SURFACE_ZOMBIEDEFAULT:
-				Currency = 10;
-				break;
-			}
+			Currency += HitCurrency;
 
-			if (GetLocalRole() == ROLE_Authority)
+			if (AActor* const HitActor = Pellet.Hit.GetActor())
 			{
-				AHMCharacterBase* const HitActor = Cast<AHMCharacterBase>(Hit.GetActor());
-				if (HitActor != nullptr && HitActor->IsAlive() && HitActor->GetName().Contains("BP_ZombieCharacter"))
+				FTargetDamage* Target = Targets.FindByPredicate([HitActor](const FTargetDamage& Other) { return Other.Actor == HitActor; });
+				if (Target == nullptr)
 				{
-					if (AHMPlayerState* const PS = Cast<AHMPlayerState>(Character->GetPlayerState()))
-					{
-						PS->AddCurrency(Currency);
-					}
+					Targets.Add({ HitActor, &Pellet.Hit, ShotDirection, 0.0f });
+					Target = &Targets.Last();
 				}
+
+				Target->Damage += Damage;
 			}
 
-			UGameplayStatics::ApplyPointDamage(Hit.GetActor(), ActualDamage, ShotDirection, Hit, MyOwner->GetInstigatorController(), MyOwner, nullptr);
+			PlayImpactEffects(SurfaceType, Pellet.Hit.ImpactPoint);
+
+			TracerEndPoint = Pellet.Hit.ImpactPoint;
+		}
 
-			PlayImpactEffects(SurfaceType, Hit.ImpactPoint);
+		PlayFireEffects(TracerEndPoint, PelletIndex == 0);
 
-			TracerEndPoint = Hit.ImpactPoint;
+		if (GetLocalRole() == ROLE_Authority)
+		{
+			FHMShotEvent& ShotEvent = m_PendingShotEvents.AddDefaulted_GetRef();
+			ShotEvent.Origin = TraceStart;
+			ShotEvent.Direction = ShotDirection;
+			ShotEvent.Distance = Pellet.bHit ? (Pellet.Hit.ImpactPoint - TraceStart).Size() : HITSCAN_RANGE;
+			ShotEvent.SurfaceType = SurfaceType;
+			ShotEvent.bHit = Pellet.bHit;
 		}
+	}
 
-#ifdef _DEBUGDRAW
-		DrawDebugLine(GetWorld(), EyeLocation, TraceEnd, FColor::White, false, 1.0f, 0, 1.0f);
-#endif // _DEBUGDRAW
+	// One damage event per actor no matter how many pellets hit it
+	for (const FTargetDamage& Target : Targets)
+	{
+		UGameplayStatics::ApplyPointDamage(Target.Actor, Target.Damage, Target.ShotDirection, *Target.Hit, MyOwner->GetInstigatorController(), MyOwner, nullptr);
+	}
 
-		--m_CurrentAmmoInMag;
-		m_OnWeaponAmmoChanged.Broadcast(this, m_CurrentAmmoInMag, m_CurrentAmmo);
+	PayCurrency(Currency);
+}
 
-		PlayFireEffects(TracerEndPoint);
+EPhysicalSurface AHMFirearmBase::GetHitDamage(const FHitResult& Hit, float& OutDamage, int32& OutCurrency) const
+{
+	const EPhysicalSurface SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
 
-		if (GetLocalRole() == ROLE_Authority)
+	const FHMHitZone& HitZone = m_HitZones->Get(SurfaceType);
+	OutDamage = m_HotStats->GetDamage(HitZone.Damage) * HitZone.DamageMultiplier;
+	OutCurrency = 0;
+
+	if (GetLocalRole() == ROLE_Authority && HitZone.Currency != 0)
+	{
+		const AHMCharacterBase* const HitActor = Cast<AHMCharacterBase>(Hit.GetActor());
+		if (HitActor != nullptr && HitActor->IsAlive() && HitActor->IsEnemy())
 		{
-			m_HitScanTrace.TraceTo = TracerEndPoint;
-			m_HitScanTrace.SurfaceType = SurfaceType;
+			OutCurrency = HitZone.Currency;
 		}
+	}
+
+	return SurfaceType;
+}
 
-		m_LastFireTime = GetWorld()->TimeSeconds;
+void AHMFirearmBase::PayCurrency(int32 Currency)
+{
+	if (Currency == 0 || GetLocalRole() < ROLE_Authority)
+	{
+		return;
 	}
 
-	// Fixes the issue where if in semi auto mode the recoil keeps going
-	if (m_CurrentFireMode == EFireMode::SemiAuto && m_ShotCount == 1)
+	if (AHMPlayerCharacter* const Character = Cast<AHMPlayerCharacter>(GetOwner()))
 	{
-		StopFire();
+		if (AHMPlayerState* const PS = Cast<AHMPlayerState>(Character->GetPlayerState()))
+		{
+			PS->AddCurrency(Currency);
+		}
 	}
 }
 
-void AHMFirearmBase::OnRep_HitScanTrace()
+FVector AHMFirearmBase::GetPelletDirection(const FVector& ShotDirection) const
 {
-	PlayFireEffects(m_HitScanTrace.TraceTo);
-	PlayImpactEffects(m_HitScanTrace.SurfaceType, m_HitScanTrace.TraceTo);
+	if (!m_HotStats->HasSpread())
+	{
+		return ShotDirection;
+	}
+
+	FRotator Rotation = ShotDirection.Rotation();
+	Rotation.Yaw += FMath::FRandRange(m_HotStats->HorizontalSpread.X, m_HotStats->HorizontalSpread.Y);
+	Rotation.Pitch += FMath::FRandRange(m_HotStats->VerticalSpread.X, m_HotStats->VerticalSpread.Y);
+
+	return Rotation.Vector();
 }
 
-bool AHMFirearmBase::Server_Fire_Validate() { return true; }
-void AHMFirearmBase::Server_Fire_Implementation() { Fire(); }
+void AHMFirearmBase::LaunchProjectile(const FVector& EyeLocation, const FVector& ShotDirection)
+{
+	// Clients wait for Multi_SpawnProjectile, the muzzle flash is played right away though
+	if (GetLocalRole() < ROLE_Authority)
+	{
+		PlayFireEffects(EyeLocation + ShotDirection * HITSCAN_RANGE);
+		return;
+	}
+
+	UHMProjectileSubsystem* const Projectiles = GetWorld()->GetSubsystem<UHMProjectileSubsystem>();
+	if (Projectiles == nullptr)
+	{
+		return;
+	}
+
+	// Aim from the muzzle at whatever is under the crosshair
+	const FVector MuzzleLocation = GetWeaponMesh()->GetSocketLocation(m_FirearmStats->MuzzleSocketName);
+	const FVector Direction = (EyeLocation + ShotDirection * HITSCAN_RANGE - MuzzleLocation).GetSafeNormal();
+
+	const uint16 ProjectileId = Projectiles->SpawnProjectile(this, MuzzleLocation, Direction, m_HotStats->Projectile);
+
+	PlayFireEffects(MuzzleLocation + Direction * HITSCAN_RANGE);
+
+	Multi_SpawnProjectile(MuzzleLocation, Direction, ProjectileId);
+}
+
+void AHMFirearmBase::Multi_SpawnProjectile_Implementation(const FVector_NetQuantize& Origin, const FVector_NetQuantizeNormal& Direction, uint16 ProjectileId)
+{
+	// The server already spawned it
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		return;
+	}
+
+	if (UHMProjectileSubsystem* const Projectiles = GetWorld()->GetSubsystem<UHMProjectileSubsystem>())
+	{
+		Projectiles->SpawnProjectile(this, Origin, Direction, m_HotStats->Projectile, ProjectileId);
+	}
+
+	// The owner already played the muzzle flash when it fired
+	if (!IsOwnerLocallyControlled())
+	{
+		PlayFireEffects(Origin + Direction * HITSCAN_RANGE);
+	}
+}
+
+void AHMFirearmBase::ResolveProjectileImpact(uint16 ProjectileId, const FHitResult& Hit, const FVector& Velocity)
+{
+	const FVector Direction = Velocity.GetSafeNormal();
+
+	EPhysicalSurface SurfaceType = SurfaceType_Default;
+
+	if (m_HotStats->Projectile.IsExplosive())
+	{
+		AActor* const MyOwner = GetOwner();
+
+		TArray<AActor*> IgnoreActors;
+		IgnoreActors.Add(this);
+
+		UGameplayStatics::ApplyRadialDamage(this, m_HotStats->Projectile.ExplosionDamage, Hit.ImpactPoint, m_HotStats->Projectile.ExplosionRadius, nullptr, IgnoreActors, MyOwner, MyOwner ? MyOwner->GetInstigatorController() : nullptr);
+	}
+	else
+	{
+		float Damage = 0.0f;
+		int32 Currency = 0;
+		SurfaceType = GetHitDamage(Hit, Damage, Currency);
+
+		AActor* const MyOwner = GetOwner();
+		UGameplayStatics::ApplyPointDamage(Hit.GetActor(), Damage, Direction, Hit, MyOwner ? MyOwner->GetInstigatorController() : nullptr, MyOwner, nullptr);
+
+		PayCurrency(Currency);
+	}
+
+	PlayImpactEffects(SurfaceType, Hit.ImpactPoint);
+
+	// Slow projectiles can land after the firearm went dormant, multicasts aren't sent to dormant actors
+	WakeForReplication();
+	Multi_ProjectileImpact(ProjectileId, Hit.ImpactPoint, SurfaceType);
+}
+
+void AHMFirearmBase::Multi_ProjectileImpact_Implementation(uint16 ProjectileId, const FVector_NetQuantize& ImpactPoint, uint8 SurfaceType)
+{
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		return;
+	}
+
+	if (UHMProjectileSubsystem* const Projectiles = GetWorld()->GetSubsystem<UHMProjectileSubsystem>())
+	{
+		Projectiles->RemoveProjectile(ProjectileId);
+	}
+
+	PlayImpactEffects(static_cast<EPhysicalSurface>(SurfaceType), ImpactPoint);
+}
+
+void AHMFirearmBase::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Pack everything since the last net update into one batch, if there's nothing new the last batch stays and doesn't get resent
+	if (m_PendingShotEvents.Num() > 0)
+	{
+		const int32 NumDropped = FMath::Max(m_PendingShotEvents.Num() - FHMShotEventStream::MaxShotsPerUpdate, 0);
+		if (NumDropped > 0)
+		{
+			m_PendingShotEvents.RemoveAt(0, NumDropped, false);
+		}
+
+		m_ShotEvents.FirstShotId = m_NextShotEventId;
+		m_ShotEvents.Shots = m_PendingShotEvents;
+		m_NextShotEventId += m_PendingShotEvents.Num();
+		HM_MARK_PROPERTY_DIRTY(AHMFirearmBase, m_ShotEvents, this);
+
+		m_PendingShotEvents.Reset();
+	}
+}
+
+void AHMFirearmBase::OnRep_ShotEvents()
+{
+	for (int32 Index = 0; Index < m_ShotEvents.Shots.Num(); ++Index)
+	{
+		const uint16 ShotId = static_cast<uint16>(m_ShotEvents.FirstShotId + Index);
+		if (!FHMShotEventStream::IsNewer(ShotId, m_LastReplayedShotEventId))
+		{
+			continue;
+		}
+
+		const FHMShotEvent& ShotEvent = m_ShotEvents.Shots[Index];
+		const FVector ShotEnd = ShotEvent.Origin + ShotEvent.Direction * (ShotEvent.bHit ? ShotEvent.Distance : HITSCAN_RANGE);
+
+		PlayFireEffects(ShotEnd);
+
+		if (ShotEvent.bHit)
+		{
+			PlayImpactEffects(ShotEvent.SurfaceType, ShotEnd);
+		}
+	}
+
+	if (m_ShotEvents.Shots.Num() > 0)
+	{
+		m_LastReplayedShotEventId = m_ShotEvents.GetLastShotId();
+	}
+}
+
+bool AHMFirearmBase::GetShotViewPoint(FVector& OutLocation, FRotator& OutRotation) const
+{
+	OutLocation = GetActorLocation();
+	OutRotation = GetActorRotation();
+
+	if (const APawn* const MyOwner = Cast<APawn>(GetOwner()))
+	{
+		if (AController* const Controller = MyOwner->GetController())
+		{
+			Controller->GetPlayerViewPoint(OutLocation, OutRotation);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool AHMFirearmBase::Server_Fire_Validate(const FVector_NetQuantize& EyeLocation, const FVector_NetQuantizeNormal& ShotDirection, float ClientFireTime, uint16 ShotId) { return true; }
+void AHMFirearmBase::Server_Fire_Implementation(const FVector_NetQuantize& EyeLocation, const FVector_NetQuantizeNormal& ShotDirection, float ClientFireTime, uint16 ShotId)
+{
+	// Acked even if the shot fails (empty mag, reloading), the ack has the ammo the owner has to go with
+	if (AckShot(ShotId))
+	{
+		FireFromClient(EyeLocation, ShotDirection, ClientFireTime);
+	}
+}
+
+bool AHMFirearmBase::Server_FireInput_Validate(const FHMFireInput& Input) { return true; }
+void AHMFirearmBase::Server_FireInput_Implementation(const FHMFireInput& Input)
+{
+	// Resent shots that were already fired don't get acked again
+	for (int32 Index = 0; Index < Input.Shots.Num(); ++Index)
+	{
+		const FHMFireInputShot& Shot = Input.Shots[Index];
+		if (AckShot(static_cast<uint16>(Input.FirstShotId + Index)))
+		{
+			FireFromClient(Shot.Origin, Shot.Direction, Shot.FireTime);
+		}
+	}
+
+	// The connection drops packets that arrive late, so this is never an older input than the last one
+	if (!Input.bTriggerDown)
+	{
+		if (m_WeaponStatus == EWeaponStatus::Firing)
+		{
+			SetWeaponStatus(EWeaponStatus::Idle);
+		}
+
+		// The server never runs StartFire/OnScheduledFireFinished for a client's firearm, the next trigger pull starts the pattern over
+		m_RecoilPatternIndex = 0;
+	}
+}
+
+void AHMFirearmBase::FireFromClient(const FVector& EyeLocation, const FVector& ShotDirection, float ClientFireTime)
+{
+	FVector ServerEyeLocation;
+	FRotator ServerEyeRotation;
+	GetShotViewPoint(ServerEyeLocation, ServerEyeRotation);
+
+	// Trust the client's aim, but not a view point that's nowhere near where we think the camera is
+	const FVector ShotOrigin = FVector::DistSquared(EyeLocation, ServerEyeLocation) <= FMath::Square(MAX_SHOT_ORIGIN_ERROR) ? FVector(EyeLocation) : ServerEyeLocation;
+	const FVector Direction = ShotDirection.IsNearlyZero() ? ServerEyeRotation.Vector() : ShotDirection.GetSafeNormal();
+
+	FireAlong(ShotOrigin, Direction, ClientFireTime);
+}
 
 bool AHMFirearmBase::Server_Reload_Validate() { return true; }
 void AHMFirearmBase::Server_Reload_Implementation() { StartReload(); }
 
-bool AHMFirearmBase::Server_SetStatus_Validate(EWeaponStatus NewStatus) { return true; }
-void AHMFirearmBase::Server_SetStatus_Implementation(EWeaponStatus NewStatus) { m_WeaponStatus = NewStatus; }
 
 void AHMFirearmBase::StartFire()
 {
-	float FirstDelay = FMath::Max(m_LastFireTime + m_TimeBetweenShots - GetWorld()->TimeSeconds, 0.0f);
-	m_RecoilTime = UGameplayStatics::GetWorldDeltaSeconds(GetWorld());
+	UHMFireSchedulerSubsystem* const FireScheduler = GetWorld()->GetSubsystem<UHMFireSchedulerSubsystem>();
+	if (FireScheduler == nullptr || FireScheduler->IsFiring(this))
+	{
+		// Still finishing a burst
+		return;
+	}
+
+	m_AppliedRecoil = FVector2D::ZeroVector;
+	m_RecoilPatternIndex = 0;
+
+	m_bTriggerDown = true;
+	m_TriggerSendsLeft = 0;
 
+	int32 NumShots = INDEX_NONE;
 	switch (m_CurrentFireMode)
 	{
 	default:
-	case EFireMode::ThreeBurst:
 	case EFireMode::FullAuto:
-		GetWorldTimerManager().SetTimer(m_TimerHandle_TimeBetweenShots, this, &AHMFirearmBase::Fire, m_TimeBetweenShots, true, FirstDelay);
+		break;
+	case EFireMode::ThreeBurst:
+		NumShots = 3;
 		break;
 	case EFireMode::SemiAuto:
-		GetWorldTimerManager().SetTimer(m_TimerHandle_TimeBetweenShots, this, &AHMFirearmBase::Fire, m_TimeBetweenShots, false, FirstDelay);
+		NumShots = 1;
 		break;
 	}
+
+	FireScheduler->StartFiring(this, m_HotStats->TimeBetweenShots, NumShots, m_LastFireTime + m_HotStats->TimeBetweenShots);
 }
 
 void AHMFirearmBase::StopFire()
 {
-	if (m_CurrentFireMode == EFireMode::ThreeBurst && m_ShotCount == 3 || m_CurrentFireMode != EFireMode::ThreeBurst)
+	// A burst keeps going until it's done, the scheduler calls OnScheduledFireFinished once the firearm actually stopped
+	if (UHMFireSchedulerSubsystem* const FireScheduler = GetWorld()->GetSubsystem<UHMFireSchedulerSubsystem>())
 	{
-		if (GetWorldTimerManager().TimerExists(m_TimerHandle_TimeBetweenShots))
-		{
-			GetWorldTimerManager().ClearTimer(m_TimerHandle_TimeBetweenShots);
-		}
+		FireScheduler->StopFiring(this);
+	}
+}
+
+void AHMFirearmBase::OnScheduledFireFinished()
+{
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		SetWeaponStatus(EWeaponStatus::Idle);
+	}
+	else
+	{
+		// The server sets the status once it gets the release with the fire input. A tap fires and releases in the same input,
+		// so the server's status never changes and never replicates - the prediction has to go back to idle by itself
+		m_WeaponStatus = EWeaponStatus::Idle;
+		m_bTriggerDown = false;
+		m_TriggerSendsLeft = FHMFireInput::GetRedundancy();
+	}
+
+	m_AppliedRecoil = FVector2D::ZeroVector;
+	m_RecoilPatternIndex = 0;
+}
+
+void AHMFirearmBase::QueueFireInput(uint16 ShotId, const FVector& EyeLocation, const FVector& ShotDirection, float FireTime)
+{
+	// The ids of one input follow each other, only not after hm.FireInput.Batching was toggled - the old shots aren't resent then
+	if (m_FireInputShotIds.Num() > 0 && static_cast<uint16>(m_FireInputShotIds.Last() + 1) != ShotId)
+	{
+		m_FireInputShots.Reset();
+		m_FireInputShotIds.Reset();
+		m_FireInputSendCounts.Reset();
+		m_NumNewFireInputShots = 0;
+	}
+
+	FHMFireInputShot& Shot = m_FireInputShots.AddDefaulted_GetRef();
+	Shot.Origin = EyeLocation;
+	Shot.Direction = ShotDirection;
+	Shot.FireTime = FireTime;
+
+	m_FireInputShotIds.Add(ShotId);
+	m_FireInputSendCounts.Add(0);
+	++m_NumNewFireInputShots;
+}
+
+void AHMFirearmBase::FlushFireInput()
+{
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		return;
+	}
 
-		Server_SetStatus(EWeaponStatus::Idle);
-		// m_WeaponStatus = EWeaponStatus::Idle;
+	// Only frames with new shots or a release send an input, the shots that weren't acked yet ride along with it
+	if (m_NumNewFireInputShots == 0 && (m_TriggerSendsLeft == 0 || m_LastFireInputFrame == GFrameCounter))
+	{
+		return;
+	}
 
-		m_ShotCount = 0;
-		m_RecoilTime = 0.0f;
+	// The server already has the acked ones, and too old ones aren't worth resending
+	int32 NumDropped = 0;
+	while (NumDropped < m_FireInputShotIds.Num() && (!FHMAmmoAck::IsNewer(m_FireInputShotIds[NumDropped], GetLastAckedShotId())
+		|| m_FireInputShotIds.Num() - NumDropped > FHMFireInput::MaxShotsPerInput))
+	{
+		++NumDropped;
+	}
+
+	m_FireInputShots.RemoveAt(0, NumDropped, false);
+	m_FireInputShotIds.RemoveAt(0, NumDropped, false);
+	m_FireInputSendCounts.RemoveAt(0, NumDropped, false);
+	m_NumNewFireInputShots = FMath::Min(m_NumNewFireInputShots, m_FireInputShots.Num());
+
+	m_LastFireInputFrame = GFrameCounter;
+
+	FHMFireInput Input;
+	Input.bTriggerDown = m_bTriggerDown;
+	Input.FirstShotId = m_FireInputShots.Num() > 0 ? m_FireInputShotIds[0] : 0;
+	Input.Shots = m_FireInputShots;
+	Input.NumNewShots = m_NumNewFireInputShots;
+
+	Server_FireInput(Input);
+
+	m_NumNewFireInputShots = 0;
+	m_TriggerSendsLeft = FMath::Max(m_TriggerSendsLeft - 1, 0);
+
+	// Everything is sent every time, so the oldest shots are the first to be sent often enough
+	const int32 Redundancy = FHMFireInput::GetRedundancy();
+	int32 NumDone = 0;
+	for (int32 Index = 0; Index < m_FireInputSendCounts.Num(); ++Index)
+	{
+		if (++m_FireInputSendCounts[Index] >= Redundancy)
+		{
+			NumDone = Index + 1;
+		}
 	}
+
+	m_FireInputShots.RemoveAt(0, NumDone, false);
+	m_FireInputShotIds.RemoveAt(0, NumDone, false);
+	m_FireInputSendCounts.RemoveAt(0, NumDone, false);
 }
 
 void AHMFirearmBase::StartReload()
@@ -238,22 +702,27 @@ void AHMFirearmBase::StartReload()
 
 	if (GetLocalRole() == ROLE_Authority)
 	{
-		PlayAnimationMontage(m_FirearmStats.AnimReload.Standing);
+		PlayAnimationMontage(m_FirearmStats->AnimReload.Standing);
 	}
 
-	m_WeaponStatus = EWeaponStatus::Reloading;
+	// Finishes firing like a released trigger (OnScheduledFireFinished), before the status becomes Reloading
+	if (UHMFireSchedulerSubsystem* const FireScheduler = GetWorld()->GetSubsystem<UHMFireSchedulerSubsystem>())
+	{
+		FireScheduler->CancelFiring(this);
+	}
 
-	m_RecoilTime = 0.0f;
+	SetWeaponStatus(EWeaponStatus::Reloading);
 
-	GetWorldTimerManager().ClearTimer(m_TimerHandle_TimeBetweenShots);
+	m_AppliedRecoil = FVector2D::ZeroVector;
+	m_RecoilPatternIndex = 0;
 
 	FTimerHandle TimerHandle_Reload;
-	GetWorldTimerManager().SetTimer(TimerHandle_Reload, this, &AHMFirearmBase::ReloadFinished, m_FirearmStats.ReloadSpeed);
+	GetWorldTimerManager().SetTimer(TimerHandle_Reload, this, &AHMFirearmBase::ReloadFinished, m_HotStats->ReloadSpeed);
 }
 
 void AHMFirearmBase::ToggleFireMode(EFireMode NewFireMode)
 {
-	if (m_FirearmStats.AllowedFireModes.Contains(NewFireMode))
+	if (m_HotStats->AllowedFireModes.Contains(NewFireMode))
 	{
 		m_OnFirearmFireModeChanged.Broadcast(this, m_CurrentFireMode, NewFireMode);
 		m_CurrentFireMode = NewFireMode;
@@ -263,57 +732,66 @@ void AHMFirearmBase::ToggleFireMode(EFireMode NewFireMode)
 
 void AHMFirearmBase::HandleRecoil()
 {
-	m_RecoilTime += UGameplayStatics::GetWorldDeltaSeconds(GetWorld());
 	if (AHMPlayerCharacter* const Player = Cast<AHMPlayerCharacter>(GetOwner()))
 	{
 		if (AHMPlayerController* const PlayerController = Cast<AHMPlayerController>(Player->GetController()))
 		{
-			PlayerController->RegisterRecoil(m_FirearmStats.Recoil->GetVectorValue(m_RecoilTime).Y, m_FirearmStats.Recoil->GetVectorValue(m_RecoilTime).Z);
+			// The offset of the shots fired so far, the same pattern the server and replays reproduce - only apply what the last shot added
+			const FVector2D RecoilOffset = GetRecoilAimOffset(m_RecoilPatternIndex);
+			const FVector2D RecoilDelta = RecoilOffset - m_AppliedRecoil;
+			m_AppliedRecoil = RecoilOffset;
+
+			PlayerController->RegisterRecoil(RecoilDelta.X, RecoilDelta.Y);
 		}
 	}
 }
 
+bool AHMFirearmBase::IsOwnerLocallyControlled() const
+{
+	const APawn* const MyOwner = Cast<APawn>(GetOwner());
+	return MyOwner != nullptr && MyOwner->IsLocallyControlled();
+}
+
 void AHMFirearmBase::ReloadFinished()
 {
 	// Subtract ammo from m_CurrentAmmo if > 0 and add to m_CurrentAmmoInMag
 
-	int32 ToAdd = FMath::Min(m_CurrentAmmo, m_FirearmStats.WeaponInfo.MagCapacity - m_CurrentAmmoInMag);
+	const int32 ToAdd = FMath::Min(m_CurrentAmmo, m_HotStats->MagCapacity - m_CurrentAmmoInMag);
 
-	m_CurrentAmmo -= ToAdd;
-	m_CurrentAmmoInMag += ToAdd;
+	SetReloadedAmmo(m_CurrentAmmoInMag + ToAdd, m_CurrentAmmo - ToAdd);
 
-	m_OnWeaponAmmoChanged.Broadcast(this, m_CurrentAmmoInMag, m_CurrentAmmo);
+	SetWeaponStatus(EWeaponStatus::Idle);
 
-	m_WeaponStatus = EWeaponStatus::Idle;
-
-	m_LastFireTime = GetWorld()->TimeSeconds - m_TimeBetweenShots;
+	m_LastFireTime = GetWorld()->TimeSeconds - m_HotStats->TimeBetweenShots;
 }
 
-void AHMFirearmBase::PlayFireEffects(const FVector& TraceEnd)
+void AHMFirearmBase::PlayFireEffects(const FVector& TraceEnd, bool bIsFirstPellet)
 {
-	if (m_FirearmStats.Visuals.MuzzleEffect)
+	UHMEffectPoolSubsystem* const EffectPool = GetWorld()->GetSubsystem<UHMEffectPoolSubsystem>();
+
+	if (m_FirearmStats->Visuals.MuzzleEffect && EffectPool && bIsFirstPellet)
 	{
-		UGameplayStatics::SpawnEmitterAttached(m_FirearmStats.Visuals.MuzzleEffect, GetWeaponMesh(), m_FirearmStats.MuzzleSocketName);
+		EffectPool->SpawnAttached(m_FirearmStats->Visuals.MuzzleEffect, GetWeaponMesh(), m_FirearmStats->MuzzleSocketName);
 	}
 
-	if (m_FirearmStats.Visuals.TracerEffect)
+	if (m_FirearmStats->Visuals.TracerEffect && EffectPool)
 	{
-		FVector MuzzleLocation = GetWeaponMesh()->GetSocketLocation(m_FirearmStats.MuzzleSocketName);
+		FVector MuzzleLocation = GetWeaponMesh()->GetSocketLocation(m_FirearmStats->MuzzleSocketName);
 
-		UParticleSystemComponent* TracerComp = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), m_FirearmStats.Visuals.TracerEffect, MuzzleLocation);
+		UParticleSystemComponent* TracerComp = EffectPool->SpawnAtLocation(m_FirearmStats->Visuals.TracerEffect, MuzzleLocation);
 		if (TracerComp)
 		{
-			TracerComp->SetVectorParameter(m_FirearmStats.TracerTargetName, TraceEnd);
+			TracerComp->SetVectorParameter(m_FirearmStats->TracerTargetName, TraceEnd);
 		}
 	}
 
-	if (m_FirearmStats.Visuals.FireCamShake)
+	if (m_FirearmStats->Visuals.FireCamShake && bIsFirstPellet)
 	{
 		if (APawn* const MyOwner = Cast<APawn>(GetOwner()))
 		{
 			if (APlayerController* const PC = Cast<APlayerController>(MyOwner->GetController()))
 			{
-				PC->ClientPlayCameraShake(m_FirearmStats.Visuals.FireCamShake);
+				PC->ClientPlayCameraShake(m_FirearmStats->Visuals.FireCamShake);
 			}
 		}
 	}
@@ -321,29 +799,18 @@ void AHMFirearmBase::PlayFireEffects(const FVector& TraceEnd)
 
 void AHMFirearmBase::PlayImpactEffects(EPhysicalSurface SurfaceType, const FVector& ImpactPoint)
 {
-	UParticleSystem* SelectedEffect = nullptr;
-	switch (SurfaceType)
-	{
-	case SURFACE_ZOMBIEVULNERABLE:
-	case SURFACE_ZOMBIEHEAD:
-	case SURFACE_ZOMBIEBODY:
-	case SURFACE_ZOMBIELIMB:
-	case SURFACE_ZOMBIEDEFAULT:
-		SelectedEffect = m_FirearmStats.Visuals.FleshImpactEffect;
-		break;
-	default:
-		SelectedEffect = m_FirearmStats.Visuals.DefaultImpactEffect;
-		break;
-	}
+	UParticleSystem* const SelectedEffect = m_HitZones->Get(SurfaceType).ImpactEffect == EHitZoneImpactEffect::Flesh ? m_FirearmStats->Visuals.FleshImpactEffect : m_FirearmStats->Visuals.DefaultImpactEffect;
+
+	UHMEffectPoolSubsystem* const EffectPool = GetWorld()->GetSubsystem<UHMEffectPoolSubsystem>();
 
-	if (SelectedEffect)
+	if (SelectedEffect && EffectPool)
 	{
-		FVector MuzzleLocation = GetWeaponMesh()->GetSocketLocation(m_FirearmStats.MuzzleSocketName);
+		FVector MuzzleLocation = GetWeaponMesh()->GetSocketLocation(m_FirearmStats->MuzzleSocketName);
 
 		FVector ShotDirection = ImpactPoint - MuzzleLocation;
 		ShotDirection.Normalize();
 
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), SelectedEffect, ImpactPoint, ShotDirection.Rotation());
+		EffectPool->SpawnAtLocation(SelectedEffect, ImpactPoint, ShotDirection.Rotation(), true);
 	}
 }
 
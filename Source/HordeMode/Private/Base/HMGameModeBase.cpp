@@ -4,12 +4,74 @@
 #include "Base/HMGameModeBase.h"
 #include "Base/HMCharacterBase.h"
 #include "HMCommon.h"
+#include "Player/HMBotController.h"
+#include "Player/HMPlayerController.h"
 #include "Player/HMPlayerState.h"
+#include "HordeMode.h"
+
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "RenderCore.h"
+
+static FAutoConsoleCommandWithWorldAndArgs CmdBotsAdd(
+	TEXT("hm.Bots.Add"),
+	TEXT("Add server-side bot players. Usage: hm.Bots.Add [Count=1] [Profile=Combat] (Idle, Wander, Combat, FullAuto)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		AHMGameModeBase* const GameMode = World ? World->GetAuthGameMode<AHMGameModeBase>() : nullptr;
+		if (GameMode == nullptr)
+		{
+			return;
+		}
+
+		const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1;
+		const int64 Profile = Args.Num() > 1 ? StaticEnum<EBotProfile>()->GetValueByNameString(Args[1]) : (int64)EBotProfile::Combat;
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			GameMode->AddBot(Profile > 0 ? (EBotProfile)Profile : EBotProfile::Combat);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CmdBotsStats(
+	TEXT("hm.Bots.Stats"),
+	TEXT("Log the number of bots and players, the game thread time and the server's bandwidth."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const AHMGameModeBase* const GameMode = World ? World->GetAuthGameMode<AHMGameModeBase>() : nullptr)
+		{
+			GameMode->DumpBotStats();
+		}
+	}));
+
+AHMGameModeBase::AHMGameModeBase(const class FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+}
+
+void AHMGameModeBase::StartPlay()
+{
+	Super::StartPlay();
+
+	// -HMBots=8 -HMBotProfile=FullAuto
+	int32 NumBots = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("HMBots="), NumBots) && NumBots > 0)
+	{
+		const EBotProfile Profile = FHMBotBrain::GetCommandLineProfile(EBotProfile::Combat);
+		for (int32 Index = 0; Index < NumBots; ++Index)
+		{
+			AddBot(Profile == EBotProfile::None ? EBotProfile::Combat : Profile);
+		}
+	}
+}
 
 void AHMGameModeBase::Killed(AController* Killer, AController* VictimPlayer)
 {
-	AHMPlayerState* const KillerPS = Cast<AHMPlayerState>(Killer->PlayerState);
-	AHMPlayerState* const VictimPS = Cast<AHMPlayerState>(VictimPlayer->PlayerState);
+	// No killer for deaths by zombies and the environment
+	AHMPlayerState* const KillerPS = Killer ? Cast<AHMPlayerState>(Killer->PlayerState) : nullptr;
+	AHMPlayerState* const VictimPS = VictimPlayer ? Cast<AHMPlayerState>(VictimPlayer->PlayerState) : nullptr;
 
 	if (KillerPS != nullptr && KillerPS != VictimPS && !KillerPS->bIsABot)
 	{
@@ -34,3 +96,58 @@ FString AHMGameModeBase::InitNewPlayer(APlayerController* NewPlayerController, c
 
 	return result;
 }
+
+AHMBotController* AHMGameModeBase::AddBot(EBotProfile Profile)
+{
+	// An AI controller with a player state, a player controller without a connection wouldn't move its pawn on a dedicated server
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	AHMBotController* const Bot = GetWorld()->SpawnActor<AHMBotController>(SpawnParams);
+	if (Bot == nullptr)
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("Couldn't add a bot."));
+		return nullptr;
+	}
+
+	m_Bots.Add(Bot);
+
+	if (AHMPlayerState* const PlayerState = Cast<AHMPlayerState>(Bot->PlayerState))
+	{
+		PlayerState->ChangeTeamType(ETeamType::Player);
+		PlayerState->bIsABot = true;
+		PlayerState->SetPlayerName(FString::Printf(TEXT("Bot %d"), m_Bots.Num()));
+	}
+
+	Bot->SetBotProfile(Profile);
+
+	RestartPlayer(Bot);
+
+	return Bot;
+}
+
+void AHMGameModeBase::DumpBotStats() const
+{
+	// Net clients launched as bots and the humans, the server-side bots aren't player controllers
+	int32 NumClientBots = 0;
+	int32 NumPlayers = 0;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const AHMPlayerController* const PlayerController = Cast<AHMPlayerController>(It->Get());
+		if (PlayerController != nullptr && PlayerController->IsBot())
+		{
+			++NumClientBots;
+		}
+		else
+		{
+			++NumPlayers;
+		}
+	}
+
+	const UNetDriver* const NetDriver = GetWorld()->GetNetDriver();
+
+	UE_LOG(LogHordeMode, Log, TEXT("Bots: %d bots (%d server-side), %d other players, game thread %.2f ms, net in %u B/s out %u B/s"),
+		NumClientBots + m_Bots.Num(), m_Bots.Num(), NumPlayers, FPlatformTime::ToMilliseconds(GGameThreadTime),
+		NetDriver ? NetDriver->InBytesPerSecond : 0, NetDriver ? NetDriver->OutBytesPerSecond : 0);
+}
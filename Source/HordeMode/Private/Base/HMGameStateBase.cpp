@@ -3,3 +3,31 @@
 
 #include "Base/HMGameStateBase.h"
 
+#include "Net/UnrealNetwork.h"
+
+AHMGameStateBase::AHMGameStateBase() : m_FirearmStatsDataTable(nullptr), m_HitZoneDataTable(nullptr), m_WaveDataTable(nullptr),
+    m_CurrentWave(0), m_WaveState(EWaveState::WaitingToStart), m_WaveStartTime(0.0f), m_ZombiesRemaining(0)
+{
+}
+
+void AHMGameStateBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+    Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+    DOREPLIFETIME(AHMGameStateBase, m_CurrentWave);
+    DOREPLIFETIME(AHMGameStateBase, m_WaveState);
+    DOREPLIFETIME(AHMGameStateBase, m_WaveStartTime);
+    DOREPLIFETIME(AHMGameStateBase, m_ZombiesRemaining);
+}
+
+void AHMGameStateBase::SetWaveState(EWaveState NewState, int32 Wave, float WaveStartTime)
+{
+    m_WaveState = NewState;
+    m_CurrentWave = Wave;
+    m_WaveStartTime = WaveStartTime;
+}
+
+void AHMGameStateBase::SetZombiesRemaining(int32 ZombiesRemaining)
+{
+    m_ZombiesRemaining = ZombiesRemaining;
+}
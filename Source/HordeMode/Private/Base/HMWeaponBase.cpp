@@ -2,9 +2,16 @@
 
 
 #include "Base/HMWeaponBase.h"
+#include "Net/HMPushModel.h"
+#include "HordeMode.h"
+
 #include "Net/UnrealNetwork.h"
 
-AHMWeaponBase::AHMWeaponBase() : m_CurrentAttachLocation(EWeaponAttachLocation::Hands), m_CurrentAmmo(0), m_CurrentAmmoInMag(0)
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ammo Acks"), STAT_HMAmmoAcks, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ammo Mispredictions"), STAT_HMAmmoMispredictions, STATGROUP_HordeMode);
+
+AHMWeaponBase::AHMWeaponBase() : m_CurrentAttachLocation(EWeaponAttachLocation::Hands), m_CurrentAmmo(0), m_CurrentAmmoInMag(0), m_NetDormancyDelay(2.0f),
+	m_ReloadAckTimeout(1.0f), m_LastNetActiveTime(0.0f), m_NextShotId(1), m_NumLocalReloads(0), m_LastLocalReloadTime(0.0f)
 {
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -20,18 +27,171 @@ AHMWeaponBase::AHMWeaponBase() : m_CurrentAttachLocation(EWeaponAttachLocation::
 void AHMWeaponBase::BeginPlay()
 {
 	Super::BeginPlay();
+
+	m_LastNetActiveTime = GetWorld()->GetTimeSeconds();
 }
 
 void AHMWeaponBase::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	// Nobody touched the weapon for a while, stop comparing its properties every net update until it's used again
+	if (GetLocalRole() == ROLE_Authority && NetDormancy == DORM_Awake && GetWorld()->GetTimeSeconds() - m_LastNetActiveTime > m_NetDormancyDelay)
+	{
+		SetNetDormancy(DORM_DormantAll);
+	}
 }
 
 void AHMWeaponBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(AHMWeaponBase, m_CurrentAmmo, COND_SkipOwner);
-	DOREPLIFETIME_CONDITION(AHMWeaponBase, m_CurrentAmmoInMag, COND_SkipOwner);
+	HM_DOREPLIFETIME_CONDITION_PUSH(AHMWeaponBase, m_CurrentAmmo, COND_SkipOwner);
+	HM_DOREPLIFETIME_CONDITION_PUSH(AHMWeaponBase, m_CurrentAmmoInMag, COND_SkipOwner);
+	HM_DOREPLIFETIME_CONDITION_PUSH(AHMWeaponBase, m_AmmoAck, COND_OwnerOnly);
+}
+
+void AHMWeaponBase::SetOwner(AActor* NewOwner)
+{
+	if (GetLocalRole() == ROLE_Authority && NewOwner != GetOwner())
+	{
+		// The new owner (a pickup, a reconnect) starts its ids over and would be rejected until they wrapped
+		m_AmmoAck.LastShotId = 0;
+		HM_MARK_PROPERTY_DIRTY(AHMWeaponBase, m_AmmoAck, this);
+	}
+
+	Super::SetOwner(NewOwner);
+}
+
+void AHMWeaponBase::WakeForReplication()
+{
+	if (GetLocalRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	if (NetDormancy > DORM_Awake)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+
+	m_LastNetActiveTime = GetWorld()->GetTimeSeconds();
+}
+
+void AHMWeaponBase::SetAmmo(int32 InMag, int32 Reserve)
+{
+	WakeForReplication();
+
+	m_CurrentAmmoInMag = InMag;
+	m_CurrentAmmo = Reserve;
+
+	HM_MARK_PROPERTY_DIRTY(AHMWeaponBase, m_CurrentAmmoInMag, this);
+	HM_MARK_PROPERTY_DIRTY(AHMWeaponBase, m_CurrentAmmo, this);
+
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		m_AmmoAck.AmmoInMag = InMag;
+		m_AmmoAck.Ammo = Reserve;
+		HM_MARK_PROPERTY_DIRTY(AHMWeaponBase, m_AmmoAck, this);
+	}
+
+	m_OnWeaponAmmoChanged.Broadcast(this, m_CurrentAmmoInMag, m_CurrentAmmo);
+}
+
+void AHMWeaponBase::SetReloadedAmmo(int32 InMag, int32 Reserve)
+{
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		++m_AmmoAck.NumReloads;
+	}
+	else
+	{
+		++m_NumLocalReloads;
+		m_LastLocalReloadTime = GetWorld()->GetTimeSeconds();
+	}
+
+	SetAmmo(InMag, Reserve);
+}
+
+uint16 AHMWeaponBase::PredictShot()
+{
+	// Ids more than half the range apart can't be compared anymore, the oldest ones were acked or lost long ago
+	if (m_UnackedShotIds.Num() >= MAX_int16)
+	{
+		m_UnackedShotReloads.RemoveAt(0, m_UnackedShotIds.Num() / 2, false);
+		m_UnackedShotIds.RemoveAt(0, m_UnackedShotIds.Num() / 2, false);
+	}
+
+	const uint16 ShotId = m_NextShotId++;
+	m_UnackedShotIds.Add(ShotId);
+	m_UnackedShotReloads.Add(m_NumLocalReloads);
+	return ShotId;
+}
+
+bool AHMWeaponBase::AckShot(uint16 ShotId)
+{
+	if (!FHMAmmoAck::IsNewer(ShotId, m_AmmoAck.LastShotId))
+	{
+		return false;
+	}
+
+	WakeForReplication();
+
+	// Acks every id up to this one, shots that were lost on the way are dropped and were never paid for with ammo
+	m_AmmoAck.LastShotId = ShotId;
+	HM_MARK_PROPERTY_DIRTY(AHMWeaponBase, m_AmmoAck, this);
+
+	return true;
 }
 
+void AHMWeaponBase::OnRep_AmmoAck()
+{
+	INC_DWORD_STAT(STAT_HMAmmoAcks);
+
+	// Forget the shots the server is done with
+	int32 NumAcked = 0;
+	while (NumAcked < m_UnackedShotIds.Num() && !FHMAmmoAck::IsNewer(m_UnackedShotIds[NumAcked], m_AmmoAck.LastShotId))
+	{
+		++NumAcked;
+	}
+
+	m_UnackedShotIds.RemoveAt(0, NumAcked, false);
+	m_UnackedShotReloads.RemoveAt(0, NumAcked, false);
+
+	// Continue after the ack, the server's last id can be ahead of ours when we just became the owner
+	if (m_UnackedShotIds.Num() == 0)
+	{
+		m_NextShotId = m_AmmoAck.LastShotId + 1;
+	}
+
+	Reconcile();
+}
+
+void AHMWeaponBase::Reconcile()
+{
+	// The owner finished a reload the server didn't finish yet, its ack doesn't have the reloaded ammo. Unless the server never started it.
+	const int8 ReloadsAhead = static_cast<int8>(m_NumLocalReloads - m_AmmoAck.NumReloads);
+	if (ReloadsAhead > 0 && GetWorld()->GetTimeSeconds() - m_LastLocalReloadTime < m_ReloadAckTimeout)
+	{
+		return;
+	}
+
+	m_NumLocalReloads = m_AmmoAck.NumReloads;
+
+	// Replay the unacknowledged shots on top of the server's ammo, the ones fired before its last reload came out of the old mag
+	int32 NumShotsInMag = 0;
+	for (const uint8 ShotReloads : m_UnackedShotReloads)
+	{
+		if (static_cast<int8>(ShotReloads - m_AmmoAck.NumReloads) >= 0)
+		{
+			++NumShotsInMag;
+		}
+	}
+
+	const int32 PredictedInMag = FMath::Max(m_AmmoAck.AmmoInMag - NumShotsInMag, 0);
+	if (PredictedInMag != m_CurrentAmmoInMag || m_AmmoAck.Ammo != m_CurrentAmmo)
+	{
+		INC_DWORD_STAT(STAT_HMAmmoMispredictions);
+		SetAmmo(PredictedInMag, m_AmmoAck.Ammo);
+	}
+}
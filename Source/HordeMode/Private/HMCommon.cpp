@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "HMCommon.h"
+#include "HordeMode.h"
+
+#include "Curves/CurveVector.h"
+
+/** The frame rate that the recoil curves are authored for. */
+static const float RECOIL_CURVE_FRAME_RATE = 60.0f;
+
+void FHMRecoilTable::Bake(const UCurveVector* Curve, float InSampleInterval)
+{
+	Samples.Reset();
+	SampleInterval = FMath::Max(InSampleInterval, KINDA_SMALL_NUMBER);
+
+	if (Curve == nullptr)
+	{
+		return;
+	}
+
+	float MinTime, MaxTime;
+	Curve->GetTimeRange(MinTime, MaxTime);
+
+	// One extra sample past the last key so the kick keeps going at the last key's value until the trigger is released
+	const int32 NumSamples = FMath::CeilToInt(FMath::Max(MaxTime, 0.0f) / SampleInterval) + 2;
+	Samples.Reserve(NumSamples);
+
+	// Integrate the per frame kick so the table holds the accumulated offset
+	FVector2D Offset = FVector2D::ZeroVector;
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		Samples.Add(Offset);
+
+		const FVector Kick = Curve->GetVectorValue(Index * SampleInterval);
+		Offset += FVector2D(Kick.Y, Kick.Z) * SampleInterval * RECOIL_CURVE_FRAME_RATE;
+	}
+}
+
+FVector2D FHMRecoilTable::Sample(float Time) const
+{
+	if (Samples.Num() == 0)
+	{
+		return FVector2D::ZeroVector;
+	}
+
+	const float Position = FMath::Max(Time, 0.0f) / SampleInterval;
+	const int32 Index = FMath::FloorToInt(Position);
+	const int32 LastIndex = Samples.Num() - 1;
+
+	if (Index >= LastIndex)
+	{
+		// Past the end of the table, keep kicking with the last step
+		const FVector2D LastStep = LastIndex > 0 ? Samples[LastIndex] - Samples[LastIndex - 1] : FVector2D::ZeroVector;
+		return Samples[LastIndex] + LastStep * (Position - LastIndex);
+	}
+
+	return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+}
+
+FHMFirearmHotStats::FHMFirearmHotStats(const FFirearmStats& Stats) :
+	TimeBetweenShots(60.0f / FMath::Max(Stats.ShotsPerMinute, 1.0f)), ReloadSpeed(Stats.ReloadSpeed),
+	HitHeadshotDamage(Stats.WeaponInfo.HitHeadshotDamage), HitBodyDamage(Stats.WeaponInfo.HitBodyDamage), HitLimbDamage(Stats.WeaponInfo.HitLimbDamage), HitBaseDamage(Stats.WeaponInfo.HitBaseDamage),
+	HorizontalSpread(Stats.HorizontalSpread), VerticalSpread(Stats.VerticalSpread),
+	MagCapacity(Stats.WeaponInfo.MagCapacity), MagCount(Stats.WeaponInfo.MagCount), ShotCount(FMath::Max<uint8>(Stats.ShotCount, 1)), FirearmType(Stats.FirearmType),
+	Projectile(Stats.Projectile)
+{
+	for (const EFireMode FireMode : Stats.AllowedFireModes)
+	{
+		AllowedFireModes.AddUnique(FireMode);
+	}
+
+	// Always allow something so the firearm can be fired at all
+	if (AllowedFireModes.Num() == 0)
+	{
+		AllowedFireModes.Add(EFireMode::FullAuto);
+	}
+
+	RecoilTable.Bake(Stats.Recoil);
+}
+
+FHMHitZoneTable::FHMHitZoneTable()
+{
+	// Everything that isn't a zombie
+	for (FHMHitZone& Zone : Zones)
+	{
+		Zone = FHMHitZone(EHitZoneDamage::Base, 1.0f, 10, EHitZoneImpactEffect::Default);
+	}
+
+	Zones[SURFACE_ZOMBIEVULNERABLE] = FHMHitZone(EHitZoneDamage::Headshot, 1.5f, 25, EHitZoneImpactEffect::Flesh);
+	Zones[SURFACE_ZOMBIEHEAD] = FHMHitZone(EHitZoneDamage::Headshot, 1.0f, 100, EHitZoneImpactEffect::Flesh);
+	Zones[SURFACE_ZOMBIEBODY] = FHMHitZone(EHitZoneDamage::Body, 1.0f, 25, EHitZoneImpactEffect::Flesh);
+	Zones[SURFACE_ZOMBIELIMB] = FHMHitZone(EHitZoneDamage::Limb, 1.0f, 25, EHitZoneImpactEffect::Flesh);
+	Zones[SURFACE_ZOMBIEDEFAULT] = FHMHitZone(EHitZoneDamage::Base, 1.0f, 10, EHitZoneImpactEffect::Flesh);
+}
+
+void FHMHitZoneTable::Build(const UDataTable* Table)
+{
+	if (Table == nullptr || Table->GetRowStruct() == nullptr || !Table->GetRowStruct()->IsChildOf(FHitZoneData::StaticStruct()))
+	{
+		return;
+	}
+
+	for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+	{
+		const FHitZoneData& Data = *reinterpret_cast<const FHitZoneData*>(Row.Value);
+		if (Data.SurfaceType < SurfaceType_Max)
+		{
+			Zones[Data.SurfaceType] = FHMHitZone(Data.Damage, Data.DamageMultiplier, Data.Currency, Data.ImpactEffect);
+		}
+	}
+}
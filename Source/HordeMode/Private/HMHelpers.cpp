@@ -2,4 +2,49 @@
 
 
 #include "HMHelpers.h"
+#include "Base/HMGameModeBase.h"
+#include "Player/HMBotController.h"
+#include "Subsystems/HMFirearmRegistry.h"
 
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+FFirearmStats UHMHelpers::GetFirearmStats(UWorld* World, const FName& FirearmID)
+{
+    if (UHMFirearmRegistry* const Registry = UHMFirearmRegistry::Get(World))
+    {
+        return Registry->GetStats(Registry->FindFirearm(World, FirearmID));
+    }
+
+    return FFirearmStats();
+}
+
+void UHMHelpers::GetPlayerControllers(const UWorld* World, TArray<AController*, TInlineAllocator<8>>& OutControllers)
+{
+    OutControllers.Reset();
+
+    if (World == nullptr)
+    {
+        return;
+    }
+
+    for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+    {
+        if (APlayerController* const PlayerController = It->Get())
+        {
+            OutControllers.Add(PlayerController);
+        }
+    }
+
+    // Only on the server, the bots are AI controllers so they aren't in the player controller list
+    if (const AHMGameModeBase* const GameMode = World->GetAuthGameMode<AHMGameModeBase>())
+    {
+        for (AHMBotController* const Bot : GameMode->GetBots())
+        {
+            if (Bot != nullptr && !Bot->IsPendingKill())
+            {
+                OutControllers.Add(Bot);
+            }
+        }
+    }
+}
@@ -3,4 +3,6 @@
 #include "HordeMode.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogHordeMode);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, HordeMode, "HordeMode" );
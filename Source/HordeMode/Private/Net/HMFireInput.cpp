@@ -0,0 +1,206 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Net/HMFireInput.h"
+#include "Net/HMBitPacking.h"
+#include "HordeMode.h"
+
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Input RPCs"), STAT_HMFireInputRPCs, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Input Bits"), STAT_HMFireInputBits, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Input Bits (RPC per shot estimate)"), STAT_HMFireInputLegacyBits, STATGROUP_HordeMode);
+
+static TAutoConsoleVariable<int32> CVarFireInputBatching(
+	TEXT("hm.FireInput.Batching"),
+	1,
+	TEXT("0 = send every shot with its own Server_Fire RPC, 1 = send the shots of a frame in one FHMFireInput."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFireInputRedundancy(
+	TEXT("hm.FireInput.Redundancy"),
+	3,
+	TEXT("How many inputs each shot is sent in until the server acks it, a shot is only lost if all of them are."),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdFireInputStats(
+	TEXT("hm.FireInput.Stats"),
+	TEXT("Log the fire RPCs and bits the owning client sent since the last call, compared to one Server_Fire RPC per shot. Toggle hm.FireInput.Batching in between to measure both."),
+	FConsoleCommandDelegate::CreateStatic(&FHMFireInput::DumpStats));
+
+/** Bit widths of the wire format, see FHMFireInput. */
+static const int32 SHOT_ID_BITS = 16;
+static const int32 SHOT_COUNT_BITS = 5;
+static const int32 FIRE_TIME_BITS = 32;
+static const int32 TIME_DELTA_BITS = 16;
+static const int32 BASE_ORIGIN_BITS = 20;
+static const int32 ORIGIN_DELTA_BITS = 12;
+static const int32 ANGLE_BITS = 16;
+
+static_assert(FHMFireInput::MaxShotsPerInput < (1 << SHOT_COUNT_BITS), "MaxShotsPerInput doesn't fit in SHOT_COUNT_BITS anymore");
+
+/**
+ * What every RPC costs on top of its parameters (function handle, parameter flags, bunch header), the same for both ways of sending.
+ * One reliable Server_Fire per shot sent a FVector_NetQuantize, a FVector_NetQuantizeNormal (3 x 16 bit) and the fire time.
+ */
+static const int32 RPC_OVERHEAD_BITS = 4 * 8;
+static const int32 LEGACY_SHOT_BITS = 3 * 16 + 32;
+
+/** Counters for hm.FireInput.Stats, since the last call. */
+static uint64 s_NumRPCs = 0;
+static uint64 s_NumShots = 0;
+static uint64 s_NumShotsSent = 0;
+static uint64 s_Bits = 0;
+static uint64 s_LegacyBits = 0;
+static double s_StatsStartTime = 0.0;
+
+bool FHMFireInput::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 bTrigger = bTriggerDown ? 1 : 0;
+	FHMBitPacking::SerializeUnsigned(Ar, bTrigger, 1);
+	bTriggerDown = bTrigger != 0;
+
+	uint32 ShotId = FirstShotId;
+	FHMBitPacking::SerializeUnsigned(Ar, ShotId, SHOT_ID_BITS);
+	FirstShotId = static_cast<uint16>(ShotId);
+
+	uint32 NumShots = FMath::Min(Shots.Num(), MaxShotsPerInput);
+	FHMBitPacking::SerializeUnsigned(Ar, NumShots, SHOT_COUNT_BITS);
+
+	if (Ar.IsLoading())
+	{
+		Shots.SetNum(NumShots);
+	}
+
+	int32 Bits = 1 + SHOT_ID_BITS + SHOT_COUNT_BITS;
+	int32 LegacyBits = 0;
+
+	if (NumShots > 0)
+	{
+		float BaseTime = Shots[0].FireTime;
+		Ar << BaseTime;
+
+		FVector PreviousOrigin = Shots[0].Origin;
+		FHMBitPacking::SerializeLocation(Ar, PreviousOrigin, BASE_ORIGIN_BITS);
+
+		Bits += FIRE_TIME_BITS + 3 * BASE_ORIGIN_BITS;
+
+		for (uint32 Index = 0; Index < NumShots; ++Index)
+		{
+			FHMFireInputShot& Shot = Shots[Index];
+
+			// Fire time, the shots are in order so it's a small positive delta
+			if (Index > 0)
+			{
+				uint32 TimeDelta = FMath::Clamp(FMath::RoundToInt((Shot.FireTime - BaseTime) * 1000.0f), 0, (1 << TIME_DELTA_BITS) - 1);
+				FHMBitPacking::SerializeUnsigned(Ar, TimeDelta, TIME_DELTA_BITS);
+				Shot.FireTime = BaseTime + TimeDelta / 1000.0f;
+			}
+			else
+			{
+				Shot.FireTime = BaseTime;
+			}
+
+			// Origin, delta encoded from the previous shot - usually the shooter hasn't moved
+			FVector Delta = Ar.IsSaving() ? Shot.Origin - PreviousOrigin : FVector::ZeroVector;
+
+			uint32 bMoved = Ar.IsSaving() && !Delta.Equals(FVector::ZeroVector, 0.5f) ? 1 : 0;
+			FHMBitPacking::SerializeUnsigned(Ar, bMoved, 1);
+
+			if (bMoved)
+			{
+				FHMBitPacking::SerializeLocation(Ar, Delta, ORIGIN_DELTA_BITS);
+			}
+
+			Shot.Origin = PreviousOrigin + (bMoved ? Delta : FVector::ZeroVector);
+			PreviousOrigin = Shot.Origin;
+
+			// Aim as yaw and pitch
+			const FRotator Rotation = Ar.IsSaving() ? Shot.Direction.Rotation() : FRotator::ZeroRotator;
+
+			uint32 Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+			uint32 Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+			FHMBitPacking::SerializeUnsigned(Ar, Yaw, ANGLE_BITS);
+			FHMBitPacking::SerializeUnsigned(Ar, Pitch, ANGLE_BITS);
+
+			Shot.Direction = FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.0f).Vector();
+
+			if (Ar.IsSaving())
+			{
+				Bits += (Index > 0 ? TIME_DELTA_BITS : 0) + 1 + (bMoved ? 3 * ORIGIN_DELTA_BITS : 0) + 2 * ANGLE_BITS;
+
+				// Only the new shots would have been sent before, the resent ones had their own RPC already
+				if (static_cast<int32>(Index) >= static_cast<int32>(NumShots) - NumNewShots)
+				{
+					LegacyBits += RPC_OVERHEAD_BITS + FHMBitPacking::GetNetQuantizeBits(Shot.Origin) + LEGACY_SHOT_BITS;
+				}
+			}
+		}
+	}
+
+	if (Ar.IsSaving())
+	{
+		Bits += RPC_OVERHEAD_BITS;
+
+		++s_NumRPCs;
+		s_NumShots += FMath::Min(NumNewShots, static_cast<int32>(NumShots));
+		s_NumShotsSent += NumShots;
+		s_Bits += Bits;
+		s_LegacyBits += LegacyBits;
+
+		INC_DWORD_STAT(STAT_HMFireInputRPCs);
+		INC_DWORD_STAT_BY(STAT_HMFireInputBits, Bits);
+		INC_DWORD_STAT_BY(STAT_HMFireInputLegacyBits, LegacyBits);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+void FHMFireInput::CountUnbatchedShot(const FVector& Origin)
+{
+	// The shot id that came with the shot acks (AHMWeaponBase::PredictShot)
+	const int32 Bits = RPC_OVERHEAD_BITS + FHMBitPacking::GetNetQuantizeBits(Origin) + LEGACY_SHOT_BITS + SHOT_ID_BITS;
+
+	++s_NumRPCs;
+	++s_NumShots;
+	++s_NumShotsSent;
+	s_Bits += Bits;
+	s_LegacyBits += Bits - SHOT_ID_BITS;
+
+	INC_DWORD_STAT(STAT_HMFireInputRPCs);
+	INC_DWORD_STAT_BY(STAT_HMFireInputBits, Bits);
+	INC_DWORD_STAT_BY(STAT_HMFireInputLegacyBits, Bits - SHOT_ID_BITS);
+}
+
+void FHMFireInput::DumpStats()
+{
+	const double Now = FPlatformTime::Seconds();
+	const double Seconds = s_StatsStartTime > 0.0 ? FMath::Max(Now - s_StatsStartTime, 0.001) : 0.0;
+
+	UE_LOG(LogHordeMode, Log, TEXT("Fire input (batching %s, redundancy %d): %llu shots in %llu RPCs (%llu shots sent with resends), %llu bytes, one RPC per shot would be %llu RPCs and %llu bytes"),
+		IsBatchingEnabled() ? TEXT("on") : TEXT("off"), GetRedundancy(), s_NumShots, s_NumRPCs, s_NumShotsSent, s_Bits / 8, s_NumShots, s_LegacyBits / 8);
+
+	if (Seconds > 0.0)
+	{
+		UE_LOG(LogHordeMode, Log, TEXT("  Over %.1fs: %.1f RPCs/s and %.0f bytes/s, one RPC per shot %.1f RPCs/s and %.0f bytes/s"),
+			Seconds, s_NumRPCs / Seconds, s_Bits / 8.0 / Seconds, s_NumShots / Seconds, s_LegacyBits / 8.0 / Seconds);
+	}
+
+	s_NumRPCs = 0;
+	s_NumShots = 0;
+	s_NumShotsSent = 0;
+	s_Bits = 0;
+	s_LegacyBits = 0;
+	s_StatsStartTime = Now;
+}
+
+bool FHMFireInput::IsBatchingEnabled()
+{
+	return CVarFireInputBatching.GetValueOnGameThread() != 0;
+}
+
+int32 FHMFireInput::GetRedundancy()
+{
+	return FMath::Clamp(CVarFireInputRedundancy.GetValueOnGameThread(), 1, 8);
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Net/HMPushModel.h"
+#include "Base/HMCharacterBase.h"
+#include "HordeMode.h"
+
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Push Model Dirty Marks"), STAT_HMPushModelDirtyMarks, STATGROUP_HordeMode);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdPushModelStats(
+	TEXT("hm.PushModel.Stats"),
+	TEXT("Log the property comparisons per frame push model saves on the server and the dirty marks since the last call. Usage: hm.PushModel.Stats [Characters=300]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		FHMPushModelStats::DumpStats(World, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 300);
+	}));
+
+/** Dirty marks since the last DumpStats and the frame the count started at. */
+static uint64 s_NumDirtyMarks = 0;
+static uint64 s_DirtyMarksStartFrame = 0;
+
+#if !HM_WITH_PUSH_MODEL
+/** The properties registered with HM_DOREPLIFETIME_*_PUSH. */
+static TSet<const UProperty*> s_PushProperties;
+#endif
+
+void FHMPushModelStats::RegisterPushProperty(UClass* Class, FName PropertyName)
+{
+#if !HM_WITH_PUSH_MODEL
+	if (const UProperty* const Property = FindField<UProperty>(Class, PropertyName))
+	{
+		s_PushProperties.Add(Property);
+	}
+#endif
+}
+
+/** The number of push model properties of Class, from the properties its GetLifetimeReplicatedProps registers. */
+static int32 GetNumPushProperties(UClass* Class)
+{
+	Class->SetUpRuntimeReplicationData();
+
+	TArray<FLifetimeProperty> LifetimeProps;
+	Class->GetDefaultObject()->GetLifetimeReplicatedProps(LifetimeProps);
+
+	int32 NumProperties = 0;
+	for (const FLifetimeProperty& LifetimeProp : LifetimeProps)
+	{
+#if HM_WITH_PUSH_MODEL
+		NumProperties += LifetimeProp.bIsPushBased ? 1 : 0;
+#else
+		NumProperties += Class->ClassReps.IsValidIndex(LifetimeProp.RepIndex) && s_PushProperties.Contains(Class->ClassReps[LifetimeProp.RepIndex].Property) ? 1 : 0;
+#endif
+	}
+
+	return NumProperties;
+}
+
+void FHMPushModelStats::AddDirtyMark()
+{
+	INC_DWORD_STAT(STAT_HMPushModelDirtyMarks);
+	++s_NumDirtyMarks;
+}
+
+void FHMPushModelStats::DumpStats(UWorld* World, int32 NumCharacters)
+{
+	if (World == nullptr || World->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	const UNetDriver* const NetDriver = World->GetNetDriver();
+	const float ServerTickRate = NetDriver ? NetDriver->NetServerMaxTickRate : 30.0f;
+
+	// Without push model every push property of an awake actor is compared each time the actor is considered for replication
+	int32 NumActors = 0;
+	int32 NumProperties = 0;
+	float ComparesPerFrame = 0.0f;
+
+	int32 NumMeasuredCharacters = 0;
+	float CharacterComparesPerFrame = 0.0f;
+
+	TMap<UClass*, int32> ClassNumProperties;
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		const AActor* const Actor = *It;
+		if (!Actor->GetIsReplicated() || Actor->NetDormancy > DORM_Awake)
+		{
+			continue;
+		}
+
+		UClass* const Class = Actor->GetClass();
+		const int32* const CachedNumProperties = ClassNumProperties.Find(Class);
+		const int32 NumActorProperties = CachedNumProperties ? *CachedNumProperties : ClassNumProperties.Add(Class, GetNumPushProperties(Class));
+		if (NumActorProperties == 0)
+		{
+			continue;
+		}
+
+		const float Compares = NumActorProperties * FMath::Min(Actor->NetUpdateFrequency / ServerTickRate, 1.0f);
+
+		++NumActors;
+		NumProperties += NumActorProperties;
+		ComparesPerFrame += Compares;
+
+		if (Actor->IsA<AHMCharacterBase>())
+		{
+			++NumMeasuredCharacters;
+			CharacterComparesPerFrame += Compares;
+		}
+	}
+
+	const uint64 NumFrames = FMath::Max<uint64>(GFrameCounter - s_DirtyMarksStartFrame, 1);
+	const float MarksPerFrame = (float)s_NumDirtyMarks / NumFrames;
+
+	UE_LOG(LogHordeMode, Log, TEXT("Push model: %s, %d awake actors with %d push properties (%d characters)"),
+		HM_WITH_PUSH_MODEL ? TEXT("compiled in") : TEXT("not available (4.24), numbers are what it would save"), NumActors, NumProperties, NumMeasuredCharacters);
+	UE_LOG(LogHordeMode, Log, TEXT("  %.1f property comparisons per frame without push model, %.2f dirty marks per frame over the last %llu frames"),
+		ComparesPerFrame, MarksPerFrame, NumFrames);
+
+	if (NumCharacters > 0)
+	{
+		// Characters that aren't spawned yet replicate like the default character
+		const float ComparesPerCharacter = NumMeasuredCharacters > 0 ? CharacterComparesPerFrame / NumMeasuredCharacters
+			: FMath::Min(GetDefault<AHMCharacterBase>()->NetUpdateFrequency / ServerTickRate, 1.0f);
+
+		UE_LOG(LogHordeMode, Log, TEXT("  At %d characters: %.1f health comparisons per frame removed"), NumCharacters, ComparesPerCharacter * NumCharacters);
+	}
+
+	s_NumDirtyMarks = 0;
+	s_DirtyMarksStartFrame = GFrameCounter;
+}
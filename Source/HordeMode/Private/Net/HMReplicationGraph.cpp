@@ -0,0 +1,267 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Net/HMReplicationGraph.h"
+#include "AI/HMAICharacterBase.h"
+#include "Actors/HMDoorActor.h"
+#include "Base/HMGameStateBase.h"
+#include "Base/HMWeaponBase.h"
+#include "Player/HMPlayerCharacter.h"
+#include "Player/HMPlayerState.h"
+#include "HordeMode.h"
+
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+static FAutoConsoleCommandWithWorld CmdRepGraphStats(
+	TEXT("hm.RepGraph.Stats"),
+	TEXT("Log how many actors UHMReplicationGraph has in each node (server)."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UNetDriver* const NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (const UHMReplicationGraph* const RepGraph = NetDriver ? Cast<UHMReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+		{
+			RepGraph->DumpStats();
+		}
+		else
+		{
+			UE_LOG(LogHordeMode, Log, TEXT("The net driver doesn't use UHMReplicationGraph."));
+		}
+	}));
+
+UHMReplicationGraph::UHMReplicationGraph() : m_GridCellSize(10000.0f), m_GridSpatialBias(-150000.0f, -200000.0f), m_GridNode(nullptr), m_AlwaysRelevantNode(nullptr),
+	m_NumOwnedWeapons(0)
+{
+	FMemory::Memzero(m_NumRouted);
+}
+
+void UHMReplicationGraph::ResetGameWorldState()
+{
+	Super::ResetGameWorldState();
+
+	m_UnownedWeapons.Reset();
+}
+
+EHMClassRepNodeMapping UHMReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	const AActor* const ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+	if (ActorCDO == nullptr || !ActorCDO->GetIsReplicated())
+	{
+		return EHMClassRepNodeMapping::NotRouted;
+	}
+
+	// The connection's own node gathers its player controller and pawn
+	if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		return EHMClassRepNodeMapping::NotRouted;
+	}
+
+	if (ActorCDO->bAlwaysRelevant)
+	{
+		return EHMClassRepNodeMapping::RelevantAllConnections;
+	}
+
+	return ActorCDO->IsReplicatingMovement() ? EHMClassRepNodeMapping::Spatialize_Dynamic : EHMClassRepNodeMapping::Spatialize_Static;
+}
+
+void UHMReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize) const
+{
+	const AActor* const ActorCDO = Class->GetDefaultObject<AActor>();
+
+	if (bSpatialize)
+	{
+		Info.CullDistanceSquared = ActorCDO->NetCullDistanceSquared;
+	}
+
+	Info.ReplicationPeriodFrame = FMath::Max<uint32>((uint32)FMath::RoundToFloat(NetDriver->NetServerMaxTickRate / ActorCDO->NetUpdateFrequency), 1);
+}
+
+void UHMReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	m_ClassRepNodePolicies.Set(AHMAICharacterBase::StaticClass(), EHMClassRepNodeMapping::Spatialize_Dynamic);
+	m_ClassRepNodePolicies.Set(AHMPlayerCharacter::StaticClass(), EHMClassRepNodeMapping::Spatialize_Dynamic);
+	m_ClassRepNodePolicies.Set(AHMPlayerState::StaticClass(), EHMClassRepNodeMapping::RelevantAllConnections);
+	m_ClassRepNodePolicies.Set(AHMGameStateBase::StaticClass(), EHMClassRepNodeMapping::RelevantAllConnections);
+	m_ClassRepNodePolicies.Set(AHMDoorActor::StaticClass(), EHMClassRepNodeMapping::Spatialize_Dormancy);
+	m_ClassRepNodePolicies.Set(AHMWeaponBase::StaticClass(), EHMClassRepNodeMapping::NotRouted);
+	m_ClassRepNodePolicies.Set(APlayerController::StaticClass(), EHMClassRepNodeMapping::NotRouted);
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* const Class = *It;
+
+		const AActor* const ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (ActorCDO == nullptr || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+
+		// Blueprint compile leftovers
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		const EHMClassRepNodeMapping* const ExplicitPolicy = m_ClassRepNodePolicies.Get(Class);
+		const EHMClassRepNodeMapping Policy = ExplicitPolicy ? *ExplicitPolicy : GetMappingPolicy(Class);
+		m_ClassRepNodePolicies.Set(Class, Policy);
+
+		const bool bSpatialize = Policy == EHMClassRepNodeMapping::Spatialize_Static || Policy == EHMClassRepNodeMapping::Spatialize_Dynamic
+			|| Policy == EHMClassRepNodeMapping::Spatialize_Dormancy;
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ClassInfo, Class, bSpatialize);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+void UHMReplicationGraph::InitGlobalGraphNodes()
+{
+	m_GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	m_GridNode->CellSize = m_GridCellSize;
+	m_GridNode->SpatialBias = m_GridSpatialBias;
+	AddGlobalGraphNode(m_GridNode);
+
+	m_AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(m_AlwaysRelevantNode);
+}
+
+void UHMReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// The connection's player controller, pawn and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* const AlwaysRelevantForConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+}
+
+void UHMReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	if (ActorInfo.Actor->IsA<AHMWeaponBase>())
+	{
+		AddWeapon(ActorInfo.Actor, ActorInfo.Actor->GetOwner(), GlobalInfo);
+		return;
+	}
+
+	// Classes that were loaded after InitGlobalActorClassSettings
+	const EHMClassRepNodeMapping* const ExplicitPolicy = m_ClassRepNodePolicies.Get(ActorInfo.Class);
+	const EHMClassRepNodeMapping Policy = ExplicitPolicy ? *ExplicitPolicy : GetMappingPolicy(ActorInfo.Class);
+	if (ExplicitPolicy == nullptr)
+	{
+		m_ClassRepNodePolicies.Set(ActorInfo.Class, Policy);
+	}
+
+	switch (Policy)
+	{
+	case EHMClassRepNodeMapping::NotRouted:
+		break;
+	case EHMClassRepNodeMapping::RelevantAllConnections:
+		m_AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EHMClassRepNodeMapping::Spatialize_Static:
+		m_GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EHMClassRepNodeMapping::Spatialize_Dynamic:
+		m_GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EHMClassRepNodeMapping::Spatialize_Dormancy:
+		m_GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	}
+
+	++m_NumRouted[(int32)Policy];
+}
+
+void UHMReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	if (ActorInfo.Actor->IsA<AHMWeaponBase>())
+	{
+		RemoveWeapon(ActorInfo.Actor, ActorInfo.Actor->GetOwner());
+		return;
+	}
+
+	const EHMClassRepNodeMapping* const ExplicitPolicy = m_ClassRepNodePolicies.Get(ActorInfo.Class);
+	const EHMClassRepNodeMapping Policy = ExplicitPolicy ? *ExplicitPolicy : GetMappingPolicy(ActorInfo.Class);
+
+	switch (Policy)
+	{
+	case EHMClassRepNodeMapping::NotRouted:
+		break;
+	case EHMClassRepNodeMapping::RelevantAllConnections:
+		m_AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EHMClassRepNodeMapping::Spatialize_Static:
+		m_GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EHMClassRepNodeMapping::Spatialize_Dynamic:
+		m_GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EHMClassRepNodeMapping::Spatialize_Dormancy:
+		m_GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	}
+
+	--m_NumRouted[(int32)Policy];
+}
+
+void UHMReplicationGraph::AddWeapon(AActor* Weapon, AActor* Owner, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	if (Owner == nullptr)
+	{
+		// A weapon lying around is relevant by where it is
+		m_UnownedWeapons.Add(Weapon);
+		m_GridNode->AddActor_Dynamic(FNewReplicatedActorInfo(Weapon), GlobalInfo);
+		return;
+	}
+
+	// Replicated whenever the owner is, the weapon's own relevancy is never checked
+	FGlobalActorReplicationInfo& OwnerInfo = GlobalActorReplicationInfoMap.Get(Owner);
+	OwnerInfo.DependentActorList.PrepareForWrite();
+	OwnerInfo.DependentActorList.ConditionalAdd(Weapon);
+	++m_NumOwnedWeapons;
+}
+
+void UHMReplicationGraph::RemoveWeapon(AActor* Weapon, AActor* Owner)
+{
+	if (m_UnownedWeapons.Remove(Weapon) > 0)
+	{
+		m_GridNode->RemoveActor_Dynamic(FNewReplicatedActorInfo(Weapon));
+		return;
+	}
+
+	if (Owner != nullptr)
+	{
+		if (FGlobalActorReplicationInfo* const OwnerInfo = GlobalActorReplicationInfoMap.Find(Owner))
+		{
+			OwnerInfo->DependentActorList.Remove(Weapon);
+		}
+
+		--m_NumOwnedWeapons;
+	}
+}
+
+void UHMReplicationGraph::NotifyWeaponOwnerChanged(AActor* Weapon, AActor* OldOwner)
+{
+	UNetDriver* const Driver = Weapon ? Weapon->GetNetDriver() : nullptr;
+	UHMReplicationGraph* const RepGraph = Driver ? Cast<UHMReplicationGraph>(Driver->GetReplicationDriver()) : nullptr;
+	if (RepGraph == nullptr || Weapon->GetOwner() == OldOwner)
+	{
+		return;
+	}
+
+	RepGraph->RemoveWeapon(Weapon, OldOwner);
+	RepGraph->AddWeapon(Weapon, Weapon->GetOwner(), RepGraph->GlobalActorReplicationInfoMap.Get(Weapon));
+}
+
+void UHMReplicationGraph::DumpStats() const
+{
+	UE_LOG(LogHordeMode, Log, TEXT("Replication graph: %d spatialized dynamic, %d static, %d dormancy, %d always relevant, %d not routed, %d weapons with their owner, %d weapons in the grid, %d connections"),
+		m_NumRouted[(int32)EHMClassRepNodeMapping::Spatialize_Dynamic], m_NumRouted[(int32)EHMClassRepNodeMapping::Spatialize_Static],
+		m_NumRouted[(int32)EHMClassRepNodeMapping::Spatialize_Dormancy], m_NumRouted[(int32)EHMClassRepNodeMapping::RelevantAllConnections],
+		m_NumRouted[(int32)EHMClassRepNodeMapping::NotRouted], m_NumOwnedWeapons, m_UnownedWeapons.Num(), Connections.Num());
+}
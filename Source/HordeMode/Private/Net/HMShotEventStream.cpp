@@ -0,0 +1,146 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Net/HMShotEventStream.h"
+#include "Net/HMBitPacking.h"
+#include "HordeMode.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Events Sent"), STAT_HMShotEventsSent, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Event Bits"), STAT_HMShotEventBits, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Event Bits (FHitScanTrace estimate)"), STAT_HMShotEventLegacyBits, STATGROUP_HordeMode);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Shot Event Bytes/Shot"), STAT_HMShotEventBytesPerShot, STATGROUP_HordeMode);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Shot Event Bytes/Shot (FHitScanTrace estimate)"), STAT_HMShotEventLegacyBytesPerShot, STATGROUP_HordeMode);
+
+/** Bit widths of the wire format, see FHMShotEventStream. */
+static const int32 SHOT_ID_BITS = 16;
+static const int32 SHOT_COUNT_BITS = 8;
+static const int32 BASE_ORIGIN_BITS = 24;
+static const int32 ORIGIN_DELTA_BITS = 12;
+static const int32 ANGLE_BITS = 16;
+static const int32 SURFACE_BITS = 6;
+static const int32 DISTANCE_BITS = 16;
+
+/**
+ * The old approach sent one FHitScanTrace property update per shot: the surface byte, the FVector_NetQuantize
+ * (5 bit size + 3 components) and the rep layout handles of the two changed members plus the terminating handle.
+ */
+static const int32 LEGACY_HANDLE_BITS = 3 * 8;
+
+static_assert(SurfaceType_Max <= (1 << SURFACE_BITS), "EPhysicalSurface doesn't fit in SURFACE_BITS anymore");
+
+bool FHMShotEventStream::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 ShotId = FirstShotId;
+	FHMBitPacking::SerializeUnsigned(Ar, ShotId, SHOT_ID_BITS);
+	FirstShotId = static_cast<uint16>(ShotId);
+
+	uint32 NumShots = FMath::Min(Shots.Num(), MaxShotsPerUpdate);
+	FHMBitPacking::SerializeUnsigned(Ar, NumShots, SHOT_COUNT_BITS);
+
+	if (Ar.IsLoading())
+	{
+		Shots.SetNum(NumShots);
+	}
+
+	if (NumShots == 0)
+	{
+		bOutSuccess = true;
+		return true;
+	}
+
+	FVector PreviousOrigin = Shots[0].Origin;
+	FHMBitPacking::SerializeLocation(Ar, PreviousOrigin, BASE_ORIGIN_BITS);
+
+	int32 Bits = SHOT_ID_BITS + SHOT_COUNT_BITS + 3 * BASE_ORIGIN_BITS;
+	int32 LegacyBits = 0;
+
+	for (uint32 Index = 0; Index < NumShots; ++Index)
+	{
+		// Quantized into a copy, saving must not change the shots that are still being replicated
+		FHMShotEvent Shot = Ar.IsSaving() ? Shots[Index] : FHMShotEvent();
+
+		// Origin, delta encoded from the previous shot - usually the shooter hasn't moved
+		FVector Delta = Ar.IsSaving() ? Shot.Origin - PreviousOrigin : FVector::ZeroVector;
+
+		uint32 bMoved = Ar.IsSaving() && !Delta.Equals(FVector::ZeroVector, 0.5f) ? 1 : 0;
+		FHMBitPacking::SerializeUnsigned(Ar, bMoved, 1);
+
+		// A delta that doesn't fit (teleported, respawned) sends the full origin instead of a clamped one
+		uint32 bFullOrigin = 0;
+		if (bMoved)
+		{
+			bFullOrigin = Ar.IsSaving() && !FHMBitPacking::FitsLocation(Delta, ORIGIN_DELTA_BITS) ? 1 : 0;
+			FHMBitPacking::SerializeUnsigned(Ar, bFullOrigin, 1);
+
+			if (bFullOrigin)
+			{
+				FHMBitPacking::SerializeLocation(Ar, Shot.Origin, BASE_ORIGIN_BITS);
+			}
+			else
+			{
+				FHMBitPacking::SerializeLocation(Ar, Delta, ORIGIN_DELTA_BITS);
+				Shot.Origin = PreviousOrigin + Delta;
+			}
+		}
+		else
+		{
+			Shot.Origin = PreviousOrigin;
+		}
+
+		PreviousOrigin = Shot.Origin;
+
+		// Direction as yaw and pitch
+		const FRotator Rotation = Ar.IsSaving() ? Shot.Direction.Rotation() : FRotator::ZeroRotator;
+
+		uint32 Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+		uint32 Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+		FHMBitPacking::SerializeUnsigned(Ar, Yaw, ANGLE_BITS);
+		FHMBitPacking::SerializeUnsigned(Ar, Pitch, ANGLE_BITS);
+
+		Shot.Direction = FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.0f).Vector();
+
+		// Hit, surface and distance - a miss always goes the full range
+		uint32 bHit = Shot.bHit ? 1 : 0;
+		FHMBitPacking::SerializeUnsigned(Ar, bHit, 1);
+		Shot.bHit = bHit != 0;
+
+		if (Shot.bHit)
+		{
+			uint32 Surface = Shot.SurfaceType;
+			uint32 Distance = FMath::Clamp(FMath::RoundToInt(Shot.Distance), 0, (1 << DISTANCE_BITS) - 1);
+			FHMBitPacking::SerializeUnsigned(Ar, Surface, SURFACE_BITS);
+			FHMBitPacking::SerializeUnsigned(Ar, Distance, DISTANCE_BITS);
+
+			Shot.SurfaceType = static_cast<EPhysicalSurface>(Surface);
+			Shot.Distance = Distance;
+		}
+
+		if (Ar.IsLoading())
+		{
+			Shots[Index] = Shot;
+		}
+		else
+		{
+			Bits += 1 + (bMoved ? 1 + 3 * (bFullOrigin ? BASE_ORIGIN_BITS : ORIGIN_DELTA_BITS) : 0) + 2 * ANGLE_BITS + 1 + (bHit ? SURFACE_BITS + DISTANCE_BITS : 0);
+			LegacyBits += 8 + FHMBitPacking::GetNetQuantizeBits(Shot.GetEnd()) + LEGACY_HANDLE_BITS;
+		}
+	}
+
+	if (Ar.IsSaving())
+	{
+		INC_DWORD_STAT_BY(STAT_HMShotEventsSent, NumShots);
+		INC_DWORD_STAT_BY(STAT_HMShotEventBits, Bits);
+		INC_DWORD_STAT_BY(STAT_HMShotEventLegacyBits, LegacyBits);
+		SET_FLOAT_STAT(STAT_HMShotEventBytesPerShot, Bits / 8.0f / NumShots);
+		SET_FLOAT_STAT(STAT_HMShotEventLegacyBytesPerShot, LegacyBits / 8.0f / NumShots);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FHMShotEventStream::Identical(const FHMShotEventStream* Other, uint32 PortFlags) const
+{
+	// A new batch of shots always gets a new first id, so that's enough to know if anything changed
+	return Other != nullptr && FirstShotId == Other->FirstShotId && Shots.Num() == Other->Shots.Num();
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Player/HMBotBrain.h"
+#include "Base/HMFirearmBase.h"
+#include "Player/HMPlayerCharacter.h"
+#include "Subsystems/HMSpatialHashSubsystem.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+FHMBotBrain::FHMBotBrain()
+	: AimRange(3000.0f), TurnRate(360.0f), Profile(EBotProfile::None), MoveDirection(FVector::ZeroVector), NextMoveTime(0.0f),
+	bFiring(false), NextFireToggleTime(0.0f), NextInteractTime(0.0f)
+{
+}
+
+EBotProfile FHMBotBrain::GetCommandLineProfile(EBotProfile Default)
+{
+	FString ProfileName;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("HMBotProfile="), ProfileName))
+	{
+		return Default;
+	}
+
+	const int64 CommandLineProfile = StaticEnum<EBotProfile>()->GetValueByNameString(ProfileName);
+	if (CommandLineProfile == INDEX_NONE)
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("Unknown bot profile %s, using %s."), *ProfileName, *StaticEnum<EBotProfile>()->GetNameStringByValue((int64)Default));
+		return Default;
+	}
+
+	return (EBotProfile)CommandLineProfile;
+}
+
+void FHMBotBrain::SetProfile(AController* Controller, EBotProfile NewProfile)
+{
+	if (Profile == NewProfile || Controller == nullptr)
+	{
+		return;
+	}
+
+	SetFiring(Cast<AHMPlayerCharacter>(Controller->GetPawn()), false);
+
+	Profile = NewProfile;
+	Random.Initialize(Controller->GetUniqueID());
+	NextMoveTime = 0.0f;
+	NextFireToggleTime = 0.0f;
+	NextInteractTime = 0.0f;
+
+	if (IsActive())
+	{
+		UE_LOG(LogHordeMode, Log, TEXT("%s is a bot (%s)"), *Controller->GetName(), *StaticEnum<EBotProfile>()->GetNameStringByValue((int64)Profile));
+	}
+}
+
+void FHMBotBrain::SetFiring(AHMPlayerCharacter* Player, bool bNewFiring)
+{
+	if (bFiring == bNewFiring)
+	{
+		return;
+	}
+
+	bFiring = bNewFiring;
+
+	if (Player != nullptr)
+	{
+		if (bNewFiring)
+		{
+			Player->StartAttack();
+		}
+		else
+		{
+			Player->StopAttack();
+		}
+	}
+}
+
+void FHMBotBrain::Tick(AController* Controller, float DeltaTime)
+{
+	if (!IsActive() || Controller == nullptr)
+	{
+		return;
+	}
+
+	AHMPlayerCharacter* const Player = Cast<AHMPlayerCharacter>(Controller->GetPawn());
+	if (Player == nullptr || Player->IsDead())
+	{
+		bFiring = false;
+		return;
+	}
+
+	if (Profile == EBotProfile::Idle)
+	{
+		return;
+	}
+
+	UWorld* const World = Controller->GetWorld();
+	const float Now = World->GetTimeSeconds();
+
+	// Move
+	if (Profile != EBotProfile::FullAuto)
+	{
+		// Pick a new direction every few seconds or when something is in the way
+		if (Now >= NextMoveTime || Player->IsStandingStill())
+		{
+			MoveDirection = FRotator(0.0f, Random.FRandRange(-180.0f, 180.0f), 0.0f).Vector();
+			NextMoveTime = Now + Random.FRandRange(3.0f, 6.0f);
+		}
+
+		Player->AddMovementInput(MoveDirection);
+	}
+
+	// Aim at the nearest zombie, or where the bot walks to
+	const FVector EyeLocation = Player->GetPawnViewLocation();
+
+	const UHMSpatialHashSubsystem* const SpatialHash = World->GetSubsystem<UHMSpatialHashSubsystem>();
+	const AHMCharacterBase* const Target = Profile != EBotProfile::Wander && SpatialHash
+		? SpatialHash->FindNearest(Player->GetActorLocation(), AimRange, UHMSpatialHashSubsystem::GetTeamMask(ETeamType::Enemy)) : nullptr;
+
+	const FRotator DesiredRotation = Target ? (Target->GetActorLocation() - EyeLocation).Rotation() : MoveDirection.Rotation();
+	Controller->SetControlRotation(FMath::RInterpConstantTo(Controller->GetControlRotation(), DesiredRotation, DeltaTime, TurnRate));
+
+	// Fire and reload
+	AHMFirearmBase* const Firearm = Cast<AHMFirearmBase>(Player->GetCurrentWeapon());
+	if (Firearm != nullptr && Profile != EBotProfile::Wander)
+	{
+		if (!Firearm->HasAmmoInMag())
+		{
+			SetFiring(Player, false);
+
+			if (Firearm->CanReload())
+			{
+				Player->StartReload();
+			}
+		}
+		else if (Target == nullptr || Firearm->IsReloading())
+		{
+			SetFiring(Player, false);
+		}
+		else if (Profile == EBotProfile::FullAuto)
+		{
+			if (Firearm->GetFireMode() != EFireMode::FullAuto)
+			{
+				Firearm->ToggleFireMode(EFireMode::FullAuto);
+			}
+
+			SetFiring(Player, true);
+		}
+		else if (Now >= NextFireToggleTime)
+		{
+			// Short bursts with pauses in between
+			SetFiring(Player, !bFiring);
+			NextFireToggleTime = Now + (bFiring ? Random.FRandRange(0.3f, 1.0f) : Random.FRandRange(0.5f, 1.5f));
+		}
+	}
+
+	// Interact with whatever is in front of the bot (doors, buys)
+	if (Profile != EBotProfile::FullAuto && Now >= NextInteractTime)
+	{
+		NextInteractTime = Now + Random.FRandRange(4.0f, 8.0f);
+		Player->Interact();
+	}
+}
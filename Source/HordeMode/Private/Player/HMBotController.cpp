@@ -0,0 +1,39 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Player/HMBotController.h"
+
+#include "GameFramework/Pawn.h"
+
+AHMBotController::AHMBotController(const class FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	bWantsPlayerState = true;
+	bSetControlRotationFromPawnOrientation = false;
+
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AHMBotController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	m_Bot.Tick(this, DeltaTime);
+}
+
+void AHMBotController::GetPlayerViewPoint(FVector& OutLocation, FRotator& OutRotation) const
+{
+	// Pawn view location and control rotation, what AHMFirearmBase::GetShotViewPoint and the significance views expect
+	if (GetPawn() != nullptr)
+	{
+		GetPawn()->GetActorEyesViewPoint(OutLocation, OutRotation);
+	}
+	else
+	{
+		Super::GetPlayerViewPoint(OutLocation, OutRotation);
+	}
+}
+
+void AHMBotController::UpdateControlRotation(float DeltaTime, bool bUpdatePawn)
+{
+	// The character turns to the control rotation by itself (bUseControllerDesiredRotation)
+}
@@ -17,6 +17,7 @@
 #include "Interfaces/Interactable.h"
 #include "Base/HMWeaponBase.h"
 #include "Base/HMFirearmBase.h"
+#include "Net/HMReplicationGraph.h"
 #include "HordeMode.h"
 
 AHMPlayerCharacter::AHMPlayerCharacter(const class FObjectInitializer& ObjectInitializer)
@@ -55,6 +56,7 @@ void AHMPlayerCharacter::BeginPlay()
 		// Spawn a default weapon
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.Owner = this; // So the replication graph replicates it with us right away
 
 		m_CurrentWeapon = GetWorld()->SpawnActor<AHMFirearmBase>(m_StarterWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
 		if (m_CurrentWeapon)
@@ -283,19 +285,18 @@ void AHMPlayerCharacter::ToggleFireMode()
 	{
 		if (AHMFirearmBase* const Firearm = Cast<AHMFirearmBase>(m_CurrentWeapon))
 		{
-			if (Firearm->GetFirearmStats().AllowedFireModes.Num() > 1)
+			const TArray<EFireMode, TInlineAllocator<3>>& AllowedFireModes = Firearm->GetHotStats().AllowedFireModes;
+			if (AllowedFireModes.Num() > 1)
 			{
-				FFirearmStats FirearmStats = Firearm->GetFirearmStats();
-
-				int32 index = FirearmStats.AllowedFireModes.Find(Firearm->GetFireMode());
+				int32 index = AllowedFireModes.Find(Firearm->GetFireMode());
 				int32 idx = 0;
 
-				if (FirearmStats.AllowedFireModes.IsValidIndex(index + 1))
+				if (AllowedFireModes.IsValidIndex(index + 1))
 				{
 					idx = index + 1;
 				}
 
-				EFireMode NewMode = FirearmStats.AllowedFireModes[idx];
+				EFireMode NewMode = AllowedFireModes[idx];
 
 				Firearm->ToggleFireMode(NewMode);
 			}
@@ -369,7 +370,10 @@ void AHMPlayerCharacter::AddWeapon(AHMWeaponBase* NewWeapon)
 {
 	if (IsWeaponLocationAvailable(NewWeapon->GetAttachLocation()))
 	{
+		AActor* const OldOwner = NewWeapon->GetOwner();
 		NewWeapon->SetOwner(this);
+		UHMReplicationGraph::NotifyWeaponOwnerChanged(NewWeapon, OldOwner);
+		NewWeapon->WakeForReplication();
 		NewWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, m_WeaponAttachSocketName);
 
 		m_CurrentWeapon = NewWeapon;
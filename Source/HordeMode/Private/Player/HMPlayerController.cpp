@@ -3,6 +3,46 @@
 
 #include "Player/HMPlayerController.h"
 
+AHMPlayerController::AHMPlayerController(const class FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer), m_ClientBotProfile(EBotProfile::None)
+{
+}
+
+void AHMPlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Net clients launched as bots, server-side bots are AHMBotController
+	if (GetNetMode() == NM_Client && IsLocalPlayerController())
+	{
+		SetBotProfile(FHMBotBrain::GetCommandLineProfile(EBotProfile::None));
+	}
+}
+
+void AHMPlayerController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	m_Bot.Tick(this, DeltaTime);
+}
+
+void AHMPlayerController::SetBotProfile(EBotProfile NewProfile)
+{
+	const EBotProfile OldProfile = m_Bot.GetProfile();
+	m_Bot.SetProfile(this, NewProfile);
+
+	if (GetLocalRole() < ROLE_Authority && m_Bot.GetProfile() != OldProfile)
+	{
+		Server_SetBotProfile(NewProfile);
+	}
+}
+
+bool AHMPlayerController::Server_SetBotProfile_Validate(EBotProfile NewProfile) { return true; }
+void AHMPlayerController::Server_SetBotProfile_Implementation(EBotProfile NewProfile)
+{
+	m_ClientBotProfile = NewProfile;
+}
+
 void AHMPlayerController::RegisterRecoil(float Pitch, float Yaw)
 {
 	AddYawInput(Yaw);
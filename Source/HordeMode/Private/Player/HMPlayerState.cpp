@@ -3,6 +3,8 @@
 
 #include "Player/HMPlayerState.h"
 #include "HMCommon.h"
+#include "Net/HMPushModel.h"
+#include "Subsystems/HMCurrencyLedgerSubsystem.h"
 #include "HordeMode.h"
 
 #include "Net/UnrealNetwork.h"
@@ -17,47 +19,68 @@ void AHMPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLi
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(AHMPlayerState, m_TeamType);
-	DOREPLIFETIME(AHMPlayerState, m_Currency);
-	DOREPLIFETIME(AHMPlayerState, m_Kills);
-	DOREPLIFETIME(AHMPlayerState, m_Deaths);
+	HM_DOREPLIFETIME_PUSH(AHMPlayerState, m_TeamType);
+	HM_DOREPLIFETIME_PUSH(AHMPlayerState, m_Currency);
+	HM_DOREPLIFETIME_PUSH(AHMPlayerState, m_Kills);
+	HM_DOREPLIFETIME_PUSH(AHMPlayerState, m_Deaths);
 }
 
 void AHMPlayerState::Reset()
 {
 	Super::Reset();
 
-	m_Currency = 0;
+	SetCurrency(0);
 	m_Kills = 0;
 	m_Deaths = 0;
+
+	HM_MARK_PROPERTY_DIRTY(AHMPlayerState, m_Kills, this);
+	HM_MARK_PROPERTY_DIRTY(AHMPlayerState, m_Deaths, this);
 }
 
-void AHMPlayerState::AddCurrency(int32 CurrencyToAdd)
+void AHMPlayerState::ChangeTeamType(ETeamType NewTeamType)
 {
-	if (GetLocalRole() < ROLE_Authority)
-	{
-		Server_AddCurrency(CurrencyToAdd);
-	}
+	m_TeamType = NewTeamType;
+	HM_MARK_PROPERTY_DIRTY(AHMPlayerState, m_TeamType, this);
+}
 
-	m_Currency += CurrencyToAdd;
+void AHMPlayerState::AddKill()
+{
+	m_Kills++;
+	HM_MARK_PROPERTY_DIRTY(AHMPlayerState, m_Kills, this);
+}
 
-	OnCharacterCurrencyChange.Broadcast(m_Currency);
+void AHMPlayerState::AddDeath()
+{
+	m_Deaths++;
+	HM_MARK_PROPERTY_DIRTY(AHMPlayerState, m_Deaths, this);
 }
 
-bool AHMPlayerState::Server_AddCurrency_Validate(int32 CurrencyToAdd) { return true; }
-void AHMPlayerState::Server_AddCurrency_Implementation(int32 CurrencyToAdd) { AddCurrency(CurrencyToAdd); }
+void AHMPlayerState::AddCurrency(int32 CurrencyToAdd)
+{
+	if (UHMCurrencyLedgerSubsystem* const Ledger = GetWorld()->GetSubsystem<UHMCurrencyLedgerSubsystem>())
+	{
+		Ledger->AddDelta(this, CurrencyToAdd);
+	}
+}
 
 void AHMPlayerState::SetCurrency(int32 NewCurrency)
 {
-	if (GetLocalRole() < ROLE_Authority)
+	if (UHMCurrencyLedgerSubsystem* const Ledger = GetWorld()->GetSubsystem<UHMCurrencyLedgerSubsystem>())
 	{
-		Server_SetCurrency(NewCurrency);
+		Ledger->AddDelta(this, FMath::Max(NewCurrency, 0) - Ledger->GetBalance(this));
 	}
+}
 
-	m_Currency = FMath::Clamp(m_Currency, 0, NewCurrency);
+void AHMPlayerState::ApplyCurrencyTransaction(int32 NewCurrency)
+{
+	m_Currency.Value = NewCurrency;
+	++m_Currency.Sequence;
+	HM_MARK_PROPERTY_DIRTY(AHMPlayerState, m_Currency, this);
 
-	OnCharacterCurrencyChange.Broadcast(m_Currency);
+	OnCharacterCurrencyChange.Broadcast(m_Currency.Value);
 }
 
-bool AHMPlayerState::Server_SetCurrency_Validate(int32 NewCurrency) { return true;}
-void AHMPlayerState::Server_SetCurrency_Implementation(int32 NewCurrency) { SetCurrency(NewCurrency); }
+void AHMPlayerState::OnRep_Currency()
+{
+	OnCharacterCurrencyChange.Broadcast(m_Currency.Value);
+}
@@ -0,0 +1,248 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMCorpseSubsystem.h"
+#include "AI/HMAICharacterBase.h"
+#include "Subsystems/HMZombiePoolSubsystem.h"
+#include "HordeMode.h"
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Corpses"), STAT_HMCorpses, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Corpses"), STAT_HMNumCorpses, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active Ragdolls"), STAT_HMActiveRagdolls, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdoll Physics Bodies"), STAT_HMRagdollPhysicsBodies, STATGROUP_HordeMode);
+
+static FAutoConsoleCommandWithWorld CmdCorpsesStats(
+	TEXT("hm.Corpses.Stats"),
+	TEXT("Log the number of corpses, simulating ragdolls and their physics bodies."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMCorpseSubsystem* const Corpses = World ? World->GetSubsystem<UHMCorpseSubsystem>() : nullptr)
+		{
+			Corpses->DumpStats();
+		}
+	}));
+
+UHMCorpseSubsystem::UHMCorpseSubsystem() : m_MaxActiveRagdolls(8), m_MaxCorpses(24), m_SettleTime(2.0f), m_SettleSpeed(10.0f), m_MaxSimulateTime(6.0f),
+	m_bInitialized(false), m_NumActiveRagdolls(0), m_NumPhysicsBodies(0), m_NumFrozen(0), m_NumEvicted(0)
+{
+}
+
+void UHMCorpseSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMCorpseSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	SET_DWORD_STAT(STAT_HMNumCorpses, 0);
+	SET_DWORD_STAT(STAT_HMActiveRagdolls, 0);
+	SET_DWORD_STAT(STAT_HMRagdollPhysicsBodies, 0);
+
+	m_Corpses.Empty();
+	m_DeathTimes.Empty();
+	m_Simulating.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMCorpseSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject) && m_Corpses.Num() > 0;
+}
+
+TStatId UHMCorpseSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMCorpseSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMCorpseSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMCorpses);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	m_NumPhysicsBodies = 0;
+
+	for (int32 Index = m_Corpses.Num() - 1; Index >= 0; --Index)
+	{
+		AHMCharacterBase* const Character = m_Corpses[Index].Get();
+
+		if (Character == nullptr)
+		{
+			RemoveCorpse(Index);
+			continue;
+		}
+
+		if (!m_Simulating[Index])
+		{
+			continue;
+		}
+
+		USkeletalMeshComponent* const SkelComp = Character->GetMesh();
+		if (SkelComp == nullptr)
+		{
+			FreezeCorpse(Index);
+			continue;
+		}
+
+		const float Age = Now - m_DeathTimes[Index];
+		if (Age >= m_MaxSimulateTime || (Age >= m_SettleTime && (!SkelComp->RigidBodyIsAwake() || SkelComp->GetPhysicsLinearVelocity().SizeSquared() < FMath::Square(m_SettleSpeed))))
+		{
+			FreezeCorpse(Index);
+			continue;
+		}
+
+		m_NumPhysicsBodies += SkelComp->Bodies.Num();
+	}
+
+	SET_DWORD_STAT(STAT_HMNumCorpses, m_Corpses.Num());
+	SET_DWORD_STAT(STAT_HMActiveRagdolls, m_NumActiveRagdolls);
+	SET_DWORD_STAT(STAT_HMRagdollPhysicsBodies, m_NumPhysicsBodies);
+}
+
+void UHMCorpseSubsystem::AddCorpse(AHMCharacterBase* Character, bool bSimulating)
+{
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	// Never track the same corpse twice
+	RemoveCharacter(Character);
+
+	// Make room for the new ragdoll by freezing the oldest one
+	if (bSimulating && m_NumActiveRagdolls >= m_MaxActiveRagdolls)
+	{
+		for (int32 Index = 0; Index < m_Corpses.Num(); ++Index)
+		{
+			if (m_Simulating[Index])
+			{
+				FreezeCorpse(Index);
+				break;
+			}
+		}
+	}
+
+	// Lazily reserve so levels that nobody dies in don't pay for it
+	if (m_Corpses.Max() == 0)
+	{
+		m_Corpses.Reserve(m_MaxCorpses + 1);
+		m_DeathTimes.Reserve(m_MaxCorpses + 1);
+		m_Simulating.Reserve(m_MaxCorpses + 1);
+	}
+
+	m_Corpses.Add(Character);
+	m_DeathTimes.Add(GetWorld()->GetTimeSeconds());
+	m_Simulating.Add(bSimulating);
+
+	if (bSimulating)
+	{
+		++m_NumActiveRagdolls;
+	}
+
+	while (m_Corpses.Num() > FMath::Max(m_MaxCorpses, 1))
+	{
+		EvictCorpse(0);
+	}
+}
+
+void UHMCorpseSubsystem::FreezeCorpse(int32 Index)
+{
+	if (!m_Simulating[Index])
+	{
+		return;
+	}
+
+	m_Simulating[Index] = false;
+	--m_NumActiveRagdolls;
+	++m_NumFrozen;
+
+	AHMCharacterBase* const Character = m_Corpses[Index].Get();
+	USkeletalMeshComponent* const SkelComp = Character ? Character->GetMesh() : nullptr;
+	if (SkelComp == nullptr)
+	{
+		return;
+	}
+
+	// Keep the last simulated pose, the mesh isn't updated anymore once physics is off
+	SkelComp->bNoSkeletonUpdate = true;
+	SkelComp->SetAllBodiesSimulatePhysics(false);
+	SkelComp->SetSimulatePhysics(false);
+	SkelComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SkelComp->SetComponentTickEnabled(false);
+}
+
+void UHMCorpseSubsystem::EvictCorpse(int32 Index)
+{
+	AHMCharacterBase* const Character = m_Corpses[Index].Get();
+
+	FreezeCorpse(Index);
+	RemoveCorpse(Index);
+
+	++m_NumEvicted;
+
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	if (Character->GetLocalRole() == ROLE_Authority)
+	{
+		AHMAICharacterBase* const Zombie = Cast<AHMAICharacterBase>(Character);
+		UHMZombiePoolSubsystem* const ZombiePool = GetWorld()->GetSubsystem<UHMZombiePoolSubsystem>();
+		if (Zombie != nullptr && Zombie->IsPooled() && ZombiePool != nullptr)
+		{
+			ZombiePool->ReleaseZombie(Zombie);
+		}
+		else
+		{
+			Character->Destroy();
+		}
+	}
+	else if (Character->GetTearOff())
+	{
+		// Torn off corpses belong to this client now
+		Character->Destroy();
+	}
+	else
+	{
+		// The server gets rid of it soon
+		Character->SetActorHiddenInGame(true);
+	}
+}
+
+void UHMCorpseSubsystem::RemoveCharacter(AHMCharacterBase* Character)
+{
+	const int32 Index = m_Corpses.IndexOfByKey(Character);
+	if (Index != INDEX_NONE)
+	{
+		RemoveCorpse(Index);
+	}
+}
+
+void UHMCorpseSubsystem::RemoveCorpse(int32 Index)
+{
+	if (m_Simulating[Index])
+	{
+		--m_NumActiveRagdolls;
+	}
+
+	// Keep the order, the oldest corpses are evicted first
+	m_Corpses.RemoveAt(Index, 1, false);
+	m_DeathTimes.RemoveAt(Index, 1, false);
+	m_Simulating.RemoveAt(Index, 1, false);
+}
+
+void UHMCorpseSubsystem::DumpStats() const
+{
+	UE_LOG(LogHordeMode, Log, TEXT("Corpses: %d (max %d), %d simulating ragdolls (max %d) with %d physics bodies, %d frozen, %d evicted"),
+		m_Corpses.Num(), m_MaxCorpses, m_NumActiveRagdolls, m_MaxActiveRagdolls, m_NumPhysicsBodies, m_NumFrozen, m_NumEvicted);
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMCurrencyLedgerSubsystem.h"
+#include "Player/HMPlayerState.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Currency Ledger"), STAT_HMCurrencyLedger, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Currency Deltas"), STAT_HMCurrencyDeltas, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Currency Transactions"), STAT_HMCurrencyTransactions, STATGROUP_HordeMode);
+
+static FAutoConsoleCommandWithWorld CmdCurrencyStats(
+	TEXT("hm.Currency.Stats"),
+	TEXT("Log the currency deltas, applied transactions and rejected spends so far (server)."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMCurrencyLedgerSubsystem* const Ledger = World ? World->GetSubsystem<UHMCurrencyLedgerSubsystem>() : nullptr)
+		{
+			Ledger->DumpStats();
+		}
+	}));
+
+UHMCurrencyLedgerSubsystem::UHMCurrencyLedgerSubsystem() : m_bInitialized(false), m_NumDeltas(0), m_NumTransactions(0), m_NumRejectedSpends(0)
+{
+}
+
+void UHMCurrencyLedgerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMCurrencyLedgerSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	m_PendingPlayers.Empty();
+	m_PendingDeltas.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMCurrencyLedgerSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject) && m_PendingPlayers.Num() > 0;
+}
+
+TStatId UHMCurrencyLedgerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMCurrencyLedgerSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMCurrencyLedgerSubsystem::Tick(float DeltaTime)
+{
+	Flush();
+}
+
+int32 UHMCurrencyLedgerSubsystem::FindOrAddPending(AHMPlayerState* Player)
+{
+	// Only the players that got paid this frame, a linear search beats hashing
+	for (int32 Index = 0; Index < m_PendingPlayers.Num(); ++Index)
+	{
+		if (m_PendingPlayers[Index].Get() == Player)
+		{
+			return Index;
+		}
+	}
+
+	m_PendingPlayers.Add(Player);
+	return m_PendingDeltas.Add(0);
+}
+
+void UHMCurrencyLedgerSubsystem::AddDelta(AHMPlayerState* Player, int32 Delta)
+{
+	if (Player == nullptr || Delta == 0 || Player->GetLocalRole() < ROLE_Authority)
+	{
+		return;
+	}
+
+	m_PendingDeltas[FindOrAddPending(Player)] += Delta;
+
+	++m_NumDeltas;
+	INC_DWORD_STAT(STAT_HMCurrencyDeltas);
+}
+
+int32 UHMCurrencyLedgerSubsystem::Spend(AHMPlayerState* Player, int32 MaxAmount)
+{
+	if (Player == nullptr || MaxAmount <= 0 || Player->GetLocalRole() < ROLE_Authority)
+	{
+		return 0;
+	}
+
+	const int32 Amount = FMath::Clamp(GetBalance(Player), 0, MaxAmount);
+	if (Amount == 0)
+	{
+		++m_NumRejectedSpends;
+		return 0;
+	}
+
+	AddDelta(Player, -Amount);
+	return Amount;
+}
+
+int32 UHMCurrencyLedgerSubsystem::GetBalance(const AHMPlayerState* Player) const
+{
+	if (Player == nullptr)
+	{
+		return 0;
+	}
+
+	int32 Balance = Player->GetCurrency();
+	for (int32 Index = 0; Index < m_PendingPlayers.Num(); ++Index)
+	{
+		if (m_PendingPlayers[Index].Get() == Player)
+		{
+			Balance += m_PendingDeltas[Index];
+			break;
+		}
+	}
+
+	return FMath::Max(Balance, 0);
+}
+
+void UHMCurrencyLedgerSubsystem::Flush()
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMCurrencyLedger);
+
+	for (int32 Index = 0; Index < m_PendingPlayers.Num(); ++Index)
+	{
+		// Deltas that sum up to 0 (paid and spent in the same frame) are still a transaction
+		if (AHMPlayerState* const Player = m_PendingPlayers[Index].Get())
+		{
+			Player->ApplyCurrencyTransaction(FMath::Max(Player->GetCurrency() + m_PendingDeltas[Index], 0));
+
+			++m_NumTransactions;
+			INC_DWORD_STAT(STAT_HMCurrencyTransactions);
+		}
+	}
+
+	m_PendingPlayers.Reset();
+	m_PendingDeltas.Reset();
+}
+
+void UHMCurrencyLedgerSubsystem::DumpStats() const
+{
+	UE_LOG(LogHordeMode, Log, TEXT("Currency ledger: %d pending players, %d deltas, %d transactions, %d rejected spends"),
+		m_PendingPlayers.Num(), m_NumDeltas, m_NumTransactions, m_NumRejectedSpends);
+}
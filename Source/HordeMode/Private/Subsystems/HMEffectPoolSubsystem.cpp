@@ -0,0 +1,201 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMEffectPoolSubsystem.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effect Pool Components"), STAT_HMEffectPoolComponents, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Hits"), STAT_HMEffectPoolHits, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Misses"), STAT_HMEffectPoolMisses, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Recycled"), STAT_HMEffectPoolRecycled, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Culled"), STAT_HMEffectPoolCulled, STATGROUP_HordeMode);
+
+static FAutoConsoleCommandWithWorld CmdEffectPoolStats(
+	TEXT("hm.EffectPool.Stats"),
+	TEXT("Log the hits/misses (component allocations)/recycles/culls of the effect pool."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMEffectPoolSubsystem* const EffectPool = World ? World->GetSubsystem<UHMEffectPoolSubsystem>() : nullptr)
+		{
+			EffectPool->DumpStats();
+		}
+	}));
+
+UHMEffectPoolSubsystem::UHMEffectPoolSubsystem() : m_MaxActivePerTemplate(32), m_MaxImpactDistance(6000.0f),
+	m_NumHits(0), m_NumMisses(0), m_NumRecycled(0), m_NumCulled(0), m_ViewLocation(FVector::ZeroVector), m_ViewLocationFrame(0), m_bHasViewLocation(false)
+{
+}
+
+void UHMEffectPoolSubsystem::Deinitialize()
+{
+	for (TPair<UParticleSystem*, FHMEffectPool>& Pool : m_Pools)
+	{
+		for (UParticleSystemComponent* const Component : Pool.Value.Free)
+		{
+			if (Component)
+			{
+				Component->DestroyComponent();
+			}
+		}
+
+		for (UParticleSystemComponent* const Component : Pool.Value.Active)
+		{
+			if (Component)
+			{
+				Component->DestroyComponent();
+			}
+		}
+	}
+
+	m_Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+UParticleSystemComponent* UHMEffectPoolSubsystem::AcquireComponent(UParticleSystem* Template)
+{
+	UWorld* const World = GetWorld();
+	if (Template == nullptr || World == nullptr || World->GetNetMode() == NM_DedicatedServer)
+	{
+		return nullptr;
+	}
+
+	FHMEffectPool& Pool = m_Pools.FindOrAdd(Template);
+
+	// Drop components that got destroyed from under us (level streaming etc)
+	Pool.Free.RemoveAll([](const UParticleSystemComponent* Component) { return Component == nullptr || Component->IsPendingKill(); });
+
+	UParticleSystemComponent* Component = nullptr;
+
+	if (Pool.Free.Num() > 0)
+	{
+		Component = Pool.Free.Pop(false);
+
+		++m_NumHits;
+		INC_DWORD_STAT(STAT_HMEffectPoolHits);
+	}
+	else if (Pool.Active.Num() >= m_MaxActivePerTemplate && Pool.Active[0] != nullptr && !Pool.Active[0]->IsPendingKill())
+	{
+		// At the cap, restart the oldest one
+		Component = Pool.Active[0];
+		Pool.Active.RemoveAt(0, 1, false);
+
+		Component->DeactivateImmediate();
+
+		++m_NumRecycled;
+		INC_DWORD_STAT(STAT_HMEffectPoolRecycled);
+	}
+	else
+	{
+		Component = NewObject<UParticleSystemComponent>(World, NAME_None, RF_Transient);
+		Component->bAutoDestroy = false;
+		Component->bAutoActivate = false;
+		Component->SecondsBeforeInactive = 0.0f;
+		Component->SetTemplate(Template);
+		Component->OnSystemFinished.AddDynamic(this, &UHMEffectPoolSubsystem::OnEffectFinished);
+		Component->RegisterComponentWithWorld(World);
+
+		++m_NumMisses;
+		INC_DWORD_STAT(STAT_HMEffectPoolMisses);
+		INC_DWORD_STAT(STAT_HMEffectPoolComponents);
+	}
+
+	Pool.Active.Add(Component);
+
+	return Component;
+}
+
+bool UHMEffectPoolSubsystem::IsInImpactRange(const FVector& Location)
+{
+	// Look the view up once per frame
+	if (m_ViewLocationFrame != GFrameCounter)
+	{
+		m_ViewLocationFrame = GFrameCounter;
+		m_bHasViewLocation = false;
+
+		if (APlayerController* const PC = GetWorld()->GetFirstPlayerController())
+		{
+			FRotator ViewRotation;
+			PC->GetPlayerViewPoint(m_ViewLocation, ViewRotation);
+			m_bHasViewLocation = true;
+		}
+	}
+
+	return !m_bHasViewLocation || FVector::DistSquared(m_ViewLocation, Location) <= FMath::Square(m_MaxImpactDistance);
+}
+
+UParticleSystemComponent* UHMEffectPoolSubsystem::SpawnAtLocation(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation, bool bIsImpact)
+{
+	if (bIsImpact && Template != nullptr && !IsInImpactRange(Location))
+	{
+		++m_NumCulled;
+		INC_DWORD_STAT(STAT_HMEffectPoolCulled);
+		return nullptr;
+	}
+
+	UParticleSystemComponent* const Component = AcquireComponent(Template);
+	if (Component)
+	{
+		Component->SetWorldLocationAndRotation(Location, Rotation);
+		Component->ActivateSystem(true);
+	}
+
+	return Component;
+}
+
+UParticleSystemComponent* UHMEffectPoolSubsystem::SpawnAttached(UParticleSystem* Template, USceneComponent* AttachTo, FName SocketName)
+{
+	if (AttachTo == nullptr)
+	{
+		return nullptr;
+	}
+
+	UParticleSystemComponent* const Component = AcquireComponent(Template);
+	if (Component)
+	{
+		Component->AttachToComponent(AttachTo, FAttachmentTransformRules::SnapToTargetNotIncludingScale, SocketName);
+		Component->ActivateSystem(true);
+	}
+
+	return Component;
+}
+
+void UHMEffectPoolSubsystem::OnEffectFinished(UParticleSystemComponent* Component)
+{
+	if (Component == nullptr)
+	{
+		return;
+	}
+
+	FHMEffectPool* const Pool = m_Pools.Find(Component->Template);
+	if (Pool == nullptr || Pool->Active.Remove(Component) == 0)
+	{
+		// Not ours or already back in the pool
+		return;
+	}
+
+	if (Component->GetAttachParent())
+	{
+		Component->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+
+	Pool->Free.Add(Component);
+}
+
+void UHMEffectPoolSubsystem::DumpStats() const
+{
+	int32 NumComponents = 0;
+	for (const TPair<UParticleSystem*, FHMEffectPool>& Pool : m_Pools)
+	{
+		NumComponents += Pool.Value.Free.Num() + Pool.Value.Active.Num();
+	}
+
+	UE_LOG(LogHordeMode, Log, TEXT("Effect pool: %d templates, %d components, %d hits, %d misses (allocations), %d recycled, %d culled"),
+		m_Pools.Num(), NumComponents, m_NumHits, m_NumMisses, m_NumRecycled, m_NumCulled);
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMFireSchedulerSubsystem.h"
+#include "Base/HMFirearmBase.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Fire Scheduler"), STAT_HMFireScheduler, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scheduled Shots"), STAT_HMScheduledShots, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Skipped Shots (hitch)"), STAT_HMSkippedShots, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Firing Firearms"), STAT_HMFiringFirearms, STATGROUP_HordeMode);
+
+UHMFireSchedulerSubsystem::UHMFireSchedulerSubsystem() : m_MaxCatchUpTime(0.25f), m_bInitialized(false)
+{
+}
+
+void UHMFireSchedulerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMFireSchedulerSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	m_Firearms.Empty();
+	m_NextShotTimes.Empty();
+	m_Intervals.Empty();
+	m_ShotsRemaining.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMFireSchedulerSubsystem::IsTickable() const
+{
+	return m_bInitialized && m_Firearms.Num() > 0 && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMFireSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMFireSchedulerSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMFireSchedulerSubsystem::StartFiring(AHMFirearmBase* Firearm, float TimeBetweenShots, int32 NumShots, float EarliestShotTime)
+{
+	if (Firearm == nullptr || NumShots == 0 || IsFiring(Firearm))
+	{
+		return;
+	}
+
+	m_Firearms.Add(Firearm);
+	m_NextShotTimes.Add(FMath::Max<double>(EarliestShotTime, GetWorld()->GetTimeSeconds()));
+	m_Intervals.Add(FMath::Max(TimeBetweenShots, KINDA_SMALL_NUMBER));
+	m_ShotsRemaining.Add(NumShots);
+
+	INC_DWORD_STAT(STAT_HMFiringFirearms);
+}
+
+void UHMFireSchedulerSubsystem::StopFiring(AHMFirearmBase* Firearm)
+{
+	const int32 Index = m_Firearms.IndexOfByKey(Firearm);
+	if (Index == INDEX_NONE || m_ShotsRemaining[Index] != INDEX_NONE)
+	{
+		// Not firing or finishing a burst
+		return;
+	}
+
+	RemoveAt(Index);
+	Firearm->OnScheduledFireFinished();
+}
+
+void UHMFireSchedulerSubsystem::CancelFiring(AHMFirearmBase* Firearm)
+{
+	const int32 Index = m_Firearms.IndexOfByKey(Firearm);
+	if (Index != INDEX_NONE)
+	{
+		RemoveAt(Index);
+		Firearm->OnScheduledFireFinished();
+	}
+}
+
+void UHMFireSchedulerSubsystem::RemoveAt(int32 Index)
+{
+	m_Firearms.RemoveAtSwap(Index, 1, false);
+	m_NextShotTimes.RemoveAtSwap(Index, 1, false);
+	m_Intervals.RemoveAtSwap(Index, 1, false);
+	m_ShotsRemaining.RemoveAtSwap(Index, 1, false);
+
+	DEC_DWORD_STAT(STAT_HMFiringFirearms);
+}
+
+void UHMFireSchedulerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMFireScheduler);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// Backwards since finished firearms get swapped out
+	for (int32 Index = m_Firearms.Num() - 1; Index >= 0; --Index)
+	{
+		AHMFirearmBase* const Firearm = m_Firearms[Index].Get();
+		if (Firearm == nullptr)
+		{
+			RemoveAt(Index);
+			continue;
+		}
+
+		const float Interval = m_Intervals[Index];
+
+		if (m_NextShotTimes[Index] < Now - m_MaxCatchUpTime)
+		{
+			INC_DWORD_STAT_BY(STAT_HMSkippedShots, FMath::FloorToInt((Now - m_MaxCatchUpTime - m_NextShotTimes[Index]) / Interval));
+			m_NextShotTimes[Index] = Now - m_MaxCatchUpTime;
+		}
+
+		bool bFinished = false;
+		while (m_NextShotTimes[Index] <= Now && m_ShotsRemaining[Index] != 0)
+		{
+			INC_DWORD_STAT(STAT_HMScheduledShots);
+
+			const bool bFired = Firearm->FireScheduledShot(static_cast<float>(Now - m_NextShotTimes[Index]));
+
+			// The shot can cancel the firearm (reloading on an empty mag etc), that already removed it
+			if (!m_Firearms.IsValidIndex(Index) || m_Firearms[Index].Get() != Firearm)
+			{
+				break;
+			}
+
+			if (!bFired)
+			{
+				// Out of ammo, reloading etc
+				bFinished = true;
+				break;
+			}
+
+			m_NextShotTimes[Index] += Interval;
+
+			if (m_ShotsRemaining[Index] > 0)
+			{
+				--m_ShotsRemaining[Index];
+			}
+		}
+
+		if (m_Firearms.IsValidIndex(Index) && m_Firearms[Index].Get() == Firearm && (bFinished || m_ShotsRemaining[Index] == 0))
+		{
+			RemoveAt(Index);
+			Firearm->OnScheduledFireFinished();
+		}
+
+		// This frame's shots go out right away instead of with the firearm's next tick
+		Firearm->FlushFireInput();
+	}
+}
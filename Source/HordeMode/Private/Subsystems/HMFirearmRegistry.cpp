@@ -0,0 +1,117 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMFirearmRegistry.h"
+#include "Base/HMGameStateBase.h"
+#include "HordeMode.h"
+
+#include "Engine/DataTable.h"
+#include "Engine/World.h"
+
+UHMFirearmRegistry::UHMFirearmRegistry() : m_SourceTable(nullptr), m_HitZoneTable(nullptr), m_bBuilt(false)
+{
+}
+
+UHMFirearmRegistry* UHMFirearmRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* const World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+
+	return World ? World->GetSubsystem<UHMFirearmRegistry>() : nullptr;
+}
+
+const FFirearmStats& UHMFirearmRegistry::GetDefaultStats()
+{
+	static const FFirearmStats DefaultStats;
+	return DefaultStats;
+}
+
+const FHMFirearmHotStats& UHMFirearmRegistry::GetDefaultHotStats()
+{
+	static const FHMFirearmHotStats DefaultHotStats(GetDefaultStats());
+	return DefaultHotStats;
+}
+
+const FHMHitZoneTable& UHMFirearmRegistry::GetDefaultHitZones()
+{
+	static const FHMHitZoneTable DefaultHitZones;
+	return DefaultHitZones;
+}
+
+void UHMFirearmRegistry::BuildIfNeeded(const UObject* WorldContextObject)
+{
+	if (m_bBuilt)
+	{
+		return;
+	}
+
+	const UWorld* const World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const AHMGameStateBase* const GameState = World ? World->GetGameState<AHMGameStateBase>() : nullptr;
+	if (GameState == nullptr)
+	{
+		// Try again once the game state is around
+		return;
+	}
+
+	m_bBuilt = true;
+	m_SourceTable = GameState->GetFirearmStatsDataTable();
+
+	m_Stats.Reset();
+	m_HotStats.Reset();
+	m_Indices.Reset();
+
+	m_Stats.Add(GetDefaultStats());
+	m_HotStats.Add(GetDefaultHotStats());
+
+	m_HitZoneTable = GameState->GetHitZoneDataTable();
+	m_HitZones = GetDefaultHitZones();
+	m_HitZones.Build(m_HitZoneTable);
+
+	if (m_SourceTable == nullptr || m_SourceTable->GetRowStruct() == nullptr || !m_SourceTable->GetRowStruct()->IsChildOf(FFirearmStats::StaticStruct()))
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("No firearm stats DataTable set on %s, every firearm uses the default stats."), *GameState->GetName());
+		return;
+	}
+
+	const TMap<FName, uint8*>& RowMap = m_SourceTable->GetRowMap();
+
+	m_Stats.Reserve(RowMap.Num() + 1);
+	m_HotStats.Reserve(RowMap.Num() + 1);
+	m_Indices.Reserve(RowMap.Num());
+
+	for (const TPair<FName, uint8*>& Row : RowMap)
+	{
+		const FFirearmStats& Stats = *reinterpret_cast<const FFirearmStats*>(Row.Value);
+
+		m_Indices.Add(Row.Key, m_Stats.Num());
+		m_Stats.Add(Stats);
+		m_HotStats.Emplace(Stats);
+	}
+}
+
+FHMFirearmHandle UHMFirearmRegistry::FindFirearm(const UObject* WorldContextObject, FName FirearmID)
+{
+	BuildIfNeeded(WorldContextObject);
+
+	if (!m_bBuilt)
+	{
+		return FHMFirearmHandle(0);
+	}
+
+	if (const int32* const Index = m_Indices.Find(FirearmID))
+	{
+		return FHMFirearmHandle(*Index);
+	}
+
+	UE_LOG(LogHordeMode, Warning, TEXT("Firearm '%s' isn't in the firearm stats, using the default stats."), *FirearmID.ToString());
+	return FHMFirearmHandle(0);
+}
+
+const FFirearmStats& UHMFirearmRegistry::GetStats(FHMFirearmHandle Handle) const
+{
+	return m_Stats.IsValidIndex(Handle.Index) ? m_Stats[Handle.Index] : GetDefaultStats();
+}
+
+const FHMFirearmHotStats& UHMFirearmRegistry::GetHotStats(FHMFirearmHandle Handle) const
+{
+	return m_HotStats.IsValidIndex(Handle.Index) ? m_HotStats[Handle.Index] : GetDefaultHotStats();
+}
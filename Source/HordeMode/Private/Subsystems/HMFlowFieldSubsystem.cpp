@@ -0,0 +1,606 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMFlowFieldSubsystem.h"
+#include "Base/HMCharacterBase.h"
+#include "HMHelpers.h"
+#include "HordeMode.h"
+
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+#include "NavigationSystem.h"
+#include "NavMesh/NavMeshBoundsVolume.h"
+
+DECLARE_CYCLE_STAT(TEXT("Flow Field"), STAT_HMFlowField, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Flow Field Build Grid"), STAT_HMFlowFieldBuildGrid, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Flow Field Integrate"), STAT_HMFlowFieldIntegrate, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Flow Field Sample"), STAT_HMFlowFieldSample, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Flow Fields"), STAT_HMFlowFields, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flow Field Cells Integrated"), STAT_HMFlowFieldCellsIntegrated, STATGROUP_HordeMode);
+
+static TAutoConsoleVariable<int32> CVarFlowFieldDebug(
+	TEXT("hm.FlowField.Debug"),
+	0,
+	TEXT("1 = draw the flow towards the first player around the first player."),
+	ECVF_Cheat);
+
+static FAutoConsoleCommandWithWorld CmdFlowFieldStats(
+	TEXT("hm.FlowField.Stats"),
+	TEXT("Log the flow field grid size and the integration/sample counters."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMFlowFieldSubsystem* const FlowField = World ? World->GetSubsystem<UHMFlowFieldSubsystem>() : nullptr)
+		{
+			FlowField->DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CmdFlowFieldRebuild(
+	TEXT("hm.FlowField.Rebuild"),
+	TEXT("Sample the flow field grid from the navmesh again."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMFlowFieldSubsystem* const FlowField = World ? World->GetSubsystem<UHMFlowFieldSubsystem>() : nullptr)
+		{
+			FlowField->Rebuild();
+		}
+	}));
+
+/** E, W, N, S, NE, NW, SE, SW - the first 4 are straight, the rest diagonal. */
+static const int32 NeighbourOffsets[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 } };
+
+/** The neighbour that leads back, index into NeighbourOffsets. */
+static const int32 OppositeNeighbours[8] = { 1, 0, 3, 2, 7, 6, 5, 4 };
+
+/** Path cost of a straight/diagonal step (2:3 is close enough to 1:sqrt(2)). */
+static const uint16 STRAIGHT_STEP_COST = 2;
+static const uint16 DIAGONAL_STEP_COST = 3;
+
+UHMFlowFieldSubsystem::UHMFlowFieldSubsystem() : m_CellSize(100.0f), m_MaxStepHeight(45.0f), m_MaxCellsPerFrame(4096), m_MaxGridCellsPerFrame(256), m_MaxGridSize(512), m_bInitialized(false),
+	m_GridOrigin(FVector::ZeroVector), m_GridHalfHeight(0.0f), m_GridCellSize(100.0f), m_GridSizeX(0), m_GridSizeY(0), m_GridBuildCursor(0), m_bGridCreated(false),
+	m_NextField(0), m_NumIntegrations(0), m_NumRepairs(0), m_NumSamples(0)
+{
+}
+
+void UHMFlowFieldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMFlowFieldSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	DEC_DWORD_STAT_BY(STAT_HMFlowFields, m_Fields.Num());
+
+	m_CellHeights.Empty();
+	m_CellNeighbours.Empty();
+	m_Targets.Empty();
+	m_Fields.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMFlowFieldSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMFlowFieldSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	UWorld* const World = GetWorld();
+	if (World->GetNetMode() == NM_Client || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HMFlowField);
+
+	if (!m_bGridCreated)
+	{
+		m_bGridCreated = true;
+
+		if (!CreateGrid())
+		{
+			UE_LOG(LogHordeMode, Warning, TEXT("The level doesn't have a NavMeshBoundsVolume, zombies can't use the flow field."));
+		}
+	}
+
+	if (!IsGridReady())
+	{
+		BuildGrid(m_MaxGridCellsPerFrame);
+		return;
+	}
+
+	UpdateTargets();
+
+	int32 Budget = m_MaxCellsPerFrame;
+
+	// Round robin so one player that keeps moving can't starve the others
+	if (m_Fields.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_HMFlowFieldIntegrate);
+
+		m_NextField %= m_Fields.Num();
+
+		for (int32 Index = 0; Index < m_Fields.Num() && Budget > 0; ++Index)
+		{
+			FHMFlowField& Field = m_Fields[(m_NextField + Index) % m_Fields.Num()];
+			if (Field.IsIntegrating())
+			{
+				Budget -= IntegrateField(Field, Budget);
+			}
+		}
+
+		++m_NextField;
+	}
+
+#if ENABLE_DRAW_DEBUG
+	if (CVarFlowFieldDebug.GetValueOnGameThread() != 0)
+	{
+		DrawDebug();
+	}
+#endif
+}
+
+bool UHMFlowFieldSubsystem::CreateGrid()
+{
+	FBox Bounds(ForceInit);
+	for (TActorIterator<ANavMeshBoundsVolume> It(GetWorld()); It; ++It)
+	{
+		Bounds += It->GetComponentsBoundingBox(true);
+	}
+
+	if (!Bounds.IsValid)
+	{
+		return false;
+	}
+
+	const FVector Size = Bounds.GetSize();
+
+	// Bigger cells for huge levels
+	m_GridCellSize = FMath::Max3(m_CellSize, Size.X / m_MaxGridSize, Size.Y / m_MaxGridSize);
+	m_GridSizeX = FMath::Max(FMath::CeilToInt(Size.X / m_GridCellSize), 1);
+	m_GridSizeY = FMath::Max(FMath::CeilToInt(Size.Y / m_GridCellSize), 1);
+	m_GridOrigin = FVector(Bounds.Min.X, Bounds.Min.Y, Bounds.GetCenter().Z);
+	m_GridHalfHeight = Size.Z * 0.5f;
+
+	const int32 NumCells = m_GridSizeX * m_GridSizeY;
+	m_CellHeights.Init(MAX_flt, NumCells);
+	m_CellNeighbours.Init(0, NumCells);
+	m_GridBuildCursor = 0;
+
+	UE_LOG(LogHordeMode, Log, TEXT("Flow field grid: %d x %d cells of %.0f"), m_GridSizeX, m_GridSizeY, m_GridCellSize);
+
+	return true;
+}
+
+int32 UHMFlowFieldSubsystem::BuildGrid(int32 Budget)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMFlowFieldBuildGrid);
+
+	UNavigationSystemV1* const NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem == nullptr)
+	{
+		return 0;
+	}
+
+	const int32 NumCells = m_CellNeighbours.Num();
+	const FVector Extent(m_GridCellSize * 0.5f, m_GridCellSize * 0.5f, m_GridHalfHeight);
+
+	int32 NumDone = 0;
+	for (; NumDone < Budget && m_GridBuildCursor < NumCells * 2; ++NumDone, ++m_GridBuildCursor)
+	{
+		if (m_GridBuildCursor >= NumCells)
+		{
+			ConnectCell(m_GridBuildCursor - NumCells);
+			continue;
+		}
+
+		const int32 Cell = m_GridBuildCursor;
+		const FVector Center = m_GridOrigin + FVector(((Cell % m_GridSizeX) + 0.5f) * m_GridCellSize, ((Cell / m_GridSizeX) + 0.5f) * m_GridCellSize, 0.0f);
+
+		FNavLocation NavLocation;
+		if (NavSystem->ProjectPointToNavigation(Center, NavLocation, Extent))
+		{
+			m_CellHeights[Cell] = NavLocation.Location.Z;
+		}
+	}
+
+	if (IsGridReady())
+	{
+		int32 NumWalkable = 0;
+		for (int32 Cell = 0; Cell < NumCells; ++Cell)
+		{
+			NumWalkable += IsCellWalkable(Cell) ? 1 : 0;
+		}
+
+		UE_LOG(LogHordeMode, Log, TEXT("Flow field grid done, %d of %d cells are walkable."), NumWalkable, NumCells);
+	}
+
+	return NumDone;
+}
+
+void UHMFlowFieldSubsystem::ConnectCell(int32 Cell)
+{
+	if (!IsCellWalkable(Cell))
+	{
+		return;
+	}
+
+	const int32 X = Cell % m_GridSizeX;
+	const int32 Y = Cell / m_GridSizeX;
+
+	// Only E, N, NE and NW, the other directions are connected from the neighbour's side
+	static const int32 Directions[] = { 0, 2, 4, 5 };
+	for (const int32 Direction : Directions)
+	{
+		const int32 NeighbourX = X + NeighbourOffsets[Direction][0];
+		const int32 NeighbourY = Y + NeighbourOffsets[Direction][1];
+		if (NeighbourX < 0 || NeighbourX >= m_GridSizeX || NeighbourY < 0 || NeighbourY >= m_GridSizeY)
+		{
+			continue;
+		}
+
+		const int32 Neighbour = NeighbourY * m_GridSizeX + NeighbourX;
+		if (!IsCellWalkable(Neighbour) || FMath::Abs(m_CellHeights[Neighbour] - m_CellHeights[Cell]) > m_MaxStepHeight)
+		{
+			continue;
+		}
+
+		// Don't cut corners
+		if (Direction >= 4 && (!IsCellWalkable(Y * m_GridSizeX + NeighbourX) || !IsCellWalkable(NeighbourY * m_GridSizeX + X)))
+		{
+			continue;
+		}
+
+		// Walls thinner than a cell
+		FVector HitLocation;
+		if (UNavigationSystemV1::NavigationRaycast(GetWorld(), GetCellLocation(Cell), GetCellLocation(Neighbour), HitLocation))
+		{
+			continue;
+		}
+
+		m_CellNeighbours[Cell] |= 1 << Direction;
+		m_CellNeighbours[Neighbour] |= 1 << OppositeNeighbours[Direction];
+	}
+}
+
+void UHMFlowFieldSubsystem::UpdateTargets()
+{
+	TArray<AController*, TInlineAllocator<8>> PlayerControllers;
+	UHMHelpers::GetPlayerControllers(GetWorld(), PlayerControllers);
+
+	TArray<APawn*, TInlineAllocator<8>> Players;
+	for (const AController* const PlayerController : PlayerControllers)
+	{
+		APawn* const Pawn = PlayerController->GetPawn();
+		const AHMCharacterBase* const Character = Cast<AHMCharacterBase>(Pawn);
+		if (Pawn != nullptr && (Character == nullptr || Character->IsAlive()))
+		{
+			Players.Add(Pawn);
+		}
+	}
+
+	// Players that died/left
+	for (int32 Index = m_Targets.Num() - 1; Index >= 0; --Index)
+	{
+		if (!Players.Contains(m_Targets[Index].Get()))
+		{
+			m_Targets.RemoveAtSwap(Index, 1, false);
+			m_Fields.RemoveAtSwap(Index, 1, false);
+			DEC_DWORD_STAT(STAT_HMFlowFields);
+		}
+	}
+
+	for (APawn* const Player : Players)
+	{
+		if (!m_Targets.Contains(Player))
+		{
+			m_Targets.Add(Player);
+			m_Fields.AddDefaulted();
+			INC_DWORD_STAT(STAT_HMFlowFields);
+		}
+	}
+
+	const int32 NumCells = m_CellNeighbours.Num();
+
+	for (int32 Index = 0; Index < m_Targets.Num(); ++Index)
+	{
+		FHMFlowField& Field = m_Fields[Index];
+
+		// Finish the field that is being integrated first, the target gets picked up again once it's done
+		if (Field.IsIntegrating())
+		{
+			continue;
+		}
+
+		const int32 TargetCell = GetWalkableCell(m_Targets[Index]->GetActorLocation());
+		if (TargetCell == INDEX_NONE || TargetCell == Field.TargetCell)
+		{
+			continue;
+		}
+
+		Field.PendingTargetCell = TargetCell;
+
+		// The grid is undirected, so every cell can get to the new target cell through the old one - seed the field with those paths
+		// and only the cells that have a shorter way get relaxed (the side of the grid the target moved to), not the whole grid again
+		const uint16 MoveCost = Field.IsReady() ? Field.Costs[TargetCell] : MAX_uint16;
+		if (MoveCost != MAX_uint16)
+		{
+			Field.PendingCosts.SetNumUninitialized(NumCells, false);
+			for (int32 Cell = 0; Cell < NumCells; ++Cell)
+			{
+				Field.PendingCosts[Cell] = static_cast<uint16>(FMath::Min<int32>(Field.Costs[Cell] + MoveCost, MAX_uint16));
+			}
+
+			++m_NumRepairs;
+		}
+		else
+		{
+			Field.PendingCosts.Init(MAX_uint16, NumCells);
+		}
+
+		Field.PendingCosts[TargetCell] = 0;
+		Field.Open.Reset();
+		Field.Open.HeapPush(TPair<int32, uint16>(TargetCell, 0), [](const TPair<int32, uint16>& A, const TPair<int32, uint16>& B) { return A.Value < B.Value; });
+	}
+}
+
+int32 UHMFlowFieldSubsystem::IntegrateField(FHMFlowField& Field, int32 Budget)
+{
+	auto CostPredicate = [](const TPair<int32, uint16>& A, const TPair<int32, uint16>& B) { return A.Value < B.Value; };
+
+	int32 NumDone = 0;
+	while (NumDone < Budget && Field.Open.Num() > 0)
+	{
+		TPair<int32, uint16> Current;
+		Field.Open.HeapPop(Current, CostPredicate, false);
+
+		// Already reached through a cheaper path
+		if (Current.Value > Field.PendingCosts[Current.Key])
+		{
+			continue;
+		}
+
+		++NumDone;
+
+		const uint8 Neighbours = m_CellNeighbours[Current.Key];
+		for (int32 Direction = 0; Direction < 8; ++Direction)
+		{
+			if ((Neighbours & (1 << Direction)) == 0)
+			{
+				continue;
+			}
+
+			const int32 Neighbour = Current.Key + NeighbourOffsets[Direction][1] * m_GridSizeX + NeighbourOffsets[Direction][0];
+			const int32 Cost = Current.Value + (Direction < 4 ? STRAIGHT_STEP_COST : DIAGONAL_STEP_COST);
+			if (Cost < Field.PendingCosts[Neighbour])
+			{
+				Field.PendingCosts[Neighbour] = static_cast<uint16>(Cost);
+				Field.Open.HeapPush(TPair<int32, uint16>(Neighbour, static_cast<uint16>(Cost)), CostPredicate);
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_HMFlowFieldCellsIntegrated, NumDone);
+
+	if (Field.Open.Num() == 0)
+	{
+		Swap(Field.Costs, Field.PendingCosts);
+		Field.TargetCell = Field.PendingTargetCell;
+		Field.PendingTargetCell = INDEX_NONE;
+
+		++m_NumIntegrations;
+	}
+
+	// Stale entries cost a heap pop too, don't let them run over the budget
+	return FMath::Max(NumDone, 1);
+}
+
+int32 UHMFlowFieldSubsystem::GetCell(const FVector& Location) const
+{
+	const int32 X = FMath::FloorToInt((Location.X - m_GridOrigin.X) / m_GridCellSize);
+	const int32 Y = FMath::FloorToInt((Location.Y - m_GridOrigin.Y) / m_GridCellSize);
+	if (X < 0 || X >= m_GridSizeX || Y < 0 || Y >= m_GridSizeY)
+	{
+		return INDEX_NONE;
+	}
+
+	return Y * m_GridSizeX + X;
+}
+
+int32 UHMFlowFieldSubsystem::GetWalkableCell(const FVector& Location) const
+{
+	const int32 Cell = GetCell(Location);
+	if (Cell == INDEX_NONE || IsCellWalkable(Cell))
+	{
+		return Cell;
+	}
+
+	const int32 X = Cell % m_GridSizeX;
+	const int32 Y = Cell / m_GridSizeX;
+	for (int32 Direction = 0; Direction < 8; ++Direction)
+	{
+		const int32 NeighbourX = X + NeighbourOffsets[Direction][0];
+		const int32 NeighbourY = Y + NeighbourOffsets[Direction][1];
+		if (NeighbourX >= 0 && NeighbourX < m_GridSizeX && NeighbourY >= 0 && NeighbourY < m_GridSizeY && IsCellWalkable(NeighbourY * m_GridSizeX + NeighbourX))
+		{
+			return NeighbourY * m_GridSizeX + NeighbourX;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+FVector UHMFlowFieldSubsystem::GetCellLocation(int32 Cell) const
+{
+	return FVector(m_GridOrigin.X + ((Cell % m_GridSizeX) + 0.5f) * m_GridCellSize, m_GridOrigin.Y + ((Cell / m_GridSizeX) + 0.5f) * m_GridCellSize, m_CellHeights[Cell]);
+}
+
+bool UHMFlowFieldSubsystem::GetSteeringDirection(const FVector& Location, FVector& OutDirection, APawn*& OutTarget)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMFlowFieldSample);
+
+	if (!IsGridReady())
+	{
+		return false;
+	}
+
+	const int32 Cell = GetWalkableCell(Location);
+	if (Cell == INDEX_NONE)
+	{
+		return false;
+	}
+
+	++m_NumSamples;
+
+	// The nearest player by path
+	int32 BestField = INDEX_NONE;
+	uint16 BestCost = MAX_uint16;
+	for (int32 Index = 0; Index < m_Fields.Num(); ++Index)
+	{
+		if (m_Fields[Index].IsReady() && m_Fields[Index].Costs[Cell] < BestCost && m_Targets[Index].IsValid())
+		{
+			BestField = Index;
+			BestCost = m_Fields[Index].Costs[Cell];
+		}
+	}
+
+	if (BestField == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FHMFlowField& Field = m_Fields[BestField];
+	OutTarget = m_Targets[BestField].Get();
+
+	FVector Goal = OutTarget->GetActorLocation();
+
+	// Not in the target's cell yet, head for the neighbour that is closest to it
+	if (BestCost > 0)
+	{
+		const uint8 Neighbours = m_CellNeighbours[Cell];
+		for (int32 Direction = 0; Direction < 8; ++Direction)
+		{
+			if ((Neighbours & (1 << Direction)) == 0)
+			{
+				continue;
+			}
+
+			const int32 Neighbour = Cell + NeighbourOffsets[Direction][1] * m_GridSizeX + NeighbourOffsets[Direction][0];
+			if (Field.Costs[Neighbour] < BestCost)
+			{
+				BestCost = Field.Costs[Neighbour];
+				Goal = GetCellLocation(Neighbour);
+			}
+		}
+	}
+
+	OutDirection = (Goal - Location).GetSafeNormal2D();
+	return true;
+}
+
+void UHMFlowFieldSubsystem::Rebuild()
+{
+	DEC_DWORD_STAT_BY(STAT_HMFlowFields, m_Fields.Num());
+
+	m_bGridCreated = false;
+	m_GridSizeX = 0;
+	m_GridSizeY = 0;
+	m_CellHeights.Reset();
+	m_CellNeighbours.Reset();
+	m_Targets.Reset();
+	m_Fields.Reset();
+}
+
+void UHMFlowFieldSubsystem::DrawDebug() const
+{
+#if ENABLE_DRAW_DEBUG
+	const APlayerController* const PlayerController = GetWorld()->GetFirstPlayerController();
+	const APawn* const Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (Pawn == nullptr || m_Fields.Num() == 0 || !m_Fields[0].IsReady())
+	{
+		return;
+	}
+
+	const int32 Center = GetCell(Pawn->GetActorLocation());
+	if (Center == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FHMFlowField& Field = m_Fields[0];
+	const int32 Radius = 12;
+	const int32 CenterX = Center % m_GridSizeX;
+	const int32 CenterY = Center / m_GridSizeX;
+
+	for (int32 Y = FMath::Max(CenterY - Radius, 0); Y <= FMath::Min(CenterY + Radius, m_GridSizeY - 1); ++Y)
+	{
+		for (int32 X = FMath::Max(CenterX - Radius, 0); X <= FMath::Min(CenterX + Radius, m_GridSizeX - 1); ++X)
+		{
+			const int32 Cell = Y * m_GridSizeX + X;
+			if (!IsCellWalkable(Cell) || Field.Costs[Cell] == MAX_uint16)
+			{
+				continue;
+			}
+
+			int32 BestNeighbour = INDEX_NONE;
+			uint16 BestCost = Field.Costs[Cell];
+			for (int32 Direction = 0; Direction < 8; ++Direction)
+			{
+				if ((m_CellNeighbours[Cell] & (1 << Direction)) == 0)
+				{
+					continue;
+				}
+
+				const int32 Neighbour = Cell + NeighbourOffsets[Direction][1] * m_GridSizeX + NeighbourOffsets[Direction][0];
+				if (Field.Costs[Neighbour] < BestCost)
+				{
+					BestCost = Field.Costs[Neighbour];
+					BestNeighbour = Neighbour;
+				}
+			}
+
+			const FVector Start = GetCellLocation(Cell) + FVector(0.0f, 0.0f, 20.0f);
+			if (BestNeighbour != INDEX_NONE)
+			{
+				DrawDebugDirectionalArrow(GetWorld(), Start, FMath::Lerp(Start, GetCellLocation(BestNeighbour) + FVector(0.0f, 0.0f, 20.0f), 0.5f), 20.0f, FColor::Green, false, -1.0f, 0, 2.0f);
+			}
+			else
+			{
+				DrawDebugPoint(GetWorld(), Start, 8.0f, FColor::Red, false, -1.0f);
+			}
+		}
+	}
+#endif
+}
+
+void UHMFlowFieldSubsystem::DumpStats() const
+{
+	int32 NumWalkable = 0;
+	for (int32 Cell = 0; Cell < m_CellHeights.Num(); ++Cell)
+	{
+		NumWalkable += IsCellWalkable(Cell) ? 1 : 0;
+	}
+
+	int32 NumIntegrating = 0;
+	for (const FHMFlowField& Field : m_Fields)
+	{
+		NumIntegrating += Field.IsIntegrating() ? 1 : 0;
+	}
+
+	UE_LOG(LogHordeMode, Log, TEXT("Flow field: %d x %d cells of %.0f (%d walkable, %s), %d fields (%d integrating), %d integrations (%d repaired), %d samples"),
+		m_GridSizeX, m_GridSizeY, m_GridCellSize, NumWalkable, IsGridReady() ? TEXT("ready") : TEXT("building"),
+		m_Fields.Num(), NumIntegrating, m_NumIntegrations, m_NumRepairs, m_NumSamples);
+}
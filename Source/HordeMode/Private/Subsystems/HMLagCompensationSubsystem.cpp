@@ -0,0 +1,287 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMLagCompensationSubsystem.h"
+#include "Base/HMCharacterBase.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_HMLagCompRecord, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind"), STAT_HMLagCompRewind, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Compensated Shots"), STAT_HMLagCompShots, STATGROUP_HordeMode);
+
+UHMLagCompensationSubsystem::UHMLagCompensationSubsystem() : m_HistoryFrames(64), m_MaxCharacters(512), m_MaxRewindTime(0.4f), m_CapsuleInflation(1.5f),
+	m_bInitialized(false), m_Head(INDEX_NONE), m_NumFrames(0), m_FrameCounter(0), m_NumUsedSlots(0)
+{
+}
+
+void UHMLagCompensationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMLagCompensationSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	Super::Deinitialize();
+}
+
+bool UHMLagCompensationSubsystem::IsTickable() const
+{
+	// Nothing to record until a character registered (which only happens on the server)
+	return m_bInitialized && m_NumUsedSlots > 0 && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMLagCompensationSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	RecordFrame();
+}
+
+void UHMLagCompensationSubsystem::AllocateHistory()
+{
+	m_HistoryFrames = FMath::Max(m_HistoryFrames, 2);
+	m_MaxCharacters = FMath::Max(m_MaxCharacters, 1);
+
+	m_FrameTimes.SetNumZeroed(m_HistoryFrames);
+	m_Positions.SetNumZeroed(m_HistoryFrames * m_MaxCharacters);
+	m_Collidable.SetNumZeroed(m_HistoryFrames * m_MaxCharacters);
+
+	m_Characters.SetNum(m_MaxCharacters);
+	m_Radius.SetNumZeroed(m_MaxCharacters);
+	m_HalfHeight.SetNumZeroed(m_MaxCharacters);
+	m_FirstFrame.SetNumZeroed(m_MaxCharacters);
+
+	m_FreeSlots.Reserve(m_MaxCharacters);
+}
+
+int32 UHMLagCompensationSubsystem::RegisterCharacter(AHMCharacterBase* Character)
+{
+	if (Character == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	if (m_Characters.Num() == 0)
+	{
+		AllocateHistory();
+	}
+
+	int32 Slot = INDEX_NONE;
+	if (m_FreeSlots.Num() > 0)
+	{
+		Slot = m_FreeSlots.Pop(false);
+	}
+	else if (m_NumUsedSlots < m_MaxCharacters)
+	{
+		Slot = m_NumUsedSlots++;
+	}
+	else
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("Lag compensation is full (%d characters), %s won't be compensated."), m_MaxCharacters, *Character->GetName());
+		return INDEX_NONE;
+	}
+
+	m_Characters[Slot] = Character;
+
+	if (UCapsuleComponent* const Capsule = Character->GetCapsuleComponent())
+	{
+		m_Radius[Slot] = Capsule->GetScaledCapsuleRadius();
+		m_HalfHeight[Slot] = Capsule->GetScaledCapsuleHalfHeight();
+	}
+
+	// The slot only has valid history from the next recorded frame on
+	m_FirstFrame[Slot] = m_FrameCounter + 1;
+
+	return Slot;
+}
+
+void UHMLagCompensationSubsystem::UnregisterCharacter(int32 Slot)
+{
+	if (!m_Characters.IsValidIndex(Slot) || !m_Characters[Slot].IsValid())
+	{
+		return;
+	}
+
+	m_Characters[Slot].Reset();
+	m_FreeSlots.Add(Slot);
+}
+
+void UHMLagCompensationSubsystem::RecordFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMLagCompRecord);
+
+	m_Head = (m_Head + 1) % m_HistoryFrames;
+	m_NumFrames = FMath::Min(m_NumFrames + 1, m_HistoryFrames);
+	++m_FrameCounter;
+
+	m_FrameTimes[m_Head] = GetWorld()->GetTimeSeconds();
+
+	FVector* const Positions = &m_Positions[m_Head * m_MaxCharacters];
+	uint8* const Collidable = &m_Collidable[m_Head * m_MaxCharacters];
+
+	for (int32 Slot = 0; Slot < m_NumUsedSlots; ++Slot)
+	{
+		const AHMCharacterBase* const Character = m_Characters[Slot].Get();
+		if (Character == nullptr)
+		{
+			Collidable[Slot] = 0;
+			continue;
+		}
+
+		const UCapsuleComponent* const Capsule = Character->GetCapsuleComponent();
+		Positions[Slot] = Capsule->GetComponentLocation();
+		Collidable[Slot] = Character->IsAlive() && Capsule->IsCollisionEnabled() ? 1 : 0;
+	}
+}
+
+bool UHMLagCompensationSubsystem::FindFrames(float Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha, uint32& OutOlderFrameNumber) const
+{
+	if (m_NumFrames == 0)
+	{
+		return false;
+	}
+
+	// Newer than the newest frame, nothing to rewind
+	if (Time >= m_FrameTimes[m_Head])
+	{
+		OutOlderFrame = OutNewerFrame = m_Head;
+		OutAlpha = 0.0f;
+		OutOlderFrameNumber = m_FrameCounter;
+		return true;
+	}
+
+	int32 Newer = m_Head;
+	for (int32 Age = 1; Age < m_NumFrames; ++Age)
+	{
+		const int32 Older = (m_Head - Age + m_HistoryFrames) % m_HistoryFrames;
+		if (m_FrameTimes[Older] <= Time)
+		{
+			const float FrameDelta = m_FrameTimes[Newer] - m_FrameTimes[Older];
+
+			OutOlderFrame = Older;
+			OutNewerFrame = Newer;
+			OutAlpha = FrameDelta > KINDA_SMALL_NUMBER ? (Time - m_FrameTimes[Older]) / FrameDelta : 0.0f;
+			OutOlderFrameNumber = m_FrameCounter - Age;
+			return true;
+		}
+
+		Newer = Older;
+	}
+
+	// Older than anything in the history
+	return false;
+}
+
+bool UHMLagCompensationSubsystem::RewindTrace(float Time, const FVector& TraceStart, const FVector& TraceEnd, const AActor* IgnoreActor, FHitResult& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMLagCompRewind);
+
+	if (m_NumFrames == 0)
+	{
+		return false;
+	}
+
+	const float Now = m_FrameTimes[m_Head];
+	Time = FMath::Clamp(Time, Now - m_MaxRewindTime, Now);
+
+	int32 OlderFrame, NewerFrame;
+	float Alpha;
+	uint32 OlderFrameNumber;
+	if (!FindFrames(Time, OlderFrame, NewerFrame, Alpha, OlderFrameNumber))
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_HMLagCompShots);
+
+	const FVector* const OlderPositions = &m_Positions[OlderFrame * m_MaxCharacters];
+	const FVector* const NewerPositions = &m_Positions[NewerFrame * m_MaxCharacters];
+	const uint8* const OlderCollidable = &m_Collidable[OlderFrame * m_MaxCharacters];
+	const uint8* const NewerCollidable = &m_Collidable[NewerFrame * m_MaxCharacters];
+
+	/** A capsule that the shot passes through in the rewound frame. */
+	struct FCandidate
+	{
+		int32 Slot;
+		float DistSquared;
+		FVector RewoundPosition;
+	};
+
+	TArray<FCandidate, TInlineAllocator<8>> Candidates;
+
+	// Broadphase: the shot against every rewound capsule
+	for (int32 Slot = 0; Slot < m_NumUsedSlots; ++Slot)
+	{
+		if (OlderCollidable[Slot] == 0 || NewerCollidable[Slot] == 0 || m_FirstFrame[Slot] > OlderFrameNumber)
+		{
+			continue;
+		}
+
+		const FVector Position = FMath::Lerp(OlderPositions[Slot], NewerPositions[Slot], Alpha);
+		const float Radius = m_Radius[Slot] * m_CapsuleInflation;
+		const FVector Axis(0.0f, 0.0f, FMath::Max(m_HalfHeight[Slot] - m_Radius[Slot], 0.0f));
+
+		FVector OnShot, OnCapsule;
+		FMath::SegmentDistToSegmentSafe(TraceStart, TraceEnd, Position - Axis, Position + Axis, OnShot, OnCapsule);
+
+		if (FVector::DistSquared(OnShot, OnCapsule) <= Radius * Radius)
+		{
+			Candidates.Add({ Slot, FVector::DistSquared(TraceStart, OnShot), Position });
+		}
+	}
+
+	if (Candidates.Num() == 0)
+	{
+		return false;
+	}
+
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistSquared < B.DistSquared; });
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(HMLagCompensation), true, IgnoreActor);
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	// Narrowphase: trace the mesh with the shot moved into the character's current space
+	for (const FCandidate& Candidate : Candidates)
+	{
+		AHMCharacterBase* const Character = m_Characters[Candidate.Slot].Get();
+		if (Character == nullptr || Character == IgnoreActor)
+		{
+			continue;
+		}
+
+		USkeletalMeshComponent* const Mesh = Character->GetMesh();
+		if (Mesh == nullptr)
+		{
+			continue;
+		}
+
+		const FVector Offset = Character->GetCapsuleComponent()->GetComponentLocation() - Candidate.RewoundPosition;
+
+		if (Mesh->LineTraceComponent(OutHit, TraceStart + Offset, TraceEnd + Offset, QueryParams))
+		{
+			// Move the hit back to where the client saw it
+			OutHit.Location -= Offset;
+			OutHit.ImpactPoint -= Offset;
+			OutHit.TraceStart = TraceStart;
+			OutHit.TraceEnd = TraceEnd;
+			OutHit.Actor = Character;
+			OutHit.Component = Mesh;
+			OutHit.bBlockingHit = true;
+
+			return true;
+		}
+	}
+
+	return false;
+}
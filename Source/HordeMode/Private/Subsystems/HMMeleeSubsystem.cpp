@@ -0,0 +1,232 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMMeleeSubsystem.h"
+#include "AI/HMAICharacterBase.h"
+#include "HMHelpers.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Melee"), STAT_HMMelee, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Melee Windows"), STAT_HMMeleeWindows, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Melee Hits"), STAT_HMMeleeHits, STATGROUP_HordeMode);
+
+static FAutoConsoleCommandWithWorld CmdMeleeStats(
+	TEXT("hm.Melee.Stats"),
+	TEXT("Log the number of zombies that can attack and the attacks, resolved windows and hits so far."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMMeleeSubsystem* const Melee = World ? World->GetSubsystem<UHMMeleeSubsystem>() : nullptr)
+		{
+			Melee->DumpStats();
+		}
+	}));
+
+UHMMeleeSubsystem::UHMMeleeSubsystem() : m_bInitialized(false), m_NumAttacks(0), m_NumHits(0), m_NumWindowsResolved(0)
+{
+}
+
+void UHMMeleeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMMeleeSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	m_Attackers.Empty();
+	m_NextAttackTimes.Empty();
+	m_WindowStarts.Empty();
+	m_WindowEnds.Empty();
+	m_Attacking.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMMeleeSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject) && m_Attackers.Num() > 0;
+}
+
+TStatId UHMMeleeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMMeleeSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMMeleeSubsystem::Tick(float DeltaTime)
+{
+	UWorld* const World = GetWorld();
+	if (World->GetNetMode() == NM_Client || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HMMelee);
+
+	// Gather the targets once for every zombie
+	TArray<AHMCharacterBase*, TInlineAllocator<8>> Players;
+	TArray<FVector, TInlineAllocator<8>> PlayerLocations;
+	TArray<AController*, TInlineAllocator<8>> PlayerControllers;
+	UHMHelpers::GetPlayerControllers(World, PlayerControllers);
+
+	for (const AController* const PlayerController : PlayerControllers)
+	{
+		AHMCharacterBase* const Player = Cast<AHMCharacterBase>(PlayerController->GetPawn());
+		if (Player != nullptr && Player->IsAlive() && !Player->IsEnemy())
+		{
+			Players.Add(Player);
+			PlayerLocations.Add(Player->GetActorLocation());
+		}
+	}
+
+	if (Players.Num() == 0)
+	{
+		return;
+	}
+
+	const float Now = World->GetTimeSeconds();
+
+	int32 NumWindows = 0;
+	int32 NumHits = 0;
+
+	for (int32 Index = m_Attackers.Num() - 1; Index >= 0; --Index)
+	{
+		AHMAICharacterBase* const Zombie = m_Attackers[Index].Get();
+		if (Zombie == nullptr)
+		{
+			RemoveAttacker(Index);
+			continue;
+		}
+
+		// Dead and pooled zombies keep their cooldown but lose the attack they were in
+		if (Zombie->IsDead() || Zombie->IsHidden())
+		{
+			m_Attacking[Index] = false;
+			continue;
+		}
+
+		const FVector Location = Zombie->GetActorLocation();
+		const float RangeSq = FMath::Square(Zombie->GetMeleeRange());
+
+		if (!m_Attacking[Index])
+		{
+			if (Now < m_NextAttackTimes[Index])
+			{
+				continue;
+			}
+
+			bool bInRange = false;
+			for (int32 Player = 0; Player < Players.Num() && !bInRange; ++Player)
+			{
+				bInRange = FVector::DistSquared(Location, PlayerLocations[Player]) <= RangeSq;
+			}
+
+			if (bInRange)
+			{
+				m_Attacking[Index] = true;
+				m_WindowStarts[Index] = Now + Zombie->GetMeleeWindup();
+				m_WindowEnds[Index] = m_WindowStarts[Index] + Zombie->GetMeleeWindow();
+				m_NextAttackTimes[Index] = Now + Zombie->GetMeleeCooldown();
+				++m_NumAttacks;
+
+				Zombie->Multi_PlayMeleeAttack();
+			}
+
+			continue;
+		}
+
+		if (Now < m_WindowStarts[Index])
+		{
+			continue;
+		}
+
+		++NumWindows;
+
+		const FVector Forward = Zombie->GetActorForwardVector();
+		const float ConeCos = FMath::Cos(FMath::DegreesToRadians(Zombie->GetMeleeHalfAngle()));
+
+		for (int32 Player = 0; Player < Players.Num(); ++Player)
+		{
+			const FVector ToPlayer = PlayerLocations[Player] - Location;
+			const float DistanceSq = ToPlayer.SizeSquared();
+			if (DistanceSq > RangeSq || (ToPlayer | Forward) < ConeCos * FMath::Sqrt(DistanceSq))
+			{
+				continue;
+			}
+
+			// Players can die to an earlier window this frame
+			if (Players[Player]->IsAlive())
+			{
+				Players[Player]->TakeDamage(Zombie->GetMeleeDamage(), FDamageEvent(), Zombie->GetController(), Zombie);
+
+				m_Attacking[Index] = false;
+				++NumHits;
+				break;
+			}
+		}
+
+		if (Now >= m_WindowEnds[Index])
+		{
+			m_Attacking[Index] = false;
+		}
+	}
+
+	m_NumWindowsResolved += NumWindows;
+	m_NumHits += NumHits;
+
+	SET_DWORD_STAT(STAT_HMMeleeWindows, NumWindows);
+	SET_DWORD_STAT(STAT_HMMeleeHits, NumHits);
+}
+
+void UHMMeleeSubsystem::RegisterAttacker(AHMAICharacterBase* Attacker)
+{
+	if (Attacker == nullptr || m_Attackers.Contains(Attacker))
+	{
+		return;
+	}
+
+	// Lazily reserve so levels without zombies don't pay for it
+	if (m_Attackers.Max() == 0)
+	{
+		m_Attackers.Reserve(64);
+		m_NextAttackTimes.Reserve(64);
+		m_WindowStarts.Reserve(64);
+		m_WindowEnds.Reserve(64);
+		m_Attacking.Reserve(64);
+	}
+
+	m_Attackers.Add(Attacker);
+	m_NextAttackTimes.Add(0.0f);
+	m_WindowStarts.Add(0.0f);
+	m_WindowEnds.Add(0.0f);
+	m_Attacking.Add(false);
+}
+
+void UHMMeleeSubsystem::UnregisterAttacker(AHMAICharacterBase* Attacker)
+{
+	const int32 Index = m_Attackers.IndexOfByKey(Attacker);
+	if (Index != INDEX_NONE)
+	{
+		RemoveAttacker(Index);
+	}
+}
+
+void UHMMeleeSubsystem::RemoveAttacker(int32 Index)
+{
+	m_Attackers.RemoveAtSwap(Index, 1, false);
+	m_NextAttackTimes.RemoveAtSwap(Index, 1, false);
+	m_WindowStarts.RemoveAtSwap(Index, 1, false);
+	m_WindowEnds.RemoveAtSwap(Index, 1, false);
+	m_Attacking.RemoveAtSwap(Index, 1, false);
+}
+
+void UHMMeleeSubsystem::DumpStats() const
+{
+	UE_LOG(LogHordeMode, Log, TEXT("Melee: %d zombies, %d attacks, %d windows resolved, %d hits"), m_Attackers.Num(), m_NumAttacks, m_NumWindowsResolved, m_NumHits);
+}
@@ -0,0 +1,324 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMPerceptionSubsystem.h"
+#include "AI/HMAICharacterBase.h"
+#include "HMHelpers.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Perception"), STAT_HMPerception, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Perception Checks"), STAT_HMPerceptionChecks, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Perception Traces"), STAT_HMPerceptionTraces, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Zombies With Targets"), STAT_HMPerceptionTargets, STATGROUP_HordeMode);
+
+static FAutoConsoleCommandWithWorld CmdPerceptionStats(
+	TEXT("hm.Perception.Stats"),
+	TEXT("Log the number of zombies with a target, how many zombies see each player and the checks/traces so far."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMPerceptionSubsystem* const Perception = World ? World->GetSubsystem<UHMPerceptionSubsystem>() : nullptr)
+		{
+			Perception->DumpStats();
+		}
+	}));
+
+/** The visible masks have a bit per player. */
+static const int32 MAX_PERCEIVED_PLAYERS = 32;
+
+UHMPerceptionSubsystem::UHMPerceptionSubsystem() : m_SightRadius(3000.0f), m_LoseSightRadius(3500.0f), m_VisionHalfAngle(75.0f), m_ForgetTime(5.0f),
+	m_MaxTracesPerFrame(32), m_bInitialized(false), m_NextPair(0), m_NumTraces(0), m_NumChecks(0), m_NumTargets(0)
+{
+}
+
+void UHMPerceptionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMPerceptionSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	SET_DWORD_STAT(STAT_HMPerceptionTargets, 0);
+
+	m_Zombies.Empty();
+	m_VisibleMasks.Empty();
+	m_Targets.Empty();
+	m_LastSeenLocations.Empty();
+	m_LastSeenTimes.Empty();
+	m_FreeSlots.Empty();
+	m_Players.Empty();
+	m_NumPerceivers.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMPerceptionSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject) && m_Zombies.Num() > m_FreeSlots.Num();
+}
+
+TStatId UHMPerceptionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMPerceptionSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMPerceptionSubsystem::Tick(float DeltaTime)
+{
+	UWorld* const World = GetWorld();
+	if (World->GetNetMode() == NM_Client || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HMPerception);
+
+	// Gather the players and their eyes once for every zombie
+	TArray<AHMCharacterBase*, TInlineAllocator<8>> Players;
+	TArray<FVector, TInlineAllocator<8>> PlayerEyes;
+	TArray<AController*, TInlineAllocator<8>> PlayerControllers;
+	UHMHelpers::GetPlayerControllers(World, PlayerControllers);
+
+	for (int32 Index = 0; Index < PlayerControllers.Num() && Players.Num() < MAX_PERCEIVED_PLAYERS; ++Index)
+	{
+		AHMCharacterBase* const Player = Cast<AHMCharacterBase>(PlayerControllers[Index]->GetPawn());
+		if (Player != nullptr && Player->IsAlive() && !Player->IsEnemy())
+		{
+			FVector Location;
+			FRotator Rotation;
+			Player->GetActorEyesViewPoint(Location, Rotation);
+
+			Players.Add(Player);
+			PlayerEyes.Add(Location);
+		}
+	}
+
+	// The bits refer to different players now
+	bool bPlayersChanged = Players.Num() != m_Players.Num();
+	for (int32 Player = 0; Player < Players.Num() && !bPlayersChanged; ++Player)
+	{
+		bPlayersChanged = m_Players[Player] != Players[Player];
+	}
+
+	if (bPlayersChanged)
+	{
+		m_Players.Reset();
+		for (AHMCharacterBase* const Player : Players)
+		{
+			m_Players.Add(Player);
+		}
+
+		ResetVisibility();
+	}
+
+	const float Now = World->GetTimeSeconds();
+	const int32 NumPairs = m_Zombies.Num() * Players.Num();
+
+	int32 NumChecks = 0;
+	int32 NumTraces = 0;
+
+	if (NumPairs > 0)
+	{
+		const float SightRadiusSq = FMath::Square(m_SightRadius);
+		const float LoseSightRadiusSq = FMath::Square(FMath::Max(m_LoseSightRadius, m_SightRadius));
+		const float VisionCos = FMath::Cos(FMath::DegreesToRadians(m_VisionHalfAngle));
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(HMPerception), true);
+		FCollisionResponseParams ResponseParams;
+		ResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+
+		// Every pair at most once per frame
+		while (NumTraces < m_MaxTracesPerFrame && NumChecks < NumPairs)
+		{
+			const int32 Pair = m_NextPair % NumPairs;
+			m_NextPair = Pair + 1;
+			++NumChecks;
+
+			const int32 Slot = Pair / Players.Num();
+			const int32 Player = Pair % Players.Num();
+			const uint32 Bit = 1u << Player;
+
+			AHMAICharacterBase* const Zombie = m_Zombies[Slot].Get();
+			if (Zombie == nullptr || Zombie->IsDead() || Zombie->IsHidden())
+			{
+				m_VisibleMasks[Slot] &= ~Bit;
+				continue;
+			}
+
+			FVector Eyes;
+			FRotator EyesRotation;
+			Zombie->GetActorEyesViewPoint(Eyes, EyesRotation);
+
+			const FVector ToPlayer = PlayerEyes[Player] - Eyes;
+			const float DistanceSq = ToPlayer.SizeSquared();
+
+			// A player that is already seen only has to stay within the lose sight radius
+			const bool bWasVisible = (m_VisibleMasks[Slot] & Bit) != 0;
+			if (DistanceSq > (bWasVisible ? LoseSightRadiusSq : SightRadiusSq)
+				|| (!bWasVisible && (ToPlayer | Zombie->GetActorForwardVector()) < VisionCos * FMath::Sqrt(DistanceSq)))
+			{
+				m_VisibleMasks[Slot] &= ~Bit;
+				continue;
+			}
+
+			++NumTraces;
+
+			QueryParams.ClearIgnoredActors();
+			QueryParams.AddIgnoredActor(Zombie);
+			QueryParams.AddIgnoredActor(Players[Player]);
+
+			if (World->LineTraceTestByChannel(Eyes, PlayerEyes[Player], ECC_Visibility, QueryParams, ResponseParams))
+			{
+				m_VisibleMasks[Slot] &= ~Bit;
+				continue;
+			}
+
+			m_VisibleMasks[Slot] |= Bit;
+
+			// Go after the closest player that is seen
+			const AHMCharacterBase* const Target = m_Targets[Slot].Get();
+			const int32 TargetIndex = Target ? Players.IndexOfByKey(Target) : INDEX_NONE;
+			if (TargetIndex == INDEX_NONE || TargetIndex == Player || (m_VisibleMasks[Slot] & (1u << TargetIndex)) == 0
+				|| DistanceSq < FVector::DistSquared(Eyes, PlayerEyes[TargetIndex]))
+			{
+				m_Targets[Slot] = Players[Player];
+				m_LastSeenLocations[Slot] = Players[Player]->GetActorLocation();
+				m_LastSeenTimes[Slot] = Now;
+			}
+		}
+	}
+
+	// Forget old targets and count who sees whom
+	m_NumPerceivers.Reset();
+	m_NumPerceivers.AddZeroed(Players.Num());
+
+	int32 NumTargets = 0;
+	for (int32 Slot = 0; Slot < m_Zombies.Num(); ++Slot)
+	{
+		const uint32 Mask = m_VisibleMasks[Slot];
+		for (int32 Player = 0; Player < Players.Num(); ++Player)
+		{
+			m_NumPerceivers[Player] += (Mask >> Player) & 1;
+		}
+
+		const AHMCharacterBase* const Target = m_Targets[Slot].Get();
+		if (Target == nullptr)
+		{
+			continue;
+		}
+
+		// Pooled zombies come back without a target
+		const AHMAICharacterBase* const Zombie = m_Zombies[Slot].Get();
+		if (Zombie == nullptr || Zombie->IsDead() || Zombie->IsHidden() || Target->IsDead() || Now - m_LastSeenTimes[Slot] > m_ForgetTime)
+		{
+			m_Targets[Slot].Reset();
+			continue;
+		}
+
+		++NumTargets;
+	}
+
+	m_NumChecks += NumChecks;
+	m_NumTraces += NumTraces;
+	m_NumTargets = NumTargets;
+
+	SET_DWORD_STAT(STAT_HMPerceptionChecks, NumChecks);
+	SET_DWORD_STAT(STAT_HMPerceptionTraces, NumTraces);
+	SET_DWORD_STAT(STAT_HMPerceptionTargets, NumTargets);
+}
+
+void UHMPerceptionSubsystem::ResetVisibility()
+{
+	for (uint32& Mask : m_VisibleMasks)
+	{
+		Mask = 0;
+	}
+}
+
+int32 UHMPerceptionSubsystem::RegisterZombie(AHMAICharacterBase* Zombie)
+{
+	if (Zombie == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	// Lazily reserve so levels without zombies don't pay for it
+	if (m_Zombies.Max() == 0)
+	{
+		m_Zombies.Reserve(64);
+		m_VisibleMasks.Reserve(64);
+		m_Targets.Reserve(64);
+		m_LastSeenLocations.Reserve(64);
+		m_LastSeenTimes.Reserve(64);
+	}
+
+	int32 Slot = INDEX_NONE;
+	if (m_FreeSlots.Num() > 0)
+	{
+		Slot = m_FreeSlots.Pop(false);
+	}
+	else
+	{
+		Slot = m_Zombies.AddDefaulted();
+		m_VisibleMasks.AddZeroed();
+		m_Targets.AddDefaulted();
+		m_LastSeenLocations.AddZeroed();
+		m_LastSeenTimes.AddZeroed();
+	}
+
+	m_Zombies[Slot] = Zombie;
+	m_VisibleMasks[Slot] = 0;
+	m_Targets[Slot].Reset();
+
+	return Slot;
+}
+
+void UHMPerceptionSubsystem::UnregisterZombie(int32 Slot)
+{
+	if (!m_Zombies.IsValidIndex(Slot) || !m_Zombies[Slot].IsValid())
+	{
+		return;
+	}
+
+	m_Zombies[Slot].Reset();
+	m_VisibleMasks[Slot] = 0;
+	m_Targets[Slot].Reset();
+	m_FreeSlots.Add(Slot);
+}
+
+bool UHMPerceptionSubsystem::CanSee(int32 Slot, const AHMCharacterBase* Player) const
+{
+	if (!m_VisibleMasks.IsValidIndex(Slot))
+	{
+		return false;
+	}
+
+	const int32 Index = m_Players.IndexOfByKey(Player);
+	return Index != INDEX_NONE && (m_VisibleMasks[Slot] & (1u << Index)) != 0;
+}
+
+int32 UHMPerceptionSubsystem::GetNumPerceivers(const AHMCharacterBase* Player) const
+{
+	const int32 Index = m_Players.IndexOfByKey(Player);
+	return m_NumPerceivers.IsValidIndex(Index) ? m_NumPerceivers[Index] : 0;
+}
+
+void UHMPerceptionSubsystem::DumpStats() const
+{
+	UE_LOG(LogHordeMode, Log, TEXT("Perception: %d zombies, %d with a target, %d checks, %d traces (max %d per frame)"),
+		m_Zombies.Num() - m_FreeSlots.Num(), m_NumTargets, m_NumChecks, m_NumTraces, m_MaxTracesPerFrame);
+
+	for (int32 Player = 0; Player < m_Players.Num(); ++Player)
+	{
+		if (const AHMCharacterBase* const Character = m_Players[Player].Get())
+		{
+			UE_LOG(LogHordeMode, Log, TEXT("  %s is seen by %d zombies"), *Character->GetName(), m_NumPerceivers.IsValidIndex(Player) ? m_NumPerceivers[Player] : 0);
+		}
+	}
+}
@@ -0,0 +1,229 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMProjectileSubsystem.h"
+#include "Subsystems/HMEffectPoolSubsystem.h"
+#include "Base/HMFirearmBase.h"
+#include "HordeMode.h"
+#include "HMCommon.h"
+
+#include "Engine/World.h"
+#include "Particles/ParticleSystemComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Resolve"), STAT_HMProjectileResolve, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Projectile Integrate"), STAT_HMProjectileIntegrate, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles"), STAT_HMProjectiles, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Impacts"), STAT_HMProjectileImpacts, STATGROUP_HordeMode);
+
+UHMProjectileSubsystem::UHMProjectileSubsystem() : m_ReservedProjectiles(1024), m_bInitialized(false), m_NextId(0)
+{
+}
+
+void UHMProjectileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMProjectileSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	while (m_Ids.Num() > 0)
+	{
+		RemoveAt(m_Ids.Num() - 1);
+	}
+
+	Super::Deinitialize();
+}
+
+bool UHMProjectileSubsystem::IsTickable() const
+{
+	return m_bInitialized && m_Ids.Num() > 0 && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMProjectileSubsystem, STATGROUP_HordeMode);
+}
+
+uint16 UHMProjectileSubsystem::SpawnProjectile(AHMFirearmBase* Firearm, const FVector& Origin, const FVector& Direction, const FProjectileData& Data, int32 Id)
+{
+	if (m_Ids.Max() == 0)
+	{
+		m_Ids.Reserve(m_ReservedProjectiles);
+		m_Firearms.Reserve(m_ReservedProjectiles);
+		m_Positions.Reserve(m_ReservedProjectiles);
+		m_Velocities.Reserve(m_ReservedProjectiles);
+		m_TimeLeft.Reserve(m_ReservedProjectiles);
+		m_GravityZ.Reserve(m_ReservedProjectiles);
+		m_Drag.Reserve(m_ReservedProjectiles);
+		m_Radius.Reserve(m_ReservedProjectiles);
+		m_TraceHandles.Reserve(m_ReservedProjectiles);
+		m_Trails.Reserve(m_ReservedProjectiles);
+	}
+
+	const uint16 ProjectileId = Id == INDEX_NONE ? m_NextId++ : static_cast<uint16>(Id);
+
+	m_Ids.Add(ProjectileId);
+	m_Firearms.Add(Firearm);
+	m_Positions.Add(Origin);
+	m_Velocities.Add(Direction.GetSafeNormal() * Data.Speed);
+	m_TimeLeft.Add(Data.Lifetime);
+	m_GravityZ.Add(GetWorld()->GetGravityZ() * Data.GravityScale);
+	m_Drag.Add(FMath::Clamp(Data.Drag, 0.0f, 1.0f));
+	m_Radius.Add(FMath::Max(Data.Radius, 0.0f));
+	m_TraceHandles.AddDefaulted();
+
+	UParticleSystemComponent* Trail = nullptr;
+	if (UHMEffectPoolSubsystem* const EffectPool = GetWorld()->GetSubsystem<UHMEffectPoolSubsystem>())
+	{
+		Trail = EffectPool->SpawnAtLocation(Data.TrailEffect, Origin, Direction.Rotation());
+	}
+
+	m_Trails.Add(Trail);
+
+	INC_DWORD_STAT(STAT_HMProjectiles);
+
+	return ProjectileId;
+}
+
+void UHMProjectileSubsystem::RemoveProjectile(uint16 Id)
+{
+	const int32 Index = m_Ids.IndexOfByKey(Id);
+	if (Index != INDEX_NONE)
+	{
+		RemoveAt(Index);
+	}
+}
+
+void UHMProjectileSubsystem::RemoveAt(int32 Index)
+{
+	// The trail fades out and goes back to the pool on its own
+	if (UParticleSystemComponent* const Trail = m_Trails[Index].Get())
+	{
+		Trail->Deactivate();
+	}
+
+	m_Ids.RemoveAtSwap(Index, 1, false);
+	m_Firearms.RemoveAtSwap(Index, 1, false);
+	m_Positions.RemoveAtSwap(Index, 1, false);
+	m_Velocities.RemoveAtSwap(Index, 1, false);
+	m_TimeLeft.RemoveAtSwap(Index, 1, false);
+	m_GravityZ.RemoveAtSwap(Index, 1, false);
+	m_Drag.RemoveAtSwap(Index, 1, false);
+	m_Radius.RemoveAtSwap(Index, 1, false);
+	m_TraceHandles.RemoveAtSwap(Index, 1, false);
+	m_Trails.RemoveAtSwap(Index, 1, false);
+
+	DEC_DWORD_STAT(STAT_HMProjectiles);
+}
+
+void UHMProjectileSubsystem::Tick(float DeltaTime)
+{
+	ResolveImpacts();
+	IntegrateAndSweep(DeltaTime);
+}
+
+void UHMProjectileSubsystem::ResolveImpacts()
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMProjectileResolve);
+
+	UWorld* const World = GetWorld();
+
+	m_Impacts.Reset();
+
+	FTraceDatum TraceData;
+	for (int32 Index = 0; Index < m_Ids.Num(); ++Index)
+	{
+		if (!m_TraceHandles[Index].IsValid() || !World->QueryTraceData(m_TraceHandles[Index], TraceData))
+		{
+			continue;
+		}
+
+		if (TraceData.OutHits.Num() > 0 && TraceData.OutHits[0].bBlockingHit)
+		{
+			m_Impacts.Add({ Index, TraceData.OutHits[0] });
+		}
+	}
+
+	if (m_Impacts.Num() == 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_HMProjectileImpacts, m_Impacts.Num());
+
+	const bool bAuthority = World->GetNetMode() != NM_Client;
+
+	// Highest index first so removing doesn't move a projectile that still has to be resolved
+	for (int32 ImpactIndex = m_Impacts.Num() - 1; ImpactIndex >= 0; --ImpactIndex)
+	{
+		const FImpact& Impact = m_Impacts[ImpactIndex];
+
+		if (UParticleSystemComponent* const Trail = m_Trails[Impact.Index].Get())
+		{
+			Trail->SetWorldLocation(Impact.Hit.ImpactPoint);
+		}
+
+		// Clients only stop the projectile, the impact itself comes from the server
+		AHMFirearmBase* const Firearm = m_Firearms[Impact.Index].Get();
+		if (bAuthority && Firearm != nullptr)
+		{
+			Firearm->ResolveProjectileImpact(m_Ids[Impact.Index], Impact.Hit, m_Velocities[Impact.Index]);
+		}
+
+		RemoveAt(Impact.Index);
+	}
+}
+
+void UHMProjectileSubsystem::IntegrateAndSweep(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMProjectileIntegrate);
+
+	UWorld* const World = GetWorld();
+
+	// Backwards since expired projectiles get swapped out
+	for (int32 Index = m_Ids.Num() - 1; Index >= 0; --Index)
+	{
+		m_TimeLeft[Index] -= DeltaTime;
+		if (m_TimeLeft[Index] <= 0.0f)
+		{
+			RemoveAt(Index);
+			continue;
+		}
+
+		FVector& Velocity = m_Velocities[Index];
+		Velocity.Z += m_GravityZ[Index] * DeltaTime;
+		Velocity *= FMath::Max(1.0f - m_Drag[Index] * DeltaTime, 0.0f);
+
+		const FVector Start = m_Positions[Index];
+		const FVector End = Start + Velocity * DeltaTime;
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(HMProjectile), false);
+		QueryParams.bReturnPhysicalMaterial = true;
+
+		if (const AHMFirearmBase* const Firearm = m_Firearms[Index].Get())
+		{
+			QueryParams.AddIgnoredActor(Firearm);
+			QueryParams.AddIgnoredActor(Firearm->GetOwner());
+		}
+
+		if (m_Radius[Index] > 0.0f)
+		{
+			m_TraceHandles[Index] = World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, COLLISION_WEAPON, FCollisionShape::MakeSphere(m_Radius[Index]), QueryParams);
+		}
+		else
+		{
+			m_TraceHandles[Index] = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, COLLISION_WEAPON, QueryParams);
+		}
+
+		m_Positions[Index] = End;
+
+		if (UParticleSystemComponent* const Trail = m_Trails[Index].Get())
+		{
+			Trail->SetWorldLocationAndRotation(End, Velocity.Rotation());
+		}
+	}
+}
@@ -0,0 +1,303 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMShotQueueSubsystem.h"
+#include "Subsystems/HMLagCompensationSubsystem.h"
+#include "Base/HMFirearmBase.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shot Queue Submit"), STAT_HMShotQueueSubmit, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Shot Queue Resolve"), STAT_HMShotQueueResolve, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Shot Sync Trace"), STAT_HMShotSyncTrace, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Batched"), STAT_HMShotsBatched, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Traced Sync"), STAT_HMShotsSync, STATGROUP_HordeMode);
+
+static TAutoConsoleVariable<int32> CVarBatchedShots(
+	TEXT("hm.BatchedShots"),
+	1,
+	TEXT("0 = trace every shot on the game thread when it's fired, 1 = batch all shots of a frame into async traces."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdBenchShots(
+	TEXT("hm.BenchShots"),
+	TEXT("hm.BenchShots <Frames> - Average the frame time with hm.BatchedShots 0 and then 1 for <Frames> frames each (default 600)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UHMShotQueueSubsystem* const ShotQueue = World ? World->GetSubsystem<UHMShotQueueSubsystem>() : nullptr)
+		{
+			ShotQueue->StartBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 600);
+		}
+	}));
+
+UHMShotQueueSubsystem::UHMShotQueueSubsystem() : m_bInitialized(false), m_BenchFramesLeft(0), m_BenchFramesPerPhase(0), m_BenchPhase(0), m_BenchPreviousMode(1),
+	m_BenchFrameTime(0.0), m_BenchShotTime(0.0), m_BenchShots(0), m_BenchSyncFrameTime(0.0), m_BenchSyncShotTime(0.0), m_BenchSyncShots(0)
+{
+}
+
+void UHMShotQueueSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMShotQueueSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	m_PendingShots.Empty();
+	m_InFlightShots.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMShotQueueSubsystem::IsTickable() const
+{
+	// The CDO registers itself as a tickable object too, only tick the real instance
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMShotQueueSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMShotQueueSubsystem, STATGROUP_HordeMode);
+}
+
+bool UHMShotQueueSubsystem::IsBatchingEnabled()
+{
+	return CVarBatchedShots.GetValueOnGameThread() != 0;
+}
+
+void UHMShotQueueSubsystem::Tick(float DeltaTime)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Last frame's traces are done now, resolve them before handing this frame's shots to the async trace
+	ResolveInFlightShots();
+	SubmitPendingShots();
+
+	if (m_BenchFramesLeft > 0)
+	{
+		m_BenchShotTime += FPlatformTime::Seconds() - StartTime;
+		TickBenchmark(DeltaTime);
+	}
+}
+
+/** Fill in a shot, lag compensated shots don't trace against characters - those come from the rewound history instead. */
+static void InitShot(FHMQueuedShot& Shot, AHMFirearmBase* Firearm, const FVector& TraceStart, const FVector& TraceEnd, const FCollisionQueryParams& QueryParams, float RewindTime, int32 NumPellets)
+{
+	Shot.Firearm = Firearm;
+	Shot.TraceStart = TraceStart;
+	Shot.TraceEnd = TraceEnd;
+	Shot.QueryParams = QueryParams;
+	Shot.RewindTime = RewindTime;
+	Shot.NumPellets = NumPellets;
+
+	if (Shot.IsLagCompensated())
+	{
+		// Character capsules and meshes are Pawn objects
+		Shot.ResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+	}
+}
+
+void UHMShotQueueSubsystem::QueueShot(AHMFirearmBase* Firearm, const FVector& TraceStart, TArrayView<const FVector> TraceEnds, const FCollisionQueryParams& QueryParams, float RewindTime)
+{
+	// The pellets stay next to each other in the queue, only the first one knows how many there are
+	for (int32 Index = 0; Index < TraceEnds.Num(); ++Index)
+	{
+		InitShot(m_PendingShots.AddDefaulted_GetRef(), Firearm, TraceStart, TraceEnds[Index], QueryParams, RewindTime, Index == 0 ? TraceEnds.Num() : 0);
+	}
+
+	if (m_BenchFramesLeft > 0)
+	{
+		++m_BenchShots;
+	}
+}
+
+void UHMShotQueueSubsystem::TraceShotNow(AHMFirearmBase* Firearm, const FVector& TraceStart, TArrayView<const FVector> TraceEnds, const FCollisionQueryParams& QueryParams, float RewindTime)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	TArray<FHMShotTraceResult, TInlineAllocator<16>> Results;
+	Results.SetNum(TraceEnds.Num());
+
+	for (int32 Index = 0; Index < TraceEnds.Num(); ++Index)
+	{
+		FHMQueuedShot Pellet;
+		InitShot(Pellet, Firearm, TraceStart, TraceEnds[Index], QueryParams, RewindTime, Index == 0 ? TraceEnds.Num() : 0);
+		TracePellet(Pellet, Results[Index]);
+	}
+
+	if (Firearm)
+	{
+		Firearm->ResolveShot(TraceStart, Results);
+	}
+
+	if (m_BenchFramesLeft > 0)
+	{
+		m_BenchShotTime += FPlatformTime::Seconds() - StartTime;
+		++m_BenchShots;
+	}
+}
+
+void UHMShotQueueSubsystem::TracePellet(const FHMQueuedShot& Pellet, FHMShotTraceResult& OutResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMShotSyncTrace);
+	INC_DWORD_STAT(STAT_HMShotsSync);
+
+	FHitResult Hit;
+	const bool bHit = GetWorld()->LineTraceSingleByChannel(Hit, Pellet.TraceStart, Pellet.TraceEnd, COLLISION_WEAPON, Pellet.QueryParams, Pellet.ResponseParams);
+
+	GetPelletResult(Pellet, bHit ? &Hit : nullptr, OutResult);
+}
+
+void UHMShotQueueSubsystem::GetPelletResult(const FHMQueuedShot& Pellet, const FHitResult* WorldHit, FHMShotTraceResult& OutResult) const
+{
+	OutResult.TraceEnd = Pellet.TraceEnd;
+	OutResult.bHit = WorldHit != nullptr;
+
+	if (WorldHit != nullptr)
+	{
+		OutResult.Hit = *WorldHit;
+	}
+
+	if (Pellet.IsLagCompensated())
+	{
+		if (UHMLagCompensationSubsystem* const LagCompensation = GetWorld()->GetSubsystem<UHMLagCompensationSubsystem>())
+		{
+			const AHMFirearmBase* const Firearm = Pellet.Firearm.Get();
+
+			// A character that the client hit counts unless a wall was in front of it
+			FHitResult RewoundHit;
+			if (LagCompensation->RewindTrace(Pellet.RewindTime, Pellet.TraceStart, Pellet.TraceEnd, Firearm ? Firearm->GetOwner() : nullptr, RewoundHit) && (WorldHit == nullptr || RewoundHit.Distance < WorldHit->Distance))
+			{
+				OutResult.Hit = RewoundHit;
+				OutResult.bHit = true;
+			}
+		}
+	}
+}
+
+void UHMShotQueueSubsystem::SubmitPendingShots()
+{
+	if (m_PendingShots.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HMShotQueueSubmit);
+	INC_DWORD_STAT_BY(STAT_HMShotsBatched, m_PendingShots.Num());
+
+	UWorld* const World = GetWorld();
+
+	for (FHMQueuedShot& Shot : m_PendingShots)
+	{
+		Shot.TraceHandle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Shot.TraceStart, Shot.TraceEnd, COLLISION_WEAPON, Shot.QueryParams, Shot.ResponseParams);
+	}
+
+	// The in flight array was emptied by ResolveInFlightShots so just swap the buffers (keeps the allocations around)
+	Swap(m_PendingShots, m_InFlightShots);
+	m_PendingShots.Reset();
+}
+
+void UHMShotQueueSubsystem::ResolveInFlightShots()
+{
+	if (m_InFlightShots.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HMShotQueueResolve);
+
+	UWorld* const World = GetWorld();
+
+	TArray<FHMShotTraceResult, TInlineAllocator<16>> Results;
+	FTraceDatum TraceData;
+
+	for (int32 Index = 0; Index < m_InFlightShots.Num();)
+	{
+		const FHMQueuedShot& Shot = m_InFlightShots[Index];
+		const int32 NumPellets = FMath::Clamp(Shot.NumPellets, 1, m_InFlightShots.Num() - Index);
+
+		if (AHMFirearmBase* const Firearm = Shot.Firearm.Get())
+		{
+			Results.Reset();
+
+			for (int32 PelletIndex = Index; PelletIndex < Index + NumPellets; ++PelletIndex)
+			{
+				const FHMQueuedShot& Pellet = m_InFlightShots[PelletIndex];
+				FHMShotTraceResult& Result = Results.AddDefaulted_GetRef();
+
+				if (!World->QueryTraceData(Pellet.TraceHandle, TraceData))
+				{
+					// Should never happen, but don't eat the pellet if the async result went missing
+					TracePellet(Pellet, Result);
+					continue;
+				}
+
+				GetPelletResult(Pellet, TraceData.OutHits.Num() > 0 && TraceData.OutHits[0].bBlockingHit ? &TraceData.OutHits[0] : nullptr, Result);
+			}
+
+			Firearm->ResolveShot(Shot.TraceStart, Results);
+		}
+
+		Index += NumPellets;
+	}
+
+	m_InFlightShots.Reset();
+}
+
+void UHMShotQueueSubsystem::StartBenchmark(int32 Frames)
+{
+	if (m_BenchFramesLeft > 0 || Frames <= 0)
+	{
+		return;
+	}
+
+	m_BenchPreviousMode = CVarBatchedShots.GetValueOnGameThread();
+	m_BenchFramesPerPhase = Frames;
+	m_BenchFramesLeft = Frames;
+	m_BenchPhase = 0;
+	m_BenchFrameTime = m_BenchShotTime = 0.0;
+	m_BenchShots = 0;
+
+	CVarBatchedShots->Set(0, ECVF_SetByConsole);
+
+	UE_LOG(LogHordeMode, Log, TEXT("hm.BenchShots: timing the sync path for %d frames..."), Frames);
+}
+
+void UHMShotQueueSubsystem::TickBenchmark(float DeltaTime)
+{
+	m_BenchFrameTime += DeltaTime;
+
+	if (--m_BenchFramesLeft > 0)
+	{
+		return;
+	}
+
+	const double Frames = FMath::Max(m_BenchFramesPerPhase, 1);
+
+	if (m_BenchPhase == 0)
+	{
+		m_BenchSyncFrameTime = m_BenchFrameTime;
+		m_BenchSyncShotTime = m_BenchShotTime;
+		m_BenchSyncShots = m_BenchShots;
+
+		m_BenchPhase = 1;
+		m_BenchFramesLeft = m_BenchFramesPerPhase;
+		m_BenchFrameTime = m_BenchShotTime = 0.0;
+		m_BenchShots = 0;
+
+		CVarBatchedShots->Set(1, ECVF_SetByConsole);
+
+		UE_LOG(LogHordeMode, Log, TEXT("hm.BenchShots: timing the batched path for %d frames..."), m_BenchFramesPerPhase);
+		return;
+	}
+
+	CVarBatchedShots->Set(m_BenchPreviousMode, ECVF_SetByConsole);
+
+	UE_LOG(LogHordeMode, Log, TEXT("hm.BenchShots: sync    - %.3f ms/frame, %.4f ms/frame in shot code, %d shots"), m_BenchSyncFrameTime / Frames * 1000.0, m_BenchSyncShotTime / Frames * 1000.0, m_BenchSyncShots);
+	UE_LOG(LogHordeMode, Log, TEXT("hm.BenchShots: batched - %.3f ms/frame, %.4f ms/frame in shot code, %d shots"), m_BenchFrameTime / Frames * 1000.0, m_BenchShotTime / Frames * 1000.0, m_BenchShots);
+}
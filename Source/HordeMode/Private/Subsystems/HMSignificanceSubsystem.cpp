@@ -0,0 +1,356 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMSignificanceSubsystem.h"
+#include "Base/HMCharacterBase.h"
+#include "HMHelpers.h"
+#include "HordeMode.h"
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderCore.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance"), STAT_HMSignificance, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Near"), STAT_HMSignificanceNear, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Mid"), STAT_HMSignificanceMid, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Far"), STAT_HMSignificanceFar, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Hidden"), STAT_HMSignificanceHidden, STATGROUP_HordeMode);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Significance Ticks Skipped"), STAT_HMSignificanceTicksSkipped, STATGROUP_HordeMode);
+
+static TAutoConsoleVariable<int32> CVarSignificance(
+	TEXT("hm.Significance"),
+	1,
+	TEXT("0 = every zombie ticks every frame, 1 = zombies far away from/behind the players tick less often."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld CmdSignificanceStats(
+	TEXT("hm.Significance.Stats"),
+	TEXT("Log the number of zombies per significance bucket and the ticks that were skipped last frame."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMSignificanceSubsystem* const Significance = World ? World->GetSubsystem<UHMSignificanceSubsystem>() : nullptr)
+		{
+			Significance->DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSignificanceBench(
+	TEXT("hm.Significance.Bench"),
+	TEXT("Measure the average game thread time with the significance buckets off and then on. Usage: hm.Significance.Bench [Seconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UHMSignificanceSubsystem* const Significance = World ? World->GetSubsystem<UHMSignificanceSubsystem>() : nullptr)
+		{
+			Significance->StartBenchmark(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.0f);
+		}
+	}));
+
+/** The tick functions of a zombie that are bucketed - actor, movement, mesh and controller. */
+static const int32 TICK_FUNCTIONS_PER_ZOMBIE = 4;
+
+UHMSignificanceSubsystem::UHMSignificanceSubsystem() : m_NearDistance(1500.0f), m_MidDistance(4000.0f), m_ViewConeHalfAngle(60.0f),
+	m_MidTickInterval(0.1f), m_FarTickInterval(0.25f), m_HiddenTickInterval(1.0f), m_MaxUpdatesPerFrame(32), m_bInitialized(false), m_bWasEnabled(true),
+	m_NextUpdate(0), m_TicksSkipped(0.0f), m_BenchmarkPhase(0), m_BenchmarkPhaseEndTime(0.0), m_BenchmarkSeconds(0.0f)
+{
+	FMemory::Memzero(m_NumPerBucket);
+	FMemory::Memzero(m_BenchmarkGameThreadTime);
+	FMemory::Memzero(m_BenchmarkFrames);
+}
+
+void UHMSignificanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMSignificanceSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	m_Characters.Empty();
+	m_Significances.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMSignificanceSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMSignificanceSubsystem, STATGROUP_HordeMode);
+}
+
+bool UHMSignificanceSubsystem::IsEnabled() const
+{
+	return CVarSignificance.GetValueOnGameThread() != 0 && m_BenchmarkPhase != 1;
+}
+
+void UHMSignificanceSubsystem::Tick(float DeltaTime)
+{
+	UWorld* const World = GetWorld();
+	if (World->GetNetMode() == NM_Client || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HMSignificance);
+
+	if (m_BenchmarkPhase != 0)
+	{
+		UpdateBenchmark();
+	}
+
+	const bool bEnabled = IsEnabled();
+	if (bEnabled != m_bWasEnabled)
+	{
+		m_bWasEnabled = bEnabled;
+		ResetSignificances();
+	}
+
+	if (!bEnabled || m_Characters.Num() == 0)
+	{
+		return;
+	}
+
+	// Where the players are looking from
+	TArray<FVector, TInlineAllocator<8>> ViewLocations;
+	TArray<FVector, TInlineAllocator<8>> ViewDirections;
+	TArray<AController*, TInlineAllocator<8>> PlayerControllers;
+	UHMHelpers::GetPlayerControllers(World, PlayerControllers);
+
+	for (const AController* const PlayerController : PlayerControllers)
+	{
+		if (PlayerController->GetPawn() != nullptr)
+		{
+			FVector Location;
+			FRotator Rotation;
+			PlayerController->GetPlayerViewPoint(Location, Rotation);
+
+			ViewLocations.Add(Location);
+			ViewDirections.Add(Rotation.Vector());
+		}
+	}
+
+	const float NearDistanceSq = FMath::Square(m_NearDistance);
+	const float MidDistanceSq = FMath::Square(m_MidDistance);
+	const float ViewConeCos = FMath::Cos(FMath::DegreesToRadians(m_ViewConeHalfAngle));
+
+	const int32 NumUpdates = FMath::Min(m_MaxUpdatesPerFrame, m_Characters.Num());
+	for (int32 Update = 0; Update < NumUpdates; ++Update)
+	{
+		m_NextUpdate %= m_Characters.Num();
+
+		const int32 Index = m_NextUpdate++;
+		AHMCharacterBase* const Character = m_Characters[Index].Get();
+		if (Character == nullptr)
+		{
+			--m_NumPerBucket[(int32)m_Significances[Index]];
+			m_Characters.RemoveAtSwap(Index, 1, false);
+			m_Significances.RemoveAtSwap(Index, 1, false);
+
+			// The last zombie was swapped in, update it next
+			m_NextUpdate = Index;
+
+			if (m_Characters.Num() == 0)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		const FVector Location = Character->GetActorLocation();
+
+		float ClosestDistanceSq = MAX_flt;
+		bool bSeen = false;
+		for (int32 View = 0; View < ViewLocations.Num(); ++View)
+		{
+			const FVector ToCharacter = Location - ViewLocations[View];
+			const float DistanceSq = ToCharacter.SizeSquared();
+
+			ClosestDistanceSq = FMath::Min(ClosestDistanceSq, DistanceSq);
+			bSeen |= (ToCharacter | ViewDirections[View]) >= ViewConeCos * FMath::Sqrt(DistanceSq);
+		}
+
+		EZombieSignificance Significance = EZombieSignificance::Hidden;
+		if (ClosestDistanceSq <= NearDistanceSq)
+		{
+			Significance = EZombieSignificance::Near;
+		}
+		else if (bSeen)
+		{
+			Significance = ClosestDistanceSq <= MidDistanceSq ? EZombieSignificance::Mid : EZombieSignificance::Far;
+		}
+
+		if (Significance != m_Significances[Index])
+		{
+			--m_NumPerBucket[(int32)m_Significances[Index]];
+			++m_NumPerBucket[(int32)Significance];
+			m_Significances[Index] = Significance;
+
+			ApplySignificance(Character, Significance);
+		}
+	}
+
+	// A tick function with an interval longer than the frame only runs every Interval / DeltaTime frames
+	m_TicksSkipped = 0.0f;
+	for (int32 Bucket = 0; Bucket < (int32)EZombieSignificance::MAX; ++Bucket)
+	{
+		const float Interval = GetTickInterval((EZombieSignificance)Bucket);
+		if (Interval > DeltaTime)
+		{
+			m_TicksSkipped += m_NumPerBucket[Bucket] * TICK_FUNCTIONS_PER_ZOMBIE * (1.0f - DeltaTime / Interval);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_HMSignificanceNear, m_NumPerBucket[(int32)EZombieSignificance::Near]);
+	SET_DWORD_STAT(STAT_HMSignificanceMid, m_NumPerBucket[(int32)EZombieSignificance::Mid]);
+	SET_DWORD_STAT(STAT_HMSignificanceFar, m_NumPerBucket[(int32)EZombieSignificance::Far]);
+	SET_DWORD_STAT(STAT_HMSignificanceHidden, m_NumPerBucket[(int32)EZombieSignificance::Hidden]);
+	SET_FLOAT_STAT(STAT_HMSignificanceTicksSkipped, m_TicksSkipped);
+}
+
+float UHMSignificanceSubsystem::GetTickInterval(EZombieSignificance Significance) const
+{
+	switch (Significance)
+	{
+	case EZombieSignificance::Mid: return m_MidTickInterval;
+	case EZombieSignificance::Far: return m_FarTickInterval;
+	case EZombieSignificance::Hidden: return m_HiddenTickInterval;
+	}
+
+	return 0.0f;
+}
+
+void UHMSignificanceSubsystem::ApplySignificance(AHMCharacterBase* Character, EZombieSignificance Significance) const
+{
+	const float Interval = GetTickInterval(Significance);
+
+	Character->SetActorTickInterval(Interval);
+
+	if (UCharacterMovementComponent* const CharacterComp = Character->GetCharacterMovement())
+	{
+		CharacterComp->SetComponentTickInterval(Interval);
+	}
+
+	if (USkeletalMeshComponent* const SkelComp = Character->GetMesh())
+	{
+		SkelComp->SetComponentTickInterval(Interval);
+	}
+
+	// The AI logic
+	if (AController* const Controller = Character->GetController())
+	{
+		Controller->SetActorTickInterval(Interval);
+	}
+}
+
+void UHMSignificanceSubsystem::ResetSignificances()
+{
+	for (int32 Index = 0; Index < m_Characters.Num(); ++Index)
+	{
+		if (AHMCharacterBase* const Character = m_Characters[Index].Get())
+		{
+			ApplySignificance(Character, EZombieSignificance::Near);
+		}
+
+		m_Significances[Index] = EZombieSignificance::Near;
+	}
+
+	FMemory::Memzero(m_NumPerBucket);
+	m_NumPerBucket[(int32)EZombieSignificance::Near] = m_Characters.Num();
+	m_TicksSkipped = 0.0f;
+}
+
+void UHMSignificanceSubsystem::RegisterCharacter(AHMCharacterBase* Character)
+{
+	if (Character == nullptr || m_Characters.Contains(Character))
+	{
+		return;
+	}
+
+	// Lazily reserve so levels without zombies don't pay for it
+	if (m_Characters.Max() == 0)
+	{
+		m_Characters.Reserve(64);
+		m_Significances.Reserve(64);
+	}
+
+	m_Characters.Add(Character);
+	m_Significances.Add(EZombieSignificance::Near);
+	++m_NumPerBucket[(int32)EZombieSignificance::Near];
+}
+
+void UHMSignificanceSubsystem::UnregisterCharacter(AHMCharacterBase* Character)
+{
+	const int32 Index = m_Characters.IndexOfByKey(Character);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	ApplySignificance(Character, EZombieSignificance::Near);
+
+	--m_NumPerBucket[(int32)m_Significances[Index]];
+	m_Characters.RemoveAtSwap(Index, 1, false);
+	m_Significances.RemoveAtSwap(Index, 1, false);
+}
+
+void UHMSignificanceSubsystem::StartBenchmark(float Seconds)
+{
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("hm.Significance.Bench only runs on the server."));
+		return;
+	}
+
+	m_BenchmarkSeconds = FMath::Max(Seconds, 1.0f);
+	m_BenchmarkPhase = 1;
+	m_BenchmarkPhaseEndTime = FPlatformTime::Seconds() + m_BenchmarkSeconds;
+	FMemory::Memzero(m_BenchmarkGameThreadTime);
+	FMemory::Memzero(m_BenchmarkFrames);
+
+	UE_LOG(LogHordeMode, Log, TEXT("Significance benchmark: %.1f seconds with the buckets off, then %.1f seconds with them on."), m_BenchmarkSeconds, m_BenchmarkSeconds);
+}
+
+void UHMSignificanceSubsystem::UpdateBenchmark()
+{
+	// GGameThreadTime is the game thread time of the previous frame
+	const int32 Phase = m_BenchmarkPhase - 1;
+	m_BenchmarkGameThreadTime[Phase] += FPlatformTime::ToMilliseconds(GGameThreadTime);
+	++m_BenchmarkFrames[Phase];
+
+	if (FPlatformTime::Seconds() < m_BenchmarkPhaseEndTime)
+	{
+		return;
+	}
+
+	if (m_BenchmarkPhase == 1)
+	{
+		m_BenchmarkPhase = 2;
+		m_BenchmarkPhaseEndTime = FPlatformTime::Seconds() + m_BenchmarkSeconds;
+		return;
+	}
+
+	m_BenchmarkPhase = 0;
+
+	const double Off = m_BenchmarkGameThreadTime[0] / FMath::Max(m_BenchmarkFrames[0], 1);
+	const double On = m_BenchmarkGameThreadTime[1] / FMath::Max(m_BenchmarkFrames[1], 1);
+	UE_LOG(LogHordeMode, Log, TEXT("Significance benchmark: %.3f ms game thread with the buckets off (%d frames), %.3f ms with them on (%d frames), %.3f ms saved per frame"),
+		Off, m_BenchmarkFrames[0], On, m_BenchmarkFrames[1], Off - On);
+}
+
+void UHMSignificanceSubsystem::DumpStats() const
+{
+	UE_LOG(LogHordeMode, Log, TEXT("Significance (%s): %d zombies - %d near, %d mid, %d far, %d hidden, %.1f tick functions skipped last frame"),
+		IsEnabled() ? TEXT("on") : TEXT("off"), m_Characters.Num(),
+		m_NumPerBucket[(int32)EZombieSignificance::Near], m_NumPerBucket[(int32)EZombieSignificance::Mid],
+		m_NumPerBucket[(int32)EZombieSignificance::Far], m_NumPerBucket[(int32)EZombieSignificance::Hidden], m_TicksSkipped);
+}
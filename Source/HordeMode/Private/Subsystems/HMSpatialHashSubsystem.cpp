@@ -0,0 +1,354 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMSpatialHashSubsystem.h"
+#include "Base/HMCharacterBase.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spatial Hash Build"), STAT_HMSpatialHashBuild, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Spatial Hash Query"), STAT_HMSpatialHashQuery, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spatial Hash Characters"), STAT_HMSpatialHashCharacters, STATGROUP_HordeMode);
+
+/** Time the hash against brute force with NumEntities random positions. */
+static void RunSpatialHashBenchmark(int32 NumEntities, int32 NumQueries)
+{
+	const float Extent = 20000.0f;
+	const float Radius = 1000.0f;
+	const int32 K = 8;
+
+	FRandomStream Random(NumEntities);
+
+	TArray<FVector> Positions;
+	Positions.Reserve(NumEntities);
+	for (int32 Index = 0; Index < NumEntities; ++Index)
+	{
+		Positions.Add(FVector(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), Random.FRandRange(0.0f, 500.0f)));
+	}
+
+	TArray<FVector> Centers;
+	Centers.Reserve(NumQueries);
+	for (int32 Index = 0; Index < NumQueries; ++Index)
+	{
+		Centers.Add(FVector(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), 250.0f));
+	}
+
+	FHMSpatialHash Hash;
+	TArray<int32> Indices;
+
+	double StartTime = FPlatformTime::Seconds();
+	Hash.Build(Positions, Radius);
+	const double BuildTime = FPlatformTime::Seconds() - StartTime;
+
+	int32 HashFound = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& Center : Centers)
+	{
+		Hash.QueryRadius(Center, Radius, Indices);
+		HashFound += Indices.Num();
+	}
+	const double HashRadiusTime = FPlatformTime::Seconds() - StartTime;
+
+	int32 BruteFound = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& Center : Centers)
+	{
+		Indices.Reset();
+		for (int32 Index = 0; Index < Positions.Num(); ++Index)
+		{
+			if (FVector::DistSquared(Positions[Index], Center) <= Radius * Radius)
+			{
+				Indices.Add(Index);
+			}
+		}
+		BruteFound += Indices.Num();
+	}
+	const double BruteRadiusTime = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& Center : Centers)
+	{
+		Hash.QueryNearest(Center, K, Extent * 4.0f, Indices);
+	}
+	const double HashNearestTime = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& Center : Centers)
+	{
+		Hash.QueryCone(Center, FVector::ForwardVector, 45.0f, Radius * 2.0f, Indices);
+	}
+	const double HashConeTime = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogHordeMode, Log, TEXT("Spatial hash benchmark, %d entities, %d queries: build %.3f ms, radius %.3f ms (brute force %.3f ms, %s), %d-nearest %.3f ms, cone %.3f ms"),
+		NumEntities, NumQueries, BuildTime * 1000.0, HashRadiusTime * 1000.0, BruteRadiusTime * 1000.0,
+		HashFound == BruteFound ? TEXT("same results") : TEXT("DIFFERENT RESULTS"), K, HashNearestTime * 1000.0, HashConeTime * 1000.0);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSpatialHashBench(
+	TEXT("hm.SpatialHash.Bench"),
+	TEXT("Time building and querying the spatial hash against brute force with 1k and 10k random entities. Usage: hm.SpatialHash.Bench [NumQueries=1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumQueries = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+
+		RunSpatialHashBenchmark(1000, NumQueries);
+		RunSpatialHashBenchmark(10000, NumQueries);
+	}));
+
+void FHMSpatialHash::Build(TArrayView<const FVector> InPositions, float InCellSize)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMSpatialHashBuild);
+
+	CellSize = FMath::Max(InCellSize, 1.0f);
+	InvCellSize = 1.0f / CellSize;
+
+	const int32 NumEntries = InPositions.Num();
+	Positions.Reset(NumEntries);
+	Positions.Append(InPositions.GetData(), NumEntries);
+
+	// About two buckets per entry keeps collisions down
+	const uint32 NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(NumEntries * 2, 16));
+	BucketMask = NumBuckets - 1;
+
+	// Counting sort by bucket
+	BucketStarts.Reset(NumBuckets + 1);
+	BucketStarts.AddZeroed(NumBuckets + 1);
+	EntryBuckets.SetNumUninitialized(NumEntries, false);
+
+	for (int32 Index = 0; Index < NumEntries; ++Index)
+	{
+		const uint32 Bucket = GetBucket(GetCellCoord(Positions[Index].X), GetCellCoord(Positions[Index].Y));
+		EntryBuckets[Index] = Bucket;
+		++BucketStarts[Bucket + 1];
+	}
+
+	for (uint32 Bucket = 1; Bucket <= NumBuckets; ++Bucket)
+	{
+		BucketStarts[Bucket] += BucketStarts[Bucket - 1];
+	}
+
+	SortedIndices.SetNumUninitialized(NumEntries, false);
+	SortedPositions.SetNumUninitialized(NumEntries, false);
+
+	// BucketStarts[N] is used as the write cursor of bucket N, it ends up at the start of bucket N + 1
+	for (int32 Index = 0; Index < NumEntries; ++Index)
+	{
+		const int32 Slot = BucketStarts[EntryBuckets[Index]]++;
+		SortedIndices[Slot] = Index;
+		SortedPositions[Slot] = Positions[Index];
+	}
+
+	for (uint32 Bucket = NumBuckets; Bucket > 0; --Bucket)
+	{
+		BucketStarts[Bucket] = BucketStarts[Bucket - 1];
+	}
+
+	BucketStarts[0] = 0;
+}
+
+void FHMSpatialHash::QueryRadius(const FVector& Center, float Radius, TArray<int32>& OutIndices) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMSpatialHashQuery);
+
+	OutIndices.Reset();
+	if (Positions.Num() == 0 || Radius < 0.0f)
+	{
+		return;
+	}
+
+	const float RadiusSq = FMath::Square(Radius);
+
+	const int32 MinX = GetCellCoord(Center.X - Radius);
+	const int32 MaxX = GetCellCoord(Center.X + Radius);
+	const int32 MinY = GetCellCoord(Center.Y - Radius);
+	const int32 MaxY = GetCellCoord(Center.Y + Radius);
+
+	// More cells than buckets, every bucket would be visited (more than once) anyway
+	if ((int64)(MaxX - MinX + 1) * (MaxY - MinY + 1) >= BucketStarts.Num())
+	{
+		for (int32 Index = 0; Index < Positions.Num(); ++Index)
+		{
+			if (FVector::DistSquared(Positions[Index], Center) <= RadiusSq)
+			{
+				OutIndices.Add(Index);
+			}
+		}
+
+		return;
+	}
+
+	for (int32 Y = MinY; Y <= MaxY; ++Y)
+	{
+		for (int32 X = MinX; X <= MaxX; ++X)
+		{
+			const uint32 Bucket = GetBucket(X, Y);
+			const int32 End = BucketStarts[Bucket + 1];
+
+			for (int32 Slot = BucketStarts[Bucket]; Slot < End; ++Slot)
+			{
+				const FVector& Position = SortedPositions[Slot];
+
+				// Other cells can share the bucket, only take this cell's entries so nothing is found twice
+				if (GetCellCoord(Position.X) != X || GetCellCoord(Position.Y) != Y)
+				{
+					continue;
+				}
+
+				if (FVector::DistSquared(Position, Center) <= RadiusSq)
+				{
+					OutIndices.Add(SortedIndices[Slot]);
+				}
+			}
+		}
+	}
+}
+
+void FHMSpatialHash::QueryCone(const FVector& Origin, const FVector& Direction, float HalfAngle, float Range, TArray<int32>& OutIndices) const
+{
+	QueryRadius(Origin, Range, OutIndices);
+
+	const FVector Forward = Direction.GetSafeNormal();
+	const float ConeCos = FMath::Cos(FMath::DegreesToRadians(HalfAngle));
+
+	OutIndices.RemoveAllSwap([this, &Origin, &Forward, ConeCos](int32 Index)
+	{
+		const FVector ToEntry = Positions[Index] - Origin;
+		return (ToEntry | Forward) < ConeCos * ToEntry.Size();
+	}, false);
+}
+
+UHMSpatialHashSubsystem::UHMSpatialHashSubsystem() : m_CellSize(500.0f), m_bInitialized(false)
+{
+}
+
+void UHMSpatialHashSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMSpatialHashSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	DEC_DWORD_STAT_BY(STAT_HMSpatialHashCharacters, m_LiveCharacters.Num());
+
+	m_Characters.Empty();
+	m_LiveCharacters.Empty();
+	m_LivePositions.Empty();
+	m_LiveTeamMasks.Empty();
+	m_Hash.Build(TArrayView<const FVector>(), m_CellSize);
+
+	Super::Deinitialize();
+}
+
+bool UHMSpatialHashSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMSpatialHashSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMSpatialHashSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMSpatialHashSubsystem::Tick(float DeltaTime)
+{
+	DEC_DWORD_STAT_BY(STAT_HMSpatialHashCharacters, m_LiveCharacters.Num());
+
+	m_LiveCharacters.Reset();
+	m_LivePositions.Reset();
+	m_LiveTeamMasks.Reset();
+
+	for (int32 Index = m_Characters.Num() - 1; Index >= 0; --Index)
+	{
+		AHMCharacterBase* const Character = m_Characters[Index].Get();
+		if (Character == nullptr)
+		{
+			m_Characters.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		// Dead and pooled characters aren't in the hash
+		if (Character->IsAlive() && !Character->IsHidden())
+		{
+			m_LiveCharacters.Add(Character);
+			m_LivePositions.Add(Character->GetActorLocation());
+			m_LiveTeamMasks.Add(GetTeamMask(Character->GetTeamType()));
+		}
+	}
+
+	m_Hash.Build(m_LivePositions, m_CellSize);
+
+	INC_DWORD_STAT_BY(STAT_HMSpatialHashCharacters, m_LiveCharacters.Num());
+}
+
+void UHMSpatialHashSubsystem::RegisterCharacter(AHMCharacterBase* Character)
+{
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	// Lazily reserve so worlds without characters don't pay for it
+	if (m_Characters.Max() == 0)
+	{
+		m_Characters.Reserve(64);
+	}
+
+	m_Characters.AddUnique(Character);
+}
+
+void UHMSpatialHashSubsystem::UnregisterCharacter(AHMCharacterBase* Character)
+{
+	m_Characters.RemoveSingleSwap(Character, false);
+
+	// It's destroyed before the next rebuild
+	const int32 LiveIndex = m_LiveCharacters.IndexOfByKey(Character);
+	if (LiveIndex != INDEX_NONE)
+	{
+		m_LiveCharacters[LiveIndex] = nullptr;
+		m_LiveTeamMasks[LiveIndex] = 0;
+	}
+}
+
+void UHMSpatialHashSubsystem::GatherCharacters(const TArray<int32>& Indices, uint8 TeamMask, TArray<AHMCharacterBase*>& OutCharacters) const
+{
+	OutCharacters.Reset();
+
+	for (const int32 Index : Indices)
+	{
+		if ((m_LiveTeamMasks[Index] & TeamMask) != 0)
+		{
+			OutCharacters.Add(m_LiveCharacters[Index]);
+		}
+	}
+}
+
+void UHMSpatialHashSubsystem::QueryRadius(const FVector& Center, float Radius, TArray<AHMCharacterBase*>& OutCharacters, uint8 TeamMask) const
+{
+	m_Hash.QueryRadius(Center, Radius, m_QueryIndices);
+	GatherCharacters(m_QueryIndices, TeamMask, OutCharacters);
+}
+
+void UHMSpatialHashSubsystem::QueryNearest(const FVector& Center, int32 K, float MaxRadius, TArray<AHMCharacterBase*>& OutCharacters, uint8 TeamMask) const
+{
+	m_Hash.QueryNearest(Center, K, MaxRadius, m_QueryIndices, [this, TeamMask](int32 Index) { return (m_LiveTeamMasks[Index] & TeamMask) != 0; });
+	GatherCharacters(m_QueryIndices, TeamMask, OutCharacters);
+}
+
+AHMCharacterBase* UHMSpatialHashSubsystem::FindNearest(const FVector& Center, float MaxRadius, uint8 TeamMask) const
+{
+	m_Hash.QueryNearest(Center, 1, MaxRadius, m_QueryIndices, [this, TeamMask](int32 Index) { return (m_LiveTeamMasks[Index] & TeamMask) != 0; });
+	return m_QueryIndices.Num() > 0 ? m_LiveCharacters[m_QueryIndices[0]] : nullptr;
+}
+
+void UHMSpatialHashSubsystem::QueryCone(const FVector& Origin, const FVector& Direction, float HalfAngle, float Range, TArray<AHMCharacterBase*>& OutCharacters, uint8 TeamMask) const
+{
+	m_Hash.QueryCone(Origin, Direction, HalfAngle, Range, m_QueryIndices);
+	GatherCharacters(m_QueryIndices, TeamMask, OutCharacters);
+}
@@ -0,0 +1,485 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMSpawnDirectorSubsystem.h"
+#include "AI/HMAICharacterBase.h"
+#include "Base/HMGameStateBase.h"
+#include "Subsystems/HMZombiePoolSubsystem.h"
+#include "HMHelpers.h"
+#include "HordeMode.h"
+
+#include "Engine/DataTable.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+#include "NavigationSystem.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spawn Director"), STAT_HMSpawnDirector, STATGROUP_HordeMode);
+DECLARE_CYCLE_STAT(TEXT("Spawn Director Spawn"), STAT_HMSpawnDirectorSpawn, STATGROUP_HordeMode);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Zombies Spawned"), STAT_HMZombiesSpawned, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Zombies Alive"), STAT_HMZombiesAlive, STATGROUP_HordeMode);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Zombie Spawn Cost (ms)"), STAT_HMZombieSpawnCost, STATGROUP_HordeMode);
+
+static FAutoConsoleCommandWithWorld CmdSpawnDirectorStats(
+	TEXT("hm.SpawnDirector.Stats"),
+	TEXT("Log the wave, alive zombies and the average/max cost of spawning a zombie."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMSpawnDirectorSubsystem* const SpawnDirector = World ? World->GetSubsystem<UHMSpawnDirectorSubsystem>() : nullptr)
+		{
+			SpawnDirector->DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSpawnDirectorBench(
+	TEXT("hm.SpawnDirector.Bench"),
+	TEXT("Run waves without and then with the zombie pool (killing every zombie right away) and log the spawn and GC cost. Usage: hm.SpawnDirector.Bench [NumWaves=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UHMSpawnDirectorSubsystem* const SpawnDirector = World ? World->GetSubsystem<UHMSpawnDirectorSubsystem>() : nullptr)
+		{
+			SpawnDirector->StartBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10);
+		}
+	}));
+
+UHMSpawnDirectorSubsystem::UHMSpawnDirectorSubsystem() : m_MaxAliveZombies(40), m_MaxSpawnsPerFrame(4), m_SpawnBudgetMs(2.0f), m_ExtraZombiesPerWave(6),
+	m_SpawnPointTag("ZombieSpawn"), m_FallbackSpawnRadius(3000.0f), m_bInitialized(false), m_Wave(0), m_WaveNumZombies(0), m_ZombiesToSpawn(0), m_ZombiesRemaining(0),
+	m_WaveStartTime(0.0f), m_bGatheredSpawnPoints(false), m_NextSpawnPoint(0), m_TotalSpawned(0), m_TotalSpawnTime(0.0), m_MaxSpawnTime(0.0),
+	m_BenchmarkWavesLeft(0), m_BenchmarkNumWaves(0), m_bBenchmarkPooled(false), m_bBenchmarkWaitingForGarbageCollection(false), m_GarbageCollectionStartTime(0.0)
+{
+}
+
+void UHMSpawnDirectorSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMSpawnDirectorSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(m_PreGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(m_PostGarbageCollectHandle);
+
+	m_AliveZombies.Empty();
+	m_SpawnPoints.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMSpawnDirectorSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UHMSpawnDirectorSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMSpawnDirectorSubsystem, STATGROUP_HordeMode);
+}
+
+void UHMSpawnDirectorSubsystem::Tick(float DeltaTime)
+{
+	UWorld* const World = GetWorld();
+	if (World->GetNetMode() == NM_Client || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HMSpawnDirector);
+
+	if (m_bBenchmarkWaitingForGarbageCollection)
+	{
+		return;
+	}
+
+	const AHMGameStateBase* const GameState = World->GetGameState<AHMGameStateBase>();
+	if (GameState == nullptr)
+	{
+		return;
+	}
+
+	switch (GameState->GetWaveState())
+	{
+	case EWaveState::WaitingToStart:
+		// Wait for someone to kill
+		if (GameState->PlayerArray.Num() > 0)
+		{
+			StartIntermission(1);
+		}
+		break;
+	case EWaveState::Intermission:
+		if (World->GetTimeSeconds() >= m_WaveStartTime)
+		{
+			StartWave();
+		}
+		break;
+	case EWaveState::InProgress:
+		UpdateAliveZombies();
+		SpawnZombies();
+
+		if (m_BenchmarkWavesLeft > 0)
+		{
+			KillZombiesForBenchmark();
+			UpdateAliveZombies();
+		}
+
+		if (m_ZombiesRemaining <= 0)
+		{
+			if (m_BenchmarkWavesLeft > 0)
+			{
+				OnBenchmarkWaveFinished();
+			}
+			else
+			{
+				StartIntermission(m_Wave + 1);
+			}
+		}
+		break;
+	}
+}
+
+void UHMSpawnDirectorSubsystem::StartIntermission(int32 Wave)
+{
+	const AHMGameStateBase* const GameState = GetWorld()->GetGameState<AHMGameStateBase>();
+	const UDataTable* const WaveTable = GameState ? GameState->GetWaveDataTable() : nullptr;
+
+	m_Wave = Wave;
+
+	// Row order is the wave order, waves past the end repeat the last row with more zombies
+	FWaveData WaveData;
+	if (WaveTable != nullptr && WaveTable->GetRowStruct() != nullptr && WaveTable->GetRowStruct()->IsChildOf(FWaveData::StaticStruct()))
+	{
+		const TArray<FName> RowNames = WaveTable->GetRowNames();
+		if (RowNames.Num() > 0)
+		{
+			const int32 RowIndex = FMath::Min(Wave, RowNames.Num()) - 1;
+			WaveData = *WaveTable->FindRow<FWaveData>(RowNames[RowIndex], TEXT("UHMSpawnDirectorSubsystem"));
+			WaveData.NumZombies += FMath::Max(Wave - RowNames.Num(), 0) * m_ExtraZombiesPerWave;
+		}
+	}
+	else
+	{
+		WaveData.NumZombies += (Wave - 1) * m_ExtraZombiesPerWave;
+	}
+
+	m_WaveZombieClass = WaveData.ZombieClass ? WaveData.ZombieClass : m_DefaultZombieClass;
+	m_WaveNumZombies = FMath::Max(WaveData.NumZombies, 1);
+	m_WaveStartTime = GetWorld()->GetTimeSeconds() + (m_BenchmarkWavesLeft > 0 ? 0.0f : WaveData.IntermissionTime);
+
+	if (m_WaveZombieClass == nullptr)
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("Wave %d doesn't have a zombie class and there's no default zombie class, nothing will spawn."), Wave);
+	}
+
+	// Fill the pool while the players wait
+	if (m_WaveZombieClass != nullptr && ShouldUsePool())
+	{
+		if (UHMZombiePoolSubsystem* const ZombiePool = GetWorld()->GetSubsystem<UHMZombiePoolSubsystem>())
+		{
+			ZombiePool->Prewarm(m_WaveZombieClass, FMath::Min(m_WaveNumZombies, m_MaxAliveZombies));
+		}
+	}
+
+	UpdateGameState(EWaveState::Intermission);
+}
+
+void UHMSpawnDirectorSubsystem::StartWave()
+{
+	m_ZombiesToSpawn = m_WaveZombieClass ? m_WaveNumZombies : 0;
+	m_ZombiesRemaining = m_ZombiesToSpawn;
+
+	UpdateGameState(EWaveState::InProgress);
+}
+
+void UHMSpawnDirectorSubsystem::UpdateAliveZombies()
+{
+	const int32 NumKilled = m_AliveZombies.RemoveAllSwap([](const TWeakObjectPtr<AHMAICharacterBase>& Zombie) { return !Zombie.IsValid() || Zombie->IsDead(); }, false);
+	if (NumKilled > 0)
+	{
+		m_ZombiesRemaining -= NumKilled;
+		DEC_DWORD_STAT_BY(STAT_HMZombiesAlive, NumKilled);
+
+		if (AHMGameStateBase* const GameState = GetWorld()->GetGameState<AHMGameStateBase>())
+		{
+			GameState->SetZombiesRemaining(FMath::Max(m_ZombiesRemaining, 0));
+		}
+	}
+}
+
+void UHMSpawnDirectorSubsystem::SpawnZombies()
+{
+	if (m_ZombiesToSpawn <= 0)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = m_SpawnBudgetMs / 1000.0;
+
+	int32 NumSpawned = 0;
+	while (m_ZombiesToSpawn > 0 && m_AliveZombies.Num() < m_MaxAliveZombies && NumSpawned < m_MaxSpawnsPerFrame && FPlatformTime::Seconds() - StartTime < Budget)
+	{
+		FTransform SpawnTransform;
+		if (!GetSpawnTransform(SpawnTransform))
+		{
+			break;
+		}
+
+		const double SpawnStartTime = FPlatformTime::Seconds();
+
+		AHMAICharacterBase* const Zombie = SpawnZombie(m_WaveZombieClass, SpawnTransform);
+
+		const double SpawnTime = FPlatformTime::Seconds() - SpawnStartTime;
+
+		// A blocked spawn point still counts against this frame's budget, the next frame tries the next spawn point
+		++NumSpawned;
+
+		if (Zombie == nullptr)
+		{
+			continue;
+		}
+
+		m_AliveZombies.Add(Zombie);
+		--m_ZombiesToSpawn;
+
+		++m_TotalSpawned;
+		m_TotalSpawnTime += SpawnTime;
+		m_MaxSpawnTime = FMath::Max(m_MaxSpawnTime, SpawnTime);
+
+		if (m_BenchmarkWavesLeft > 0)
+		{
+			FBenchmarkResult& Result = m_BenchmarkResults[m_bBenchmarkPooled ? 1 : 0];
+			++Result.NumSpawned;
+			Result.SpawnTime += SpawnTime;
+		}
+
+		INC_DWORD_STAT(STAT_HMZombiesSpawned);
+		INC_DWORD_STAT(STAT_HMZombiesAlive);
+		SET_FLOAT_STAT(STAT_HMZombieSpawnCost, SpawnTime * 1000.0);
+	}
+}
+
+bool UHMSpawnDirectorSubsystem::GetSpawnTransform(FTransform& OutTransform)
+{
+	UWorld* const World = GetWorld();
+
+	if (!m_bGatheredSpawnPoints)
+	{
+		m_bGatheredSpawnPoints = true;
+
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			if (It->ActorHasTag(m_SpawnPointTag))
+			{
+				m_SpawnPoints.Add(It->GetActorTransform());
+			}
+		}
+
+		if (m_SpawnPoints.Num() == 0)
+		{
+			UE_LOG(LogHordeMode, Log, TEXT("No actors tagged '%s', zombies spawn on the navmesh around the players."), *m_SpawnPointTag.ToString());
+		}
+	}
+
+	if (m_SpawnPoints.Num() > 0)
+	{
+		OutTransform = m_SpawnPoints[m_NextSpawnPoint++ % m_SpawnPoints.Num()];
+		return true;
+	}
+
+	// Around a random player
+	TArray<AController*, TInlineAllocator<8>> PlayerControllers;
+	UHMHelpers::GetPlayerControllers(World, PlayerControllers);
+
+	TArray<const APawn*, TInlineAllocator<8>> Players;
+	for (const AController* const PlayerController : PlayerControllers)
+	{
+		if (const APawn* const Pawn = PlayerController->GetPawn())
+		{
+			Players.Add(Pawn);
+		}
+	}
+
+	UNavigationSystemV1* const NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	if (Players.Num() == 0 || NavSystem == nullptr)
+	{
+		return false;
+	}
+
+	FNavLocation Location;
+	if (!NavSystem->GetRandomReachablePointInRadius(Players[FMath::RandHelper(Players.Num())]->GetActorLocation(), m_FallbackSpawnRadius, Location))
+	{
+		return false;
+	}
+
+	OutTransform = FTransform(FRotator(0.0f, FMath::FRandRange(-180.0f, 180.0f), 0.0f), Location.Location + FVector(0.0f, 0.0f, 100.0f));
+	return true;
+}
+
+AHMAICharacterBase* UHMSpawnDirectorSubsystem::SpawnZombie(TSubclassOf<AHMAICharacterBase> ZombieClass, const FTransform& Transform)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HMSpawnDirectorSpawn);
+
+	if (ShouldUsePool())
+	{
+		if (UHMZombiePoolSubsystem* const ZombiePool = GetWorld()->GetSubsystem<UHMZombiePoolSubsystem>())
+		{
+			return ZombiePool->AcquireZombie(ZombieClass, Transform);
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+
+	AHMAICharacterBase* const Zombie = GetWorld()->SpawnActor<AHMAICharacterBase>(ZombieClass, Transform, SpawnParams);
+	if (Zombie != nullptr && Zombie->GetController() == nullptr)
+	{
+		Zombie->SpawnDefaultController();
+	}
+
+	return Zombie;
+}
+
+void UHMSpawnDirectorSubsystem::UpdateGameState(EWaveState State)
+{
+	if (AHMGameStateBase* const GameState = GetWorld()->GetGameState<AHMGameStateBase>())
+	{
+		GameState->SetWaveState(State, m_Wave, m_WaveStartTime);
+		GameState->SetZombiesRemaining(State == EWaveState::InProgress ? m_ZombiesRemaining : m_WaveNumZombies);
+	}
+}
+
+void UHMSpawnDirectorSubsystem::DumpStats() const
+{
+	UE_LOG(LogHordeMode, Log, TEXT("Spawn director: wave %d, %d alive, %d to spawn, %d remaining, %d spawned in total, %.3f ms average spawn, %.3f ms max spawn"),
+		m_Wave, m_AliveZombies.Num(), m_ZombiesToSpawn, m_ZombiesRemaining, m_TotalSpawned,
+		m_TotalSpawned > 0 ? m_TotalSpawnTime / m_TotalSpawned * 1000.0 : 0.0, m_MaxSpawnTime * 1000.0);
+}
+
+bool UHMSpawnDirectorSubsystem::ShouldUsePool() const
+{
+	return m_BenchmarkWavesLeft > 0 ? m_bBenchmarkPooled : UHMZombiePoolSubsystem::IsEnabled();
+}
+
+void UHMSpawnDirectorSubsystem::StartBenchmark(int32 NumWaves)
+{
+	UWorld* const World = GetWorld();
+	if (World->GetNetMode() == NM_Client || !World->IsGameWorld())
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("hm.SpawnDirector.Bench only runs on the server."));
+		return;
+	}
+
+	if (m_BenchmarkWavesLeft > 0)
+	{
+		UE_LOG(LogHordeMode, Warning, TEXT("A spawn director benchmark is already running."));
+		return;
+	}
+
+	m_BenchmarkNumWaves = FMath::Max(NumWaves, 1);
+	m_BenchmarkWavesLeft = m_BenchmarkNumWaves;
+	m_bBenchmarkPooled = false;
+	m_bBenchmarkWaitingForGarbageCollection = false;
+	m_BenchmarkResults[0] = FBenchmarkResult();
+	m_BenchmarkResults[1] = FBenchmarkResult();
+
+	m_PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &UHMSpawnDirectorSubsystem::OnPreGarbageCollect);
+	m_PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &UHMSpawnDirectorSubsystem::OnPostGarbageCollect);
+
+	// Start from a clean slate
+	KillZombiesForBenchmark();
+	UpdateAliveZombies();
+
+	UE_LOG(LogHordeMode, Log, TEXT("Spawn director benchmark: %d waves without the zombie pool, then %d waves with it."), m_BenchmarkNumWaves, m_BenchmarkNumWaves);
+
+	StartIntermission(1);
+}
+
+void UHMSpawnDirectorSubsystem::KillZombiesForBenchmark()
+{
+	UHMZombiePoolSubsystem* const ZombiePool = GetWorld()->GetSubsystem<UHMZombiePoolSubsystem>();
+
+	for (const TWeakObjectPtr<AHMAICharacterBase>& Zombie : m_AliveZombies)
+	{
+		if (AHMAICharacterBase* const ZombiePtr = Zombie.Get())
+		{
+			if (ZombiePtr->IsAlive())
+			{
+				ZombiePtr->TakeDamage(ZombiePtr->GetHealth(), FDamageEvent(), nullptr, nullptr);
+			}
+
+			// Skip the corpse time, that's the same for both halves
+			if (!ZombiePtr->IsPooled() || ZombiePool == nullptr)
+			{
+				ZombiePtr->Destroy();
+			}
+		}
+	}
+
+	if (ZombiePool != nullptr)
+	{
+		ZombiePool->ReleaseCorpses();
+	}
+}
+
+void UHMSpawnDirectorSubsystem::OnBenchmarkWaveFinished()
+{
+	// Collect the garbage of every wave so both halves pay for what they leave behind, the benchmark continues once it's done
+	GEngine->ForceGarbageCollection(true);
+	m_bBenchmarkWaitingForGarbageCollection = true;
+}
+
+void UHMSpawnDirectorSubsystem::AdvanceBenchmark()
+{
+	if (--m_BenchmarkWavesLeft > 0)
+	{
+		StartIntermission(m_Wave + 1);
+		return;
+	}
+
+	if (!m_bBenchmarkPooled)
+	{
+		m_bBenchmarkPooled = true;
+		m_BenchmarkWavesLeft = m_BenchmarkNumWaves;
+
+		StartIntermission(1);
+		return;
+	}
+
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(m_PreGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(m_PostGarbageCollectHandle);
+
+	for (int32 Index = 0; Index < 2; ++Index)
+	{
+		const FBenchmarkResult& Result = m_BenchmarkResults[Index];
+		UE_LOG(LogHordeMode, Log, TEXT("Spawn director benchmark (%s, %d waves): %d zombies spawned in %.3f ms (%.3f ms average), %d garbage collections in %.3f ms"),
+			Index == 0 ? TEXT("unpooled") : TEXT("pooled"), m_BenchmarkNumWaves, Result.NumSpawned, Result.SpawnTime * 1000.0,
+			Result.NumSpawned > 0 ? Result.SpawnTime / Result.NumSpawned * 1000.0 : 0.0, Result.NumGarbageCollections, Result.GarbageCollectionTime * 1000.0);
+	}
+
+	// Back to a normal game
+	StartIntermission(1);
+}
+
+void UHMSpawnDirectorSubsystem::OnPreGarbageCollect()
+{
+	m_GarbageCollectionStartTime = FPlatformTime::Seconds();
+}
+
+void UHMSpawnDirectorSubsystem::OnPostGarbageCollect()
+{
+	FBenchmarkResult& Result = m_BenchmarkResults[m_bBenchmarkPooled ? 1 : 0];
+	++Result.NumGarbageCollections;
+	Result.GarbageCollectionTime += FPlatformTime::Seconds() - m_GarbageCollectionStartTime;
+
+	if (m_bBenchmarkWaitingForGarbageCollection)
+	{
+		m_bBenchmarkWaitingForGarbageCollection = false;
+		AdvanceBenchmark();
+	}
+}
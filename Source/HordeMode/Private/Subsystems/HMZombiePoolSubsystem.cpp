@@ -0,0 +1,248 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+
+#include "Subsystems/HMZombiePoolSubsystem.h"
+#include "AI/HMAICharacterBase.h"
+#include "HordeMode.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Zombie Pool Free"), STAT_HMZombiePoolFree, STATGROUP_HordeMode);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Zombie Pool Corpses"), STAT_HMZombiePoolCorpses, STATGROUP_HordeMode);
+
+static TAutoConsoleVariable<int32> CVarZombiePool(
+	TEXT("hm.ZombiePool"),
+	1,
+	TEXT("Reuse dead zombies instead of destroying them and spawning new ones.\n")
+	TEXT("0: off, every zombie is spawned and torn off when it dies\n")
+	TEXT("1: on (default)"),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld CmdZombiePoolStats(
+	TEXT("hm.ZombiePool.Stats"),
+	TEXT("Log the zombie pool's size and hit/miss counters."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UHMZombiePoolSubsystem* const ZombiePool = World ? World->GetSubsystem<UHMZombiePoolSubsystem>() : nullptr)
+		{
+			ZombiePool->DumpStats();
+		}
+	}));
+
+UHMZombiePoolSubsystem::UHMZombiePoolSubsystem() : m_CorpseTime(10.0f), m_MaxPrewarmPerFrame(2), m_bInitialized(false), m_PrewarmCount(0),
+	m_NumHits(0), m_NumMisses(0), m_NumReleased(0)
+{
+}
+
+void UHMZombiePoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_bInitialized = true;
+}
+
+void UHMZombiePoolSubsystem::Deinitialize()
+{
+	m_bInitialized = false;
+
+	m_Pools.Empty();
+	m_Corpses.Empty();
+	m_CorpseReleaseTimes.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UHMZombiePoolSubsystem::IsTickable() const
+{
+	return m_bInitialized && !HasAnyFlags(RF_ClassDefaultObject) && (m_Corpses.Num() > 0 || m_PrewarmCount > 0);
+}
+
+TStatId UHMZombiePoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHMZombiePoolSubsystem, STATGROUP_HordeMode);
+}
+
+bool UHMZombiePoolSubsystem::IsEnabled()
+{
+	return CVarZombiePool.GetValueOnGameThread() != 0;
+}
+
+void UHMZombiePoolSubsystem::Tick(float DeltaTime)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// Corpses are added in death order so the ones that are due are at the front
+	int32 NumDue = 0;
+	while (NumDue < m_Corpses.Num() && m_CorpseReleaseTimes[NumDue] <= Now)
+	{
+		if (AHMAICharacterBase* const Zombie = m_Corpses[NumDue].Get())
+		{
+			ReleaseZombie(Zombie);
+		}
+
+		++NumDue;
+	}
+
+	if (NumDue > 0)
+	{
+		m_Corpses.RemoveAt(0, NumDue, false);
+		m_CorpseReleaseTimes.RemoveAt(0, NumDue, false);
+		DEC_DWORD_STAT_BY(STAT_HMZombiePoolCorpses, NumDue);
+	}
+
+	if (m_PrewarmCount > 0 && m_PrewarmClass != nullptr)
+	{
+		FHMZombiePool& Pool = m_Pools.FindOrAdd(m_PrewarmClass);
+
+		for (int32 Index = 0; Index < m_MaxPrewarmPerFrame && Pool.NumZombies < m_PrewarmCount; ++Index)
+		{
+			if (SpawnPooledZombie(m_PrewarmClass, FTransform::Identity, true) == nullptr)
+			{
+				break;
+			}
+		}
+
+		if (Pool.NumZombies >= m_PrewarmCount)
+		{
+			m_PrewarmCount = 0;
+		}
+	}
+}
+
+AHMAICharacterBase* UHMZombiePoolSubsystem::SpawnPooledZombie(TSubclassOf<AHMAICharacterBase> ZombieClass, const FTransform& Transform, bool bDeactivate)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = bDeactivate ? ESpawnActorCollisionHandlingMethod::AlwaysSpawn : ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+
+	AHMAICharacterBase* const Zombie = GetWorld()->SpawnActor<AHMAICharacterBase>(ZombieClass, Transform, SpawnParams);
+	if (Zombie == nullptr)
+	{
+		return nullptr;
+	}
+
+	if (Zombie->GetController() == nullptr)
+	{
+		Zombie->SpawnDefaultController();
+	}
+
+	Zombie->SetPooled();
+
+	FHMZombiePool& Pool = m_Pools.FindOrAdd(ZombieClass);
+	++Pool.NumZombies;
+
+	if (bDeactivate)
+	{
+		Zombie->DeactivateForPool();
+		Pool.Free.Add(Zombie);
+		INC_DWORD_STAT(STAT_HMZombiePoolFree);
+	}
+
+	return Zombie;
+}
+
+AHMAICharacterBase* UHMZombiePoolSubsystem::AcquireZombie(TSubclassOf<AHMAICharacterBase> ZombieClass, const FTransform& Transform)
+{
+	if (ZombieClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	FHMZombiePool* const Pool = m_Pools.Find(ZombieClass);
+	if (Pool != nullptr && Pool->Free.Num() > 0)
+	{
+		AHMAICharacterBase* const Zombie = Pool->Free.Last();
+		if (Zombie == nullptr || Zombie->IsPendingKill())
+		{
+			// Destroyed by something else (level streaming etc), forget about it
+			Pool->Free.Pop(false);
+			--Pool->NumZombies;
+			DEC_DWORD_STAT(STAT_HMZombiePoolFree);
+
+			return AcquireZombie(ZombieClass, Transform);
+		}
+
+		if (!Zombie->ActivateFromPool(Transform))
+		{
+			return nullptr;
+		}
+
+		Pool->Free.Pop(false);
+		DEC_DWORD_STAT(STAT_HMZombiePoolFree);
+		++m_NumHits;
+
+		return Zombie;
+	}
+
+	AHMAICharacterBase* const Zombie = SpawnPooledZombie(ZombieClass, Transform, false);
+	if (Zombie != nullptr)
+	{
+		++m_NumMisses;
+	}
+
+	return Zombie;
+}
+
+void UHMZombiePoolSubsystem::ReleaseZombie(AHMAICharacterBase* Zombie)
+{
+	// Alive zombies were reused already (a corpse timer that ran out after the corpse was evicted)
+	if (Zombie == nullptr || !Zombie->IsPooled() || Zombie->IsPendingKill() || Zombie->IsAlive())
+	{
+		return;
+	}
+
+	FHMZombiePool& Pool = m_Pools.FindOrAdd(Zombie->GetClass());
+	if (Pool.Free.Contains(Zombie))
+	{
+		return;
+	}
+
+	Zombie->DeactivateForPool();
+	Pool.Free.Add(Zombie);
+	INC_DWORD_STAT(STAT_HMZombiePoolFree);
+	++m_NumReleased;
+}
+
+void UHMZombiePoolSubsystem::OnZombieDied(AHMAICharacterBase* Zombie)
+{
+	m_Corpses.Add(Zombie);
+	m_CorpseReleaseTimes.Add(GetWorld()->GetTimeSeconds() + m_CorpseTime);
+	INC_DWORD_STAT(STAT_HMZombiePoolCorpses);
+}
+
+void UHMZombiePoolSubsystem::ReleaseCorpses()
+{
+	for (const TWeakObjectPtr<AHMAICharacterBase>& Corpse : m_Corpses)
+	{
+		ReleaseZombie(Corpse.Get());
+	}
+
+	DEC_DWORD_STAT_BY(STAT_HMZombiePoolCorpses, m_Corpses.Num());
+	m_Corpses.Reset();
+	m_CorpseReleaseTimes.Reset();
+}
+
+void UHMZombiePoolSubsystem::Prewarm(TSubclassOf<AHMAICharacterBase> ZombieClass, int32 Count)
+{
+	if (ZombieClass == nullptr || GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	m_PrewarmClass = ZombieClass;
+	m_PrewarmCount = Count;
+}
+
+void UHMZombiePoolSubsystem::DumpStats() const
+{
+	int32 NumZombies = 0;
+	int32 NumFree = 0;
+	for (const TPair<UClass*, FHMZombiePool>& Pair : m_Pools)
+	{
+		NumZombies += Pair.Value.NumZombies;
+		NumFree += Pair.Value.Free.Num();
+	}
+
+	UE_LOG(LogHordeMode, Log, TEXT("Zombie pool (%s): %d classes, %d zombies, %d free, %d corpses, %d hits, %d misses, %d released"),
+		IsEnabled() ? TEXT("on") : TEXT("off"), m_Pools.Num(), NumZombies, NumFree, m_Corpses.Num(), m_NumHits, m_NumMisses, m_NumReleased);
+}
@@ -7,7 +7,8 @@
 #include "HMAICharacterBase.generated.h"
 
 /**
- *
+ * The base class for zombies
+ * Zombies that were spawned by UHMZombiePoolSubsystem go back to the pool once their corpse is cleaned up instead of being destroyed
  */
 UCLASS()
 class HORDEMODE_API AHMAICharacterBase : public AHMCharacterBase
@@ -16,4 +17,100 @@ class HORDEMODE_API AHMAICharacterBase : public AHMCharacterBase
 public:
     AHMAICharacterBase(const class FObjectInitializer& ObjectInitializer);
 
+    virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    virtual void OnDied() override;
+
+private:
+
+    /** Was this zombie spawned by UHMZombiePoolSubsystem? */
+    bool m_bPooled;
+
+    /** The mesh's transform relative to the capsule, ragdolling detaches the mesh so it's put back with this. */
+    FTransform m_MeshRelativeTransform;
+
+    /** The collision of the mesh/capsule before the zombie ragdolled. */
+    TEnumAsByte<ECollisionEnabled::Type> m_MeshCollision;
+    TEnumAsByte<ECollisionEnabled::Type> m_CapsuleCollision;
+
+    /**
+     * The low bit is whether the zombie is active, the rest counts the activations
+     * so clients also reset a zombie that was released and reactivated between two net updates
+     */
+    UPROPERTY(ReplicatedUsing=OnRep_PoolState)
+    uint8 m_PoolState;
+
+    UFUNCTION()
+    void OnRep_PoolState();
+
+    /** Show/hide the zombie and reset its ragdoll, collision and movement. */
+    void ApplyPoolState(bool bActive);
+
+    /** The slot of this zombie in UHMPerceptionSubsystem (server only). */
+    int32 m_PerceptionSlot;
+
+protected:
+
+    /** The damage of a melee hit. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMAICharacterBase|Melee", meta = (DisplayName = "Melee Damage"))
+    float m_MeleeDamage;
+
+    /** How far a melee attack reaches. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMAICharacterBase|Melee", meta = (DisplayName = "Melee Range"))
+    float m_MeleeRange;
+
+    /** Half angle (degrees) in front of the zombie a melee attack hits. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMAICharacterBase|Melee", meta = (DisplayName = "Melee Half Angle"))
+    float m_MeleeHalfAngle;
+
+    /** Time between the starts of two melee attacks. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMAICharacterBase|Melee", meta = (DisplayName = "Melee Cooldown"))
+    float m_MeleeCooldown;
+
+    /** Time from the start of a melee attack until it can hit. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMAICharacterBase|Melee", meta = (DisplayName = "Melee Windup"))
+    float m_MeleeWindup;
+
+    /** How long a melee attack can hit after the windup. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMAICharacterBase|Melee", meta = (DisplayName = "Melee Window"))
+    float m_MeleeWindow;
+
+    UPROPERTY(EditDefaultsOnly, Category = "HMAICharacterBase|Melee", meta = (DisplayName = "Melee Attack Anim"))
+    class UAnimMontage* m_MeleeAttackAnim;
+
+public:
+
+    /** Mark the zombie as owned by UHMZombiePoolSubsystem. */
+    FORCEINLINE void SetPooled() { m_bPooled = true; }
+
+    /** Get Is this zombie owned by UHMZombiePoolSubsystem? */
+    FORCEINLINE bool IsPooled() const { return m_bPooled; }
+
+    /** Hide the zombie and turn off its collision, movement and AI so the pool can reuse it (server). */
+    void DeactivateForPool();
+
+    /**
+     * Reset the zombie's health, ragdoll and movement and put it at Transform (server)
+     *
+     * @param const FTransform& Transform Where the zombie should be
+     * @return false if there's no room for the zombie at Transform, the zombie stays deactivated
+     */
+    bool ActivateFromPool(const FTransform& Transform);
+
+    /** Play the melee attack anim everywhere, the hit itself is resolved by UHMMeleeSubsystem. */
+    UFUNCTION(NetMulticast, Unreliable)
+    void Multi_PlayMeleeAttack();
+
+    /** Get the slot of this zombie in UHMPerceptionSubsystem (server only). */
+    FORCEINLINE int32 GetPerceptionSlot() const { return m_PerceptionSlot; }
+
+    FORCEINLINE float GetMeleeDamage() const { return m_MeleeDamage; }
+    FORCEINLINE float GetMeleeRange() const { return m_MeleeRange; }
+    FORCEINLINE float GetMeleeHalfAngle() const { return m_MeleeHalfAngle; }
+    FORCEINLINE float GetMeleeCooldown() const { return m_MeleeCooldown; }
+    FORCEINLINE float GetMeleeWindup() const { return m_MeleeWindup; }
+    FORCEINLINE float GetMeleeWindow() const { return m_MeleeWindow; }
 };
@@ -7,7 +7,9 @@
 #include "HMAIController.generated.h"
 
 /**
- *
+ * The controller of zombies
+ * Zombies steer with UHMFlowFieldSubsystem towards the nearest player instead of each running its own path query
+ * and face the player UHMPerceptionSubsystem says they saw instead of each running its own sight checks
  */
 UCLASS()
 class HORDEMODE_API AHMAIController final : public AAIController
@@ -16,4 +18,15 @@ class HORDEMODE_API AHMAIController final : public AAIController
 
 public:
     AHMAIController(const class FObjectInitializer& ObjectInitializer);
+
+    virtual void Tick(float DeltaTime) override;
+
+private:
+
+    /** Should the pawn be steered by the flow field? Turn it off for zombies that are driven by a behavior tree. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMAIController", meta = (DisplayName = "Use Flow Field"))
+    bool m_bUseFlowField;
+
+    /** The player the zombie is facing, the perceived target or the one the flow field is leading to. */
+    TWeakObjectPtr<APawn> m_FlowFieldTarget;
 };
@@ -23,12 +23,11 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
-	virtual void Tick(float DeltaTime) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 protected:
 
-	/** The cost of the door. */
+	/** The cost of the door. Only changes when someone pays, so the door stays dormant until then (push model). */
 	UPROPERTY(Replicated, EditDefaultsOnly, Category = "HMDoorActor", meta = (DisplayName = "Cost"))
 	int32 m_Cost;
 
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "HMCommon.h"
 #include "HMCharacterBase.generated.h"
 
 //DECLARE_DYNAMIC_MULTICAST_DELEGATE_FiveParams(FOnHealthChangedDelegate, AHMCharacterBase*, OwningCharacter, float, Health, const class UDamageType*, DamageType, class AController*, InstigatedBy, AActor*, DamageCauser);
@@ -33,18 +34,35 @@ private:
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
 
+	/** Called on the server once the character died and started ragdolling, tears the character off and lets it be destroyed by default. */
+	virtual void OnDied();
 
+
+	/** Push model, change it with SetHealth. */
 	UPROPERTY(Replicated)
 	float m_Health;
 
+	/** Set the health and mark it dirty for replication. */
+	void SetHealth(float NewHealth);
+
 	UPROPERTY(EditDefaultsOnly, Category = "HMCharacterBase", meta = (DisplayName = "Max Health"))
 	float m_MaxHealth;
 
 	UPROPERTY(EditDefaultsOnly, Category = "HMCharacterBase", meta = (DisplayName = "Death Anims"))
 	TArray<class UAnimMontage*> m_DeathAnims;
 
+	/** The team of the character class, AI characters are enemies. */
+	UPROPERTY(EditDefaultsOnly, Category = "HMCharacterBase", meta = (DisplayName = "Team Type"))
+	ETeamType m_TeamType;
+
+private:
+
+	/** The slot of this character in UHMLagCompensationSubsystem (server only). */
+	int32 m_LagCompensationSlot;
+
 public:
 	/** Get the characters health */
 	UFUNCTION(BlueprintPure, Category = "HMCharacterBase")
@@ -62,6 +80,14 @@ public:
 	UFUNCTION(BlueprintPure, Category = "HMCharacterBase")
 	FORCEINLINE bool IsAlive() const { return m_Health > 0.0f; }
 
+	/** Get the team of the character */
+	UFUNCTION(BlueprintPure, Category = "HMCharacterBase")
+	FORCEINLINE ETeamType GetTeamType() const { return m_TeamType; }
+
+	/** Get Is the character an enemy (zombie)? */
+	UFUNCTION(BlueprintPure, Category = "HMCharacterBase")
+	FORCEINLINE bool IsEnemy() const { return m_TeamType == ETeamType::Enemy; }
+
 	/** Get Is the character dead? */
 	UFUNCTION(BlueprintPure, Category = "HMCharacterBase")
 	FORCEINLINE bool IsDead() const { return m_Health <= 0.0f; }
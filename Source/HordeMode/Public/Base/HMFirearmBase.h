@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "Base/HMWeaponBase.h"
+#include "Net/HMFireInput.h"
+#include "Net/HMShotEventStream.h"
 
 #include "HMFirearmBase.generated.h"
 
@@ -24,6 +26,7 @@ public:
 protected:
 	virtual void BeginPlay() override;
 	virtual void Tick(float DeltaTime) override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 
 
 	/** --- HMFirearmBase code --- */
@@ -34,71 +37,175 @@ protected:
 
 private:
 
-	/** Just an internal counter for the 3 round burst firemode. */
-	uint8 m_ShotCount;
+	/** The handle of this firearm's stats in UHMFirearmRegistry. */
+	FHMFirearmHandle m_FirearmHandle;
 
-	/** Store the default firearm stats. */
-	FFirearmStats m_FirearmStats;
+	/** The registry's entries for m_FirearmHandle (the registry never changes once it's built). */
+	const FFirearmStats* m_FirearmStats;
+	const FHMFirearmHotStats* m_HotStats;
+
+	/** The registry's hit zone table. */
+	const FHMHitZoneTable* m_HitZones;
+
+	/** Were the stats found in a built registry? Until then the firearm uses the default stats. */
+	bool m_bStatsResolved;
+
+	/** Look the firearm up in the world's UHMFirearmRegistry, false if the registry isn't built yet (no game state). */
+	bool ResolveStats();
 
 	EFireMode m_CurrentFireMode;
 
+	/** Push model, change it with SetWeaponStatus. */
 	UPROPERTY(Replicated)
 	EWeaponStatus m_WeaponStatus;
 
-	float m_RecoilTime;
+	/** Set the status and mark it dirty for replication. */
+	void SetWeaponStatus(EWeaponStatus NewStatus);
+
+	/** The part of the recoil offset that has already been applied to the controller. */
+	FVector2D m_AppliedRecoil;
 
-	FTimerHandle m_TimerHandle_TimeBetweenShots;
+	/** Index of the next shot in the recoil pattern, resets when the trigger is released. */
+	int32 m_RecoilPatternIndex;
 
 	float m_LastFireTime;
-	float m_TimeBetweenShots;
 
-	UPROPERTY(ReplicatedUsing=OnRep_HitScanTrace)
-	FHitScanTrace m_HitScanTrace;
+	/** Every shot fired since the last net update, simulated proxies replay all of them. */
+	UPROPERTY(ReplicatedUsing=OnRep_ShotEvents)
+	FHMShotEventStream m_ShotEvents;
+
+	/** Shots resolved on the server that haven't been put in m_ShotEvents yet. */
+	TArray<FHMShotEvent> m_PendingShotEvents;
+
+	/** The id the next batch of shot events starts at. */
+	uint16 m_NextShotEventId;
+
+	/** The id of the last shot event that was replayed. */
+	uint16 m_LastReplayedShotEventId;
 
 	UFUNCTION()
-	void OnRep_HitScanTrace();
+	void OnRep_ShotEvents();
 
-	void PlayFireEffects(const FVector& TraceEnd);
+	/** The muzzle flash and camera shake are only played for the first pellet of a shot. */
+	void PlayFireEffects(const FVector& TraceEnd, bool bIsFirstPellet = true);
 	void PlayImpactEffects(EPhysicalSurface SurfaceType, const FVector& ImpactPoint);
 
 	float PlayAnimationMontage(UAnimMontage* Animation, float InPlayRate = 1.f, FName StartSectionName = NAME_None);
 	void StopAnimationMontage(UAnimMontage* Animation);
 
-	/** Server RPCs */
-	void Fire();
+	/** Get the point the owner is looking from - the shot gets traced from there. */
+	bool GetShotViewPoint(FVector& OutLocation, FRotator& OutRotation) const;
+
+	/**
+	 * Fire a shot from EyeLocation along ShotDirection
+	 *
+	 * @param const FVector& EyeLocation Where the shot is traced from
+	 * @param const FVector& ShotDirection The direction of the shot
+	 * @param float RewindTime The server time the shot was fired at on the client, -1 if the shot shouldn't be lag compensated
+	 * @param float TimeSinceShot How long ago (within this frame) the shot was due
+	 * @return false if the shot couldn't be fired (no ammo, reloading)
+	 */
+	bool FireAlong(const FVector& EyeLocation, const FVector& ShotDirection, float RewindTime, float TimeSinceShot = 0.0f);
+
+	/**
+	 * Get the damage (and currency) of a hit from the hit zone table
+	 *
+	 * @param const FHitResult& Hit What was hit
+	 * @param float& OutDamage The damage of the hit
+	 * @param int32& OutCurrency The currency the owner gets for the hit (0 if it wasn't an enemy that's alive)
+	 * @return the surface that was hit
+	 */
+	EPhysicalSurface GetHitDamage(const FHitResult& Hit, float& OutDamage, int32& OutCurrency) const;
+
+	/** Give the owning player currency (server only). */
+	void PayCurrency(int32 Currency);
+
+	/** Get the direction of a pellet with the firearm's spread applied. */
+	FVector GetPelletDirection(const FVector& ShotDirection) const;
+
+	/** Launch a projectile from the muzzle towards where the owner is aiming (server), clients get it from Multi_SpawnProjectile. */
+	void LaunchProjectile(const FVector& EyeLocation, const FVector& ShotDirection);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multi_SpawnProjectile(const FVector_NetQuantize& Origin, const FVector_NetQuantizeNormal& Direction, uint16 ProjectileId);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multi_ProjectileImpact(uint16 ProjectileId, const FVector_NetQuantize& ImpactPoint, uint8 SurfaceType);
+
+	/** Unreliable, a lost shot is never fired on the server and the next ack puts the owner's ammo back. Only used with hm.FireInput.Batching 0. */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_Fire(const FVector_NetQuantize& EyeLocation, const FVector_NetQuantizeNormal& ShotDirection, float ClientFireTime, uint16 ShotId);
 
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_Fire();
+	/** The owner's shots and trigger state of one frame, the shots that were already fired (resent ones) are skipped. */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_FireInput(const FHMFireInput& Input);
+
+	/** Fire a shot the owner sent, the view point is checked against the server's (server). */
+	void FireFromClient(const FVector& EyeLocation, const FVector& ShotDirection, float ClientFireTime);
 
 	void ReloadFinished();
 
 	UFUNCTION(Server, Reliable, WithValidation)
 	void Server_Reload();
 
-	UFUNCTION(Server, Unreliable, WithValidation)
-	void Server_SetStatus(EWeaponStatus NewStatus);
+	/** The owner's shots that are still sent with every fire input until they were sent hm.FireInput.Redundancy times or acked (owning client). */
+	TArray<FHMFireInputShot> m_FireInputShots;
+	TArray<uint16> m_FireInputShotIds;
+	TArray<uint8> m_FireInputSendCounts;
+
+	/** How many of m_FireInputShots were never sent. */
+	int32 m_NumNewFireInputShots;
 
+	/** Is the owner holding the trigger and how many more inputs the release is sent in. */
+	bool m_bTriggerDown;
+	int32 m_TriggerSendsLeft;
+
+	/** The frame the last fire input was sent in, one per frame. */
+	uint64 m_LastFireInputFrame;
+
+	/** Add a predicted shot to the next fire input (owning client). */
+	void QueueFireInput(uint16 ShotId, const FVector& EyeLocation, const FVector& ShotDirection, float FireTime);
+
+	/** Apply the recoil of the shot that was just fired to the owning controller (locally controlled only). */
 	void HandleRecoil();
 
+	/** Is the owner of the firearm controlled on this machine? */
+	bool IsOwnerLocallyControlled() const;
+
 public:
 
-	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
-	FORCEINLINE FFirearmStats GetFirearmStats() const { return m_FirearmStats; }
+	/** Get the full stats of the firearm (title, cosmetics etc). */
+	FORCEINLINE const FFirearmStats& GetFirearmStats() const { return *m_FirearmStats; }
+
+	/** Get the stats that are used while firing/reloading. */
+	FORCEINLINE const FHMFirearmHotStats& GetHotStats() const { return *m_HotStats; }
+
+	/** Blueprint version of GetFirearmStats (returns a copy). */
+	UFUNCTION(BlueprintPure, Category = "HMFirearmBase", meta = (DisplayName = "Get Firearm Stats"))
+	FFirearmStats K2_GetFirearmStats() const { return *m_FirearmStats; }
 
 	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
 	FORCEINLINE EFireMode GetFireMode() const { return m_CurrentFireMode; }
 
+	/** Get the index of the next shot in the recoil pattern. */
+	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
+	FORCEINLINE int32 GetRecoilPatternIndex() const { return m_RecoilPatternIndex; }
+
+	/** Get the aim offset (X = pitch, Y = yaw) of a shot in the recoil pattern, deterministic so the server/replays can reproduce the aim path. */
+	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
+	FORCEINLINE FVector2D GetRecoilAimOffset(int32 PatternIndex) const { return m_HotStats->RecoilTable.SampleShot(PatternIndex, m_HotStats->TimeBetweenShots); }
+
 	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
 	FORCEINLINE bool IsReloading() const { return m_WeaponStatus == EWeaponStatus::Reloading; }
 
 	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
-	FORCEINLINE bool CanReload() const { return m_CurrentAmmo > 0 && m_CurrentAmmoInMag < m_FirearmStats.WeaponInfo.MagCapacity && !IsReloading(); }
+	FORCEINLINE bool CanReload() const { return m_CurrentAmmo > 0 && m_CurrentAmmoInMag < m_HotStats->MagCapacity && !IsReloading(); }
 
 	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
 	FORCEINLINE bool IsFiring() const { return m_WeaponStatus == EWeaponStatus::Firing && m_CurrentAmmoInMag > 0; }
 
 	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
-	FORCEINLINE FString GetFireModeAsString(EFireMode FireMode) { return m_FirearmStats.ConvertFireModeToString(FireMode); }
+	FORCEINLINE FString GetFireModeAsString(EFireMode FireMode) const { return FFirearmStats::ConvertFireModeToString(FireMode); }
 
 	virtual void StartFire() override;
 	virtual void StopFire() override;
@@ -106,6 +213,39 @@ public:
 
 	void ToggleFireMode(EFireMode NewFireMode);
 
+	/**
+	 * Apply the result of a shot's traces - damage, currency, effects and replication
+	 * Called by UHMShotQueueSubsystem once the (batched) traces for all pellets of the shot are done
+	 * The damage of all pellets is added up so every actor that was hit takes damage once
+	 *
+	 * @param const FVector& TraceStart Where the shot's traces started
+	 * @param TArrayView<const FHMShotTraceResult> Pellets The result of every pellet's trace
+	 */
+	void ResolveShot(const FVector& TraceStart, TArrayView<const struct FHMShotTraceResult> Pellets);
+
+	/**
+	 * Apply the impact of one of this firearm's projectiles. Called by UHMProjectileSubsystem on the server
+	 *
+	 * @param uint16 ProjectileId The id of the projectile
+	 * @param const FHitResult& Hit What the projectile hit
+	 * @param const FVector& Velocity The velocity of the projectile when it hit
+	 */
+	void ResolveProjectileImpact(uint16 ProjectileId, const FHitResult& Hit, const FVector& Velocity);
+
+	/**
+	 * Fire a shot from the owner's view point. Called by UHMFireSchedulerSubsystem when a shot is due
+	 *
+	 * @param float TimeSinceShot How long ago (within this frame) the shot was due
+	 * @return false if the shot couldn't be fired, that stops the firearm
+	 */
+	bool FireScheduledShot(float TimeSinceShot);
+
+	/** Called by UHMFireSchedulerSubsystem once the firearm stopped firing (trigger released, burst done, out of ammo). */
+	void OnScheduledFireFinished();
+
+	/** Send this frame's fire input if there's anything to send (owning client). UHMFireSchedulerSubsystem calls this right after firing. */
+	void FlushFireInput();
+
 	void Unjam() {}
 
 	UFUNCTION(BlueprintPure, Category = "HMFirearmBase")
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "HMCommon.h"
 #include "HMGameModeBase.generated.h"
 
 /**
@@ -15,8 +16,32 @@ class HORDEMODE_API AHMGameModeBase : public AGameModeBase
 	GENERATED_BODY()
 
 public:
+	AHMGameModeBase(const class FObjectInitializer& ObjectInitializer);
+
+	virtual void StartPlay() override;
 
 	void Killed(AController* Killer, AController* VictimPlayer);
+
+	/**
+	 * Add a server-side bot player (no connection) that plays with Profile, for load testing
+	 *
+	 * @param EBotProfile Profile How the bot plays
+	 * @return the bot's controller or nullptr if it couldn't be spawned
+	 */
+	class AHMBotController* AddBot(EBotProfile Profile);
+
+	/** Get the server-side bots, they aren't in the player controller list (see UHMHelpers::GetPlayerControllers). */
+	FORCEINLINE const TArray<class AHMBotController*>& GetBots() const { return m_Bots; }
+
+	/** Log the number of bots, the server frame time and the bandwidth of the net driver. */
+	void DumpBotStats() const;
+
 protected:
 	virtual FString InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal = TEXT("")) override;
+
+private:
+
+	/** The server-side bots that were added. */
+	UPROPERTY()
+	TArray<class AHMBotController*> m_Bots;
 };
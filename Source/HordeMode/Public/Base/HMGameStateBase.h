@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameStateBase.h"
+#include "HMCommon.h"
 #include "HMGameStateBase.generated.h"
 
 /**
@@ -14,12 +15,68 @@ class HORDEMODE_API AHMGameStateBase : public AGameStateBase
 {
 	GENERATED_BODY()
 
+public:
+    AHMGameStateBase();
+
+    virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
+
 protected:
     UPROPERTY(EditDefaultsOnly, Category = "HMGameStateBase", meta = (DisplayName = "Firearm Stats DataTable"))
     class UDataTable* m_FirearmStatsDataTable;
 
+    /** Rows of FHitZoneData, surfaces that aren't in the table use the defaults of FHMHitZoneTable. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMGameStateBase", meta = (DisplayName = "Hit Zone DataTable"))
+    class UDataTable* m_HitZoneDataTable;
+
+    /** Rows of FWaveData in wave order, see UHMSpawnDirectorSubsystem. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMGameStateBase", meta = (DisplayName = "Wave DataTable"))
+    class UDataTable* m_WaveDataTable;
+
+private:
+
+    /** --- Wave state, set by UHMSpawnDirectorSubsystem on the server --- */
+
+    UPROPERTY(Replicated)
+    int32 m_CurrentWave;
+
+    UPROPERTY(Replicated)
+    EWaveState m_WaveState;
+
+    /** The server world time the intermission ends at. */
+    UPROPERTY(Replicated)
+    float m_WaveStartTime;
+
+    /** Zombies that still have to be killed this wave (alive or not spawned yet). */
+    UPROPERTY(Replicated)
+    int32 m_ZombiesRemaining;
+
 
 public:
     UFUNCTION(BlueprintPure, Category = "HMGameStateBase")
     class UDataTable* GetFirearmStatsDataTable() const { return m_FirearmStatsDataTable; }
+
+    UFUNCTION(BlueprintPure, Category = "HMGameStateBase")
+    class UDataTable* GetHitZoneDataTable() const { return m_HitZoneDataTable; }
+
+    UFUNCTION(BlueprintPure, Category = "HMGameStateBase")
+    class UDataTable* GetWaveDataTable() const { return m_WaveDataTable; }
+
+    /** Get the current wave (starts at 1, 0 before the first wave) */
+    UFUNCTION(BlueprintPure, Category = "HMGameStateBase")
+    FORCEINLINE int32 GetCurrentWave() const { return m_CurrentWave; }
+
+    UFUNCTION(BlueprintPure, Category = "HMGameStateBase")
+    FORCEINLINE EWaveState GetWaveState() const { return m_WaveState; }
+
+    /** Get the server world time the current intermission ends at */
+    UFUNCTION(BlueprintPure, Category = "HMGameStateBase")
+    FORCEINLINE float GetWaveStartTime() const { return m_WaveStartTime; }
+
+    /** Get the number of zombies that still have to be killed this wave */
+    UFUNCTION(BlueprintPure, Category = "HMGameStateBase")
+    FORCEINLINE int32 GetZombiesRemaining() const { return m_ZombiesRemaining; }
+
+    /** Server only */
+    void SetWaveState(EWaveState NewState, int32 Wave, float WaveStartTime);
+    void SetZombiesRemaining(int32 ZombiesRemaining);
 };
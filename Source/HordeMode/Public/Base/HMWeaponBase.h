@@ -11,6 +11,33 @@
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnWeaponAmmoChangedSignature, AHMWeaponBase*, WeaponActor, int32, CurrentAmmoInMag, int32, CurrentAmmo);
 
+/** What the server acknowledged of the owner's predicted shots and the ammo it had right after them. */
+USTRUCT()
+struct FHMAmmoAck
+{
+	GENERATED_BODY()
+
+	/** Every shot id up to this one was processed (or dropped) by the server. */
+	UPROPERTY()
+	uint16 LastShotId;
+
+	/** Counts up (and wraps) with every reload the server finished. */
+	UPROPERTY()
+	uint8 NumReloads;
+
+	/** The ammo after LastShotId. */
+	UPROPERTY()
+	int32 AmmoInMag;
+
+	UPROPERTY()
+	int32 Ammo;
+
+	FHMAmmoAck() : LastShotId(0), NumReloads(0), AmmoInMag(0), Ammo(0) {}
+
+	/** Is Id newer than OtherId (handles wrapping)? */
+	static FORCEINLINE bool IsNewer(uint16 Id, uint16 OtherId) { return static_cast<int16>(Id - OtherId) > 0; }
+};
+
 /**
  * A base class for all weapons - firearms, grenade launchers/rocket launchers, melee, and even crossbow/bow etc
  */
@@ -22,6 +49,9 @@ class HORDEMODE_API AHMWeaponBase : public AActor
 public:
 	AHMWeaponBase();
 
+	/** A new owner numbers its shots from scratch, the server forgets the last owner's ack. */
+	virtual void SetOwner(AActor* NewOwner) override;
+
 protected:
 	virtual void BeginPlay() override;
 	virtual void Tick(float DeltaTime) override;
@@ -36,14 +66,77 @@ private:
 
 protected:
 
-	/** The current ammo in the reserve minus the current mag. */
+	/** The current ammo in the reserve minus the current mag. Push model, change it with SetAmmo. */
 	UPROPERTY(Replicated)
 	int32 m_CurrentAmmo;
 
-	/** The current amount of ammo that this weapon has in it's mag. NOTE: Sure a bow etc doesn't have a magazine, but it still has a "round in the chamber". */
+	/** The current amount of ammo that this weapon has in it's mag. NOTE: Sure a bow etc doesn't have a magazine, but it still has a "round in the chamber". Push model, change it with SetAmmo. */
 	UPROPERTY(Replicated)
 	int32 m_CurrentAmmoInMag;
 
+	/** How long (seconds) the weapon has to be left alone before it goes dormant on the server. */
+	UPROPERTY(EditDefaultsOnly, Category = "HMWeaponBase", meta = (DisplayName = "Net Dormancy Delay"))
+	float m_NetDormancyDelay;
+
+	/** How long the owner waits for the server to finish a reload it already finished before it takes the server's ammo anyway. */
+	UPROPERTY(EditDefaultsOnly, Category = "HMWeaponBase", meta = (DisplayName = "Reload Ack Timeout"))
+	float m_ReloadAckTimeout;
+
+	/** Set the ammo, mark it dirty for replication and tell the listeners. */
+	void SetAmmo(int32 InMag, int32 Reserve);
+
+	/** SetAmmo for a finished reload, the owner and the server count their reloads to know when they agree again. */
+	void SetReloadedAmmo(int32 InMag, int32 Reserve);
+
+	/**
+	 * Give a shot the owner fires ahead of the server the next id, it stays unacknowledged until the server's ack gets back (owning client)
+	 *
+	 * @return the id to send to the server with the shot
+	 */
+	uint16 PredictShot();
+
+	/**
+	 * Acknowledge a shot of the owner, duplicates and shots older than the last ack are rejected (server)
+	 *
+	 * @param uint16 ShotId The id the owner sent with the shot
+	 * @return true if the shot is new and should be fired
+	 */
+	bool AckShot(uint16 ShotId);
+
+	/** Get the id of the newest shot the server acknowledged. */
+	FORCEINLINE uint16 GetLastAckedShotId() const { return m_AmmoAck.LastShotId; }
+
+private:
+
+	/** The last time something replicated changed (server). */
+	float m_LastNetActiveTime;
+
+	/** The owner's ammo is predicted, it only gets the server's ammo through the ack. */
+	UPROPERTY(ReplicatedUsing = OnRep_AmmoAck)
+	FHMAmmoAck m_AmmoAck;
+
+	UFUNCTION()
+	void OnRep_AmmoAck();
+
+	/** The next id PredictShot gives out and the ids the server didn't acknowledge yet (owning client). */
+	uint16 m_NextShotId;
+	TArray<uint16> m_UnackedShotIds;
+
+	/** m_NumLocalReloads when each unacknowledged shot was fired, indexed the same as m_UnackedShotIds. */
+	TArray<uint8> m_UnackedShotReloads;
+
+	/** The reloads the owner finished and when it finished the last one (owning client). */
+	uint8 m_NumLocalReloads;
+	float m_LastLocalReloadTime;
+
+	/** Set the predicted ammo from the last ack and the shots that are still unacknowledged (owning client). */
+	void Reconcile();
+
+public:
+
+	/** Wake the weapon up if it's dormant, call this before changing anything that replicates (server). */
+	void WakeForReplication();
+
 public:
 
 	virtual void StartFire() PURE_VIRTUAL(StartFire, );
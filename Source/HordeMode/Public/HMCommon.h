@@ -2,20 +2,9 @@
 
 #pragma once
 #include "Engine/DataTable.h"
+#include "Engine/EngineTypes.h"
 #include "HMCommon.generated.h"
 
-USTRUCT()
-struct FHitScanTrace
-{
-	GENERATED_BODY()
-
-	UPROPERTY()
-	TEnumAsByte<EPhysicalSurface> SurfaceType;
-
-	UPROPERTY()
-	FVector_NetQuantize TraceTo;
-};
-
 UENUM()
 enum class EWeaponAttachLocation : uint8
 {
@@ -53,6 +42,24 @@ enum class EFirearmType : uint8
 	Other		UMETA(DisplayName = "Other") // For rocket launchers etc
 };
 
+/** Which of the firearm's damage values a hit zone uses. */
+UENUM()
+enum class EHitZoneDamage : uint8
+{
+	Base		UMETA(DisplayName = "Base Damage"),
+	Headshot	UMETA(DisplayName = "Headshot Damage"),
+	Body		UMETA(DisplayName = "Body Damage"),
+	Limb		UMETA(DisplayName = "Limb Damage")
+};
+
+/** Which of the firearm's impact effects a hit zone uses. */
+UENUM()
+enum class EHitZoneImpactEffect : uint8
+{
+	Default		UMETA(DisplayName = "Default Impact Effect"),
+	Flesh		UMETA(DisplayName = "Flesh Impact Effect")
+};
+
 
 /** Effects */
 USTRUCT(BlueprintType)
@@ -135,11 +142,82 @@ struct FWeaponAnims
 	{}
 };
 
-// TODO: Add data for projectiles
+/**
+ * A recoil curve (Y = pitch, Z = yaw) baked into a fixed timestep table so it doesn't have to be evaluated every tick.
+ * The curves are authored as the kick per 60Hz frame, the table holds the accumulated aim offset at every step so the
+ * recoil is the same at any frame rate and the aim offset of any shot can be reproduced from its pattern index.
+ */
+struct HORDEMODE_API FHMRecoilTable
+{
+	/** Time between two samples. */
+	float SampleInterval;
+
+	/** The accumulated aim offset (X = pitch, Y = yaw) at every SampleInterval. */
+	TArray<FVector2D> Samples;
+
+	FHMRecoilTable() : SampleInterval(1.0f / 120.0f) {}
+
+	/**
+	 * Bake Curve into the table
+	 *
+	 * @param const UCurveVector* Curve The recoil curve, the table gets cleared if this is nullptr
+	 * @param float InSampleInterval The timestep of the table
+	 */
+	void Bake(const class UCurveVector* Curve, float InSampleInterval = 1.0f / 120.0f);
+
+	/** Get the accumulated aim offset Time seconds after the trigger was pulled (linear interpolation between samples). */
+	FVector2D Sample(float Time) const;
+
+	/** Get the aim offset of a shot in the pattern - the same on every machine for the same fire rate. */
+	FORCEINLINE FVector2D SampleShot(int32 PatternIndex, float TimeBetweenShots) const { return Sample(PatternIndex * TimeBetweenShots); }
+
+	FORCEINLINE bool IsValid() const { return Samples.Num() > 0; }
+};
+
+/** How a firearm's projectiles fly, they're simulated by UHMProjectileSubsystem (no actor per projectile). */
 USTRUCT(BlueprintType)
 struct FProjectileData
 {
 	GENERATED_BODY()
+
+	/** The launch speed (uu/s), 0 means the firearm is hitscan. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float Speed;
+
+	/** Multiplier of the world gravity. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float GravityScale;
+
+	/** How much of its velocity the projectile loses per second (0 - 1). */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float Drag;
+
+	/** Seconds until the projectile gets removed if it didn't hit anything. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float Lifetime;
+
+	/** The radius of the projectile's sweep, 0 for a line trace. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float Radius;
+
+	/** Everything in this radius of the impact gets damaged (rockets etc), 0 only damages what was hit. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float ExplosionRadius;
+
+	/** The damage at the center of the explosion. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float ExplosionDamage;
+
+	/** The effect that follows the projectile. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	class UParticleSystem* TrailEffect;
+
+	FProjectileData() :
+		Speed(0.0f), GravityScale(1.0f), Drag(0.0f), Lifetime(5.0f), Radius(0.0f), ExplosionRadius(0.0f), ExplosionDamage(0.0f), TrailEffect(nullptr)
+	{}
+
+	FORCEINLINE bool IsValid() const { return Speed > 0.0f; }
+	FORCEINLINE bool IsExplosive() const { return ExplosionRadius > 0.0f; }
 };
 
 USTRUCT(BlueprintType)
@@ -241,8 +319,9 @@ struct FFirearmStats : public FTableRowBase
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	float ReloadSpeed;
 
+	/** Leave the speed at 0 for a hitscan firearm. */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
-	TSubclassOf<AActor> ProjectileClass;
+	FProjectileData Projectile;
 
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly)
 	FName MuzzleSocketName;
@@ -271,7 +350,7 @@ struct FFirearmStats : public FTableRowBase
 		MuzzleSocketName("MuzzleFlashSocket"), TracerTargetName("Target")
 	{}
 
-	FString ConvertFireModeToString(EFireMode ToConvert)
+	static FString ConvertFireModeToString(EFireMode ToConvert)
 	{
 		if (ToConvert == EFireMode::FullAuto) return "Fully Automatic";
 		if (ToConvert == EFireMode::SemiAuto) return "Semi Automatic";
@@ -286,7 +365,183 @@ struct FFirearmStats : public FTableRowBase
 	float GetVRecoil(float Min, float Max) const { return FMath::FRandRange(Min, Max) * -1.0f; }*/
 
 	bool HasRecoil() const { return Recoil != nullptr; }
-	bool HasProjectile() const { return ProjectileClass == nullptr; }
+	bool HasProjectile() const { return Projectile.IsValid(); }
+};
+
+/** Where the horde is in its current wave. */
+UENUM(BlueprintType)
+enum class EWaveState : uint8
+{
+	WaitingToStart	UMETA(DisplayName = "Waiting To Start"),
+	Intermission	UMETA(DisplayName = "Intermission"),
+	InProgress		UMETA(DisplayName = "In Progress")
+};
+
+/** How much a zombie matters to the players, less significant zombies tick less often. */
+UENUM(BlueprintType)
+enum class EZombieSignificance : uint8
+{
+	Near		UMETA(DisplayName = "Near"),
+	Mid			UMETA(DisplayName = "Mid"),
+	Far			UMETA(DisplayName = "Far"),
+	Hidden		UMETA(DisplayName = "Hidden"),
+	MAX			UMETA(Hidden)
+};
+
+/** How a bot player (FHMBotBrain) plays, set with -HMBotProfile=. */
+UENUM(BlueprintType)
+enum class EBotProfile : uint8
+{
+	None		UMETA(DisplayName = "None (human)"),
+	Idle		UMETA(DisplayName = "Idle (stands still)"),
+	Wander		UMETA(DisplayName = "Wander (walks around and interacts, never fires)"),
+	Combat		UMETA(DisplayName = "Combat (walks around and fires bursts at the nearest zombie)"),
+	FullAuto	UMETA(DisplayName = "Full Auto (holds the trigger on the nearest zombie)")
+};
+
+/** A row of the wave DataTable (DT_Waves), row order is the wave order. */
+USTRUCT(BlueprintType)
+struct FWaveData : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	/** The zombie to spawn, the spawn director's default zombie class if not set. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TSubclassOf<class AHMAICharacterBase> ZombieClass;
+
+	/** How many zombies have to be killed to finish the wave. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	int32 NumZombies;
+
+	/** Seconds between the end of the last wave and the start of this one. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float IntermissionTime;
+
+	FWaveData() :
+		ZombieClass(nullptr), NumZombies(12), IntermissionTime(10.0f)
+	{}
+};
+
+/** A row of the hit zone DataTable (DT_HitZones) - how a hit on a physical surface is resolved. */
+USTRUCT(BlueprintType)
+struct FHitZoneData : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	/** Which of the firearm's damage values is used. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	EHitZoneDamage Damage;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	float DamageMultiplier;
+
+	/** The currency the shooter gets for hitting an enemy here. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	int32 Currency;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	EHitZoneImpactEffect ImpactEffect;
+
+	FHitZoneData() :
+		SurfaceType(SurfaceType_Default), Damage(EHitZoneDamage::Base), DamageMultiplier(1.0f), Currency(10), ImpactEffect(EHitZoneImpactEffect::Default)
+	{}
+};
+
+/** FHitZoneData without the surface (that's the index in FHMHitZoneTable). */
+struct FHMHitZone
+{
+	float DamageMultiplier;
+	int32 Currency;
+	EHitZoneDamage Damage;
+	EHitZoneImpactEffect ImpactEffect;
+
+	FHMHitZone() : DamageMultiplier(1.0f), Currency(10), Damage(EHitZoneDamage::Base), ImpactEffect(EHitZoneImpactEffect::Default) {}
+	FHMHitZone(EHitZoneDamage InDamage, float InDamageMultiplier, int32 InCurrency, EHitZoneImpactEffect InImpactEffect) :
+		DamageMultiplier(InDamageMultiplier), Currency(InCurrency), Damage(InDamage), ImpactEffect(InImpactEffect)
+	{}
+};
+
+/** Every physical surface's hit zone, resolving a hit is a single array lookup. */
+struct FHMHitZoneTable
+{
+	FHMHitZone Zones[SurfaceType_Max];
+
+	/** The hit zones that are used when there's no hit zone DataTable. */
+	FHMHitZoneTable();
+
+	/** Overwrite the zones that are in Table, the rest keep their defaults. */
+	void Build(const class UDataTable* Table);
+
+	FORCEINLINE const FHMHitZone& Get(EPhysicalSurface SurfaceType) const { return Zones[SurfaceType < SurfaceType_Max ? SurfaceType : SurfaceType_Default]; }
+};
+
+/** A handle to a firearm in UHMFirearmRegistry. */
+struct FHMFirearmHandle
+{
+	int16 Index;
+
+	FHMFirearmHandle() : Index(INDEX_NONE) {}
+	explicit FHMFirearmHandle(int32 InIndex) : Index(static_cast<int16>(InIndex)) {}
+
+	FORCEINLINE bool IsValid() const { return Index != INDEX_NONE; }
+};
+
+/**
+ * The part of FFirearmStats that's used while firing/reloading, packed together so the hot paths don't drag the
+ * title, description, sounds etc through the cache. Built once per firearm type by UHMFirearmRegistry.
+ */
+struct FHMFirearmHotStats
+{
+	float TimeBetweenShots;
+	float ReloadSpeed;
+
+	float HitHeadshotDamage;
+	float HitBodyDamage;
+	float HitLimbDamage;
+	float HitBaseDamage;
+
+	FVector2D HorizontalSpread;
+	FVector2D VerticalSpread;
+
+	uint8 MagCapacity;
+	uint8 MagCount;
+	uint8 ShotCount;
+	EFirearmType FirearmType;
+
+	/** The allowed fire modes in the order they get toggled through. */
+	TArray<EFireMode, TInlineAllocator<3>> AllowedFireModes;
+
+	/** The recoil curve baked into a table. */
+	FHMRecoilTable RecoilTable;
+
+	FProjectileData Projectile;
+
+	FHMFirearmHotStats() :
+		TimeBetweenShots(0.1f), ReloadSpeed(3.0f), HitHeadshotDamage(80.0f), HitBodyDamage(40.0f), HitLimbDamage(20.0f), HitBaseDamage(30.0f),
+		HorizontalSpread(FVector2D::ZeroVector), VerticalSpread(FVector2D::ZeroVector), MagCapacity(30), MagCount(8), ShotCount(1), FirearmType(EFirearmType::Rifle)
+	{}
+
+	explicit FHMFirearmHotStats(const FFirearmStats& Stats);
+
+	FORCEINLINE int32 GetDefaultAmmo() const { return MagCount * MagCapacity; }
+	FORCEINLINE bool HasRecoil() const { return RecoilTable.IsValid(); }
+	FORCEINLINE bool HasProjectile() const { return Projectile.IsValid(); }
+	FORCEINLINE bool HasSpread() const { return !HorizontalSpread.IsZero() || !VerticalSpread.IsZero(); }
+
+	/** Get the damage value that a hit zone uses. */
+	FORCEINLINE float GetDamage(EHitZoneDamage Damage) const
+	{
+		switch (Damage)
+		{
+		case EHitZoneDamage::Headshot: return HitHeadshotDamage;
+		case EHitZoneDamage::Body: return HitBodyDamage;
+		case EHitZoneDamage::Limb: return HitLimbDamage;
+		default: return HitBaseDamage;
+		}
+	}
 };
 
 
@@ -23,14 +23,15 @@ class HORDEMODE_API UHMHelpers final : public UBlueprintFunctionLibrary
 
 public:
 
+    /** Get a copy of a firearm's stats from UHMFirearmRegistry, the default stats if the firearm doesn't exist. */
     UFUNCTION(BlueprintCallable, Category = "HMHelpers")
-    static FFirearmStats GetFirearmStats(UWorld* World, const FName& FirearmID)
-    {
-        if (UDataTable* const Table = Cast<AHMGameStateBase>(World->GetGameState())->GetFirearmStatsDataTable())
-        {
-            return *Table->FindRow<FFirearmStats>(FirearmID, "");
-        }
-
-        return FFirearmStats();
-    }
+    static FFirearmStats GetFirearmStats(UWorld* World, const FName& FirearmID);
+
+    /**
+     * Get the controllers of the players, the player controllers and the server-side bots (AHMBotController)
+     *
+     * @param const UWorld* World The world of the players
+     * @param TArray<AController*, TInlineAllocator<8>>& OutControllers The controllers (reset first)
+     */
+    static void GetPlayerControllers(const UWorld* World, TArray<class AController*, TInlineAllocator<8>>& OutControllers);
 };
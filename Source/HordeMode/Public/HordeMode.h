@@ -56,3 +56,8 @@
 
 #define COLLISION_WEAPON			ECC_GameTraceChannel1
 
+DECLARE_LOG_CATEGORY_EXTERN(LogHordeMode, Log, All);
+
+/** Stat group for all of the HordeMode gameplay systems. Use "stat HordeMode" to view. */
+DECLARE_STATS_GROUP(TEXT("HordeMode"), STATGROUP_HordeMode, STATCAT_Advanced);
+
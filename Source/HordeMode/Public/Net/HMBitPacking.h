@@ -0,0 +1,68 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Fixed width bit packing for the custom net serializers (FHMShotEventStream, FHMFireInput). */
+struct FHMBitPacking
+{
+	/** Write/read the lowest NumBits of Value. */
+	static FORCEINLINE void SerializeUnsigned(FArchive& Ar, uint32& Value, int32 NumBits)
+	{
+		if (Ar.IsLoading())
+		{
+			Value = 0;
+		}
+
+		Ar.SerializeBits(&Value, NumBits);
+	}
+
+	/** Write/read a signed value that gets clamped to NumBits. */
+	static FORCEINLINE void SerializeSigned(FArchive& Ar, int32& Value, int32 NumBits)
+	{
+		const int32 Bias = 1 << (NumBits - 1);
+
+		uint32 Biased = static_cast<uint32>(FMath::Clamp(Value + Bias, 0, (1 << NumBits) - 1));
+		SerializeUnsigned(Ar, Biased, NumBits);
+
+		Value = static_cast<int32>(Biased) - Bias;
+	}
+
+	/** Write/read a location rounded to 1uu. */
+	static FORCEINLINE void SerializeLocation(FArchive& Ar, FVector& Location, int32 NumBits)
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			int32 Value = FMath::RoundToInt(Location[Axis]);
+			SerializeSigned(Ar, Value, NumBits);
+			Location[Axis] = Value;
+		}
+	}
+
+	/** Does every component of Location (rounded to 1uu) fit in NumBits without getting clamped? */
+	static FORCEINLINE bool FitsLocation(const FVector& Location, int32 NumBits)
+	{
+		const int32 Bias = 1 << (NumBits - 1);
+
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const int32 Value = FMath::RoundToInt(Location[Axis]);
+			if (Value < -Bias || Value >= Bias)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/** How many bits FVector_NetQuantize would have used for Location. */
+	static FORCEINLINE int32 GetNetQuantizeBits(const FVector& Location)
+	{
+		const int32 MaxValue = FMath::RoundToInt(Location.GetAbsMax());
+		const int32 ComponentBits = FMath::Clamp<int32>(FMath::CeilLogTwo(1 + MaxValue), 1, 20) + 1;
+
+		return 5 + 3 * ComponentBits;
+	}
+};
@@ -0,0 +1,88 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+
+#include "HMFireInput.generated.h"
+
+/** One shot the owner fired, as the server gets it. */
+struct FHMFireInputShot
+{
+	/** Where the shot was traced from. */
+	FVector Origin;
+
+	/** The direction of the shot. */
+	FVector Direction;
+
+	/** The server time the owner fired at (for lag compensation). */
+	float FireTime;
+
+	FHMFireInputShot() : Origin(FVector::ZeroVector), Direction(FVector::ForwardVector), FireTime(0.0f) {}
+};
+
+/**
+ * The fire input of one frame of the owning client, sent with one unreliable RPC instead of an RPC per shot.
+ *
+ * Only frames with new shots (and the release of the trigger) send an input. The shots that weren't acked yet are sent again
+ * with the next inputs (up to hm.FireInput.Redundancy times) so a lost packet doesn't lose the shot, the server fires each
+ * shot id once (AHMWeaponBase::AckShot) and acks the ids so the client stops resending them.
+ *
+ * Wire format:
+ *   header   - 1 bit trigger down, 16 bit id of the first shot, 5 bit shot count,
+ *              if there are shots: 32 bit fire time and base origin as 3 x 20 bit signed (1uu) of the first shot
+ *   per shot - 16 bit fire time delta from the first shot (ms, not for the first shot),
+ *              1 bit "moved" flag + 3 x 12 bit signed origin delta from the previous shot if it moved, 16 bit yaw, 16 bit pitch
+ *
+ * Run hm.FireInput.Stats for the RPCs and bits sent compared to an RPC per shot.
+ */
+USTRUCT()
+struct HORDEMODE_API FHMFireInput
+{
+	GENERATED_BODY()
+
+	/** Is the owner holding the trigger? */
+	bool bTriggerDown;
+
+	/** The id of Shots[0], the rest follow in order. */
+	uint16 FirstShotId;
+
+	/** The shots of this input, the new ones and the ones that are resent. */
+	TArray<FHMFireInputShot> Shots;
+
+	/** How many of the last shots are sent for the first time (not sent, only for the stats). */
+	int32 NumNewShots;
+
+	FHMFireInput() : bTriggerDown(false), FirstShotId(0), NumNewShots(0) {}
+
+	/** The most shots that fit in a single input, older ones don't get resent. */
+	static const int32 MaxShotsPerInput = 31;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/**
+	 * Count a shot that was sent with its own Server_Fire RPC (hm.FireInput.Batching 0) for hm.FireInput.Stats
+	 *
+	 * @param const FVector& Origin Where the shot was traced from
+	 */
+	static void CountUnbatchedShot(const FVector& Origin);
+
+	/** Log the RPCs and bits sent since the last call. */
+	static void DumpStats();
+
+	/** Should the owner batch its shots into one input per frame (hm.FireInput.Batching)? */
+	static bool IsBatchingEnabled();
+
+	/** How many inputs in a row each shot is sent in (hm.FireInput.Redundancy). */
+	static int32 GetRedundancy();
+};
+
+template<>
+struct TStructOpsTypeTraits<FHMFireInput> : public TStructOpsTypeTraitsBase2<FHMFireInput>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
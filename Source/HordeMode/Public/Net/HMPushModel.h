@@ -0,0 +1,77 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/UnrealNetwork.h"
+
+/**
+ * Push model replication (engine 4.25+, HM_WITH_PUSH_MODEL is set by HordeMode.Build.cs).
+ * Properties registered with HM_DOREPLIFETIME_PUSH are only compared when HM_MARK_PROPERTY_DIRTY was called for them
+ * (with net.IsPushModelEnabled 1), so every place that changes one has to mark it. Without push model they are
+ * regular replicated properties and marking them only counts the mark for hm.PushModel.Stats.
+ */
+struct HORDEMODE_API FHMPushModelStats
+{
+	/** Count a dirty mark ("stat HordeMode" and hm.PushModel.Stats). */
+	static void AddDirtyMark();
+
+	/**
+	 * Log how many property comparisons push model saves per frame in World, compared to the dirty marks
+	 *
+	 * @param UWorld* World The (server) world to count the replicated actors of
+	 * @param int32 NumCharacters Also scale the numbers to this many characters (0 for none)
+	 */
+	static void DumpStats(UWorld* World, int32 NumCharacters);
+
+	/**
+	 * Remember that a property was registered as push model, FLifetimeProperty only knows it with HM_WITH_PUSH_MODEL
+	 *
+	 * @param UClass* Class The class that declares the property
+	 * @param FName PropertyName The name of the property
+	 */
+	static void RegisterPushProperty(UClass* Class, FName PropertyName);
+};
+
+#if HM_WITH_PUSH_MODEL
+
+#include "Net/Core/PushModel/PushModel.h"
+
+#define HM_DOREPLIFETIME_PUSH(ClassName, PropertyName) \
+	{ \
+		FDoRepLifetimeParams PushParams; \
+		PushParams.bIsPushBased = true; \
+		DOREPLIFETIME_WITH_PARAMS(ClassName, PropertyName, PushParams); \
+	}
+
+#define HM_DOREPLIFETIME_CONDITION_PUSH(ClassName, PropertyName, InCondition) \
+	{ \
+		FDoRepLifetimeParams PushParams; \
+		PushParams.bIsPushBased = true; \
+		PushParams.Condition = InCondition; \
+		DOREPLIFETIME_WITH_PARAMS(ClassName, PropertyName, PushParams); \
+	}
+
+#define HM_MARK_PROPERTY_DIRTY(ClassName, PropertyName, Object) \
+	{ \
+		FHMPushModelStats::AddDirtyMark(); \
+		MARK_PROPERTY_DIRTY_FROM_NAME(ClassName, PropertyName, Object); \
+	}
+
+#else
+
+#define HM_DOREPLIFETIME_PUSH(ClassName, PropertyName) \
+	{ \
+		DOREPLIFETIME(ClassName, PropertyName); \
+		FHMPushModelStats::RegisterPushProperty(ClassName::StaticClass(), GET_MEMBER_NAME_CHECKED(ClassName, PropertyName)); \
+	}
+
+#define HM_DOREPLIFETIME_CONDITION_PUSH(ClassName, PropertyName, InCondition) \
+	{ \
+		DOREPLIFETIME_CONDITION(ClassName, PropertyName, InCondition); \
+		FHMPushModelStats::RegisterPushProperty(ClassName::StaticClass(), GET_MEMBER_NAME_CHECKED(ClassName, PropertyName)); \
+	}
+
+#define HM_MARK_PROPERTY_DIRTY(ClassName, PropertyName, Object) FHMPushModelStats::AddDirtyMark()
+
+#endif // HM_WITH_PUSH_MODEL
@@ -0,0 +1,94 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+
+#include "HMReplicationGraph.generated.h"
+
+/** Which node of UHMReplicationGraph a replicated class goes to. */
+UENUM()
+enum class EHMClassRepNodeMapping : uint8
+{
+	NotRouted,					// Only replicated through something else (the connection's own actors, a weapon's owner)
+	RelevantAllConnections,		// Always relevant to every connection
+	Spatialize_Static,			// In the grid, never moves
+	Spatialize_Dynamic,			// In the grid, moves and is re-binned every frame
+	Spatialize_Dormancy			// In the grid, static while dormant and dynamic while awake
+};
+
+/**
+ * The replication driver for horde mode (set as ReplicationDriverClassName in DefaultEngine.ini).
+ *
+ * Instead of checking every actor's relevancy for every connection, actors are put in nodes once:
+ * zombies and players in a 2D spatial grid (only the cells around a viewer are gathered), player states, the game state
+ * and other always relevant actors in one list for everyone, doors in the grid as dormancy actors (no cost while dormant)
+ * and weapons are replicated with their owning character instead of being considered on their own.
+ * Every connection also gets its own player controller and pawn. Run hm.RepGraph.Stats for the node counts.
+ */
+UCLASS(transient, config = Engine)
+class HORDEMODE_API UHMReplicationGraph final : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UHMReplicationGraph();
+
+	virtual void ResetGameWorldState() override;
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+private:
+
+	/** The size of a grid cell. */
+	UPROPERTY(Config)
+	float m_GridCellSize;
+
+	/** The grid starts here, should be below the lowest X/Y of the level. */
+	UPROPERTY(Config)
+	FVector2D m_GridSpatialBias;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* m_GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* m_AlwaysRelevantNode;
+
+	/** The node of every replicated class (looked up through the super classes). */
+	TClassMap<EHMClassRepNodeMapping> m_ClassRepNodePolicies;
+
+	/** Weapons without an owner are in the grid, the others are dependent actors of their owner. */
+	TSet<AActor*> m_UnownedWeapons;
+
+	/** Counters for hm.RepGraph.Stats, the actors per mapping. */
+	int32 m_NumRouted[(int32)EHMClassRepNodeMapping::Spatialize_Dormancy + 1];
+	int32 m_NumOwnedWeapons;
+
+	/** Get the node of a class that has no explicit mapping. */
+	EHMClassRepNodeMapping GetMappingPolicy(UClass* Class);
+
+	/** Set the replication period and cull distance of a class from its CDO. */
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize) const;
+
+	/** Replicate Weapon with Owner, or put it in the grid if it has no owner. */
+	void AddWeapon(AActor* Weapon, AActor* Owner, FGlobalActorReplicationInfo& GlobalInfo);
+	void RemoveWeapon(AActor* Weapon, AActor* Owner);
+
+public:
+
+	/**
+	 * Tell the replication graph of Weapon's world (if there is one) that the weapon changed owners (server)
+	 *
+	 * @param AActor* Weapon The weapon (already has its new owner)
+	 * @param AActor* OldOwner The owner the weapon had before
+	 */
+	static void NotifyWeaponOwnerChanged(AActor* Weapon, AActor* OldOwner);
+
+	/** Log how many actors are in each node. */
+	void DumpStats() const;
+};
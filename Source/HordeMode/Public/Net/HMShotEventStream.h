@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+
+#include "HMShotEventStream.generated.h"
+
+/** One shot as it gets replayed on simulated proxies (already quantized on the receiving side). */
+struct FHMShotEvent
+{
+	/** Where the shot was traced from. */
+	FVector Origin;
+
+	/** The direction of the shot. */
+	FVector Direction;
+
+	/** How far the shot went before it hit something. */
+	float Distance;
+
+	/** The surface that was hit (only valid if bHit). */
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	/** Did the shot hit something? */
+	bool bHit;
+
+	FHMShotEvent() : Origin(FVector::ZeroVector), Direction(FVector::ForwardVector), Distance(0.0f), SurfaceType(SurfaceType_Default), bHit(false) {}
+
+	FORCEINLINE FVector GetEnd() const { return Origin + Direction * Distance; }
+};
+
+/**
+ * Every shot a firearm fired since the last net update, packed into one property.
+ *
+ * Wire format (all fixed width so the cost per shot is known up front):
+ *   header   - 16 bit id of the first shot, 8 bit shot count, base origin as 3 x 24 bit signed (1uu)
+ *   per shot - 1 bit "moved" flag + 1 bit "full origin" flag and 3 x 12 bit signed origin delta from the previous shot
+ *              (3 x 24 bit origin if the delta doesn't fit) if it moved,
+ *              16 bit yaw, 16 bit pitch, 1 bit hit flag + 6 bit surface type + 16 bit distance (1uu) if it hit
+ *
+ * That's 34 bits for a miss and 56 bits for a hit from the same spot, compared to a full FHitScanTrace property update
+ * (surface byte + packed vector + property handles) per shot before - see the "Shot Event" stats in "stat HordeMode".
+ */
+USTRUCT()
+struct HORDEMODE_API FHMShotEventStream
+{
+	GENERATED_BODY()
+
+	/** The id of Shots[0], ids keep counting up (and wrap) across updates so receivers know which shots are new. */
+	uint16 FirstShotId;
+
+	/** The shots of this update. */
+	TArray<FHMShotEvent> Shots;
+
+	FHMShotEventStream() : FirstShotId(0) {}
+
+	/** The most shots that fit in a single update, older ones get dropped. */
+	static const int32 MaxShotsPerUpdate = 255;
+
+	/** Is Id newer than OtherId (handles wrapping)? */
+	static FORCEINLINE bool IsNewer(uint16 Id, uint16 OtherId) { return static_cast<int16>(Id - OtherId) > 0; }
+
+	/** Get the id of the last shot in the stream. */
+	FORCEINLINE uint16 GetLastShotId() const { return static_cast<uint16>(FirstShotId + Shots.Num() - 1); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+	bool Identical(const FHMShotEventStream* Other, uint32 PortFlags) const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FHMShotEventStream> : public TStructOpsTypeTraitsBase2<FHMShotEventStream>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdentical = true
+	};
+};
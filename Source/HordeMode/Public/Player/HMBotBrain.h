@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HMCommon.h"
+#include "HMBotBrain.generated.h"
+
+/**
+ * What makes a bot play by itself (move, aim, fire, reload and interact) to load test servers
+ * Shared by AHMPlayerController (net clients launched with -HMBotProfile=) and AHMBotController (server-side bots),
+ * both drive the same AHMPlayerCharacter actions a human does and aim with the control rotation.
+ */
+USTRUCT()
+struct HORDEMODE_API FHMBotBrain
+{
+	GENERATED_BODY()
+
+	/** How far away the bot aims at zombies. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float AimRange;
+
+	/** How fast (deg/sec) the bot turns towards its target. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float TurnRate;
+
+	FHMBotBrain();
+
+	/**
+	 * Let Controller play by itself with Profile, None gives the control back
+	 *
+	 * @param AController* Controller The controller of the bot
+	 * @param EBotProfile NewProfile How the bot plays
+	 */
+	void SetProfile(class AController* Controller, EBotProfile NewProfile);
+
+	/**
+	 * Move, aim, fire and interact for this frame, call from the controller's Tick
+	 *
+	 * @param AController* Controller The controller of the bot
+	 * @param float DeltaTime The frame time
+	 */
+	void Tick(class AController* Controller, float DeltaTime);
+
+	/** Get How the bot plays, None for humans. */
+	FORCEINLINE EBotProfile GetProfile() const { return Profile; }
+
+	/** Get Is the controller a bot? */
+	FORCEINLINE bool IsActive() const { return Profile != EBotProfile::None; }
+
+	/**
+	 * Get the bot profile from the command line (-HMBotProfile=Combat)
+	 *
+	 * @param EBotProfile Default The profile if there's none on the command line
+	 * @return the profile
+	 */
+	static EBotProfile GetCommandLineProfile(EBotProfile Default);
+
+private:
+
+	/** How the bot plays, None for humans. */
+	EBotProfile Profile;
+
+	/** Seeded per controller so bots don't walk and fire in lockstep. */
+	FRandomStream Random;
+
+	/** The direction the bot walks in (world, 2D) and when it picks a new one. */
+	FVector MoveDirection;
+	float NextMoveTime;
+
+	/** Is the bot holding the trigger and when it lets go/presses it again (Combat bursts). */
+	bool bFiring;
+	float NextFireToggleTime;
+
+	/** When the bot tries to interact with what's in front of it. */
+	float NextInteractTime;
+
+	/** Press/release the trigger of the bot's weapon. */
+	void SetFiring(class AHMPlayerCharacter* Player, bool bNewFiring);
+};
@@ -0,0 +1,44 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "HMCommon.h"
+#include "Player/HMBotBrain.h"
+#include "HMBotController.generated.h"
+
+/**
+ * The controller of server-side bot players added by AHMGameModeBase (-HMBots=, hm.Bots.Add), see FHMBotBrain
+ * An AI controller because a player controller without a connection isn't locally controlled on a dedicated server,
+ * so the character movement wouldn't run its input. It has a player state on the player team like a human.
+ */
+UCLASS()
+class HORDEMODE_API AHMBotController final : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+    AHMBotController(const class FObjectInitializer& ObjectInitializer);
+
+    virtual void Tick(float DeltaTime) override;
+
+    /** Aims from the eyes with the control rotation like a player, AAIController uses the pawn's location and rotation. */
+    virtual void GetPlayerViewPoint(FVector& OutLocation, FRotator& OutRotation) const override;
+
+    /** The bot sets the control rotation itself (with pitch), AAIController would overwrite it with its focus. */
+    virtual void UpdateControlRotation(float DeltaTime, bool bUpdatePawn = true) override;
+
+private:
+
+    UPROPERTY(EditDefaultsOnly, Category = "HMBotController", meta = (DisplayName = "Bot"))
+    FHMBotBrain m_Bot;
+
+public:
+
+    /** Let the bot play with Profile. */
+    FORCEINLINE void SetBotProfile(EBotProfile Profile) { m_Bot.SetProfile(this, Profile); }
+
+    /** Get How the bot plays. */
+    FORCEINLINE EBotProfile GetBotProfile() const { return m_Bot.GetProfile(); }
+};
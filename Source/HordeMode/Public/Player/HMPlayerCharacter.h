@@ -16,6 +16,9 @@ class HORDEMODE_API AHMPlayerCharacter : public AHMCharacterBase
 {
 	GENERATED_BODY()
 
+	/** Bots press the same buttons as players. */
+	friend struct FHMBotBrain;
+
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true", DisplayName = "Camera Boom"))
 	class USpringArmComponent* m_CameraBoom;
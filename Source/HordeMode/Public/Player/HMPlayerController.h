@@ -4,10 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
+#include "HMCommon.h"
+#include "Player/HMBotBrain.h"
 #include "HMPlayerController.generated.h"
 
 /**
- *
+ * The controller of players
+ * With a bot profile (net clients launched with -HMBotProfile=) it plays by itself to load test servers, see FHMBotBrain.
+ * Server-side bots are AHMBotController, a player controller without a connection isn't locally controlled on a server.
  */
 UCLASS()
 class HORDEMODE_API AHMPlayerController final : public APlayerController
@@ -15,9 +19,40 @@ class HORDEMODE_API AHMPlayerController final : public APlayerController
 	GENERATED_BODY()
 
 public:
+    AHMPlayerController(const class FObjectInitializer& ObjectInitializer);
+
+    virtual void BeginPlay() override;
+    virtual void Tick(float DeltaTime) override;
 
     /** Pitch is Y and Yaw is Z - X is Roll */
     void RegisterRecoil(float Pitch, float Yaw);
     void ResetRecoil();
 
+private:
+
+    /** Plays by itself when the client was launched with -HMBotProfile=. */
+    UPROPERTY(EditDefaultsOnly, Category = "HMPlayerController", meta = (DisplayName = "Bot"))
+    FHMBotBrain m_Bot;
+
+    /** The profile the client's bot plays with (server), the bot only runs on the client. */
+    EBotProfile m_ClientBotProfile;
+
+    /** Tell the server the client plays as a bot (hm.Bots.Stats). */
+    UFUNCTION(Server, Reliable, WithValidation)
+    void Server_SetBotProfile(EBotProfile NewProfile);
+
+public:
+
+    /**
+     * Let the controller play by itself, None gives the control back
+     *
+     * @param EBotProfile NewProfile How the bot plays
+     */
+    void SetBotProfile(EBotProfile NewProfile);
+
+    /** Get How the bot plays, None for humans. */
+    FORCEINLINE EBotProfile GetBotProfile() const { return m_Bot.IsActive() ? m_Bot.GetProfile() : m_ClientBotProfile; }
+
+    /** Get Is the controller a bot? */
+    FORCEINLINE bool IsBot() const { return GetBotProfile() != EBotProfile::None; }
 };
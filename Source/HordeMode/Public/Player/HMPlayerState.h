@@ -11,6 +11,24 @@
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCharacterCurrencyChangeDelegate, int32, NewCurrency);
 
+/** The currency of a player as UHMCurrencyLedgerSubsystem last applied it, replicated as one value. */
+USTRUCT()
+struct FHMCurrency
+{
+	GENERATED_BODY()
+
+	/** The currency. */
+	UPROPERTY()
+	int32 Value;
+
+	/** Counts up with every ledger transaction, a client knows which change it's looking at. */
+	UPROPERTY()
+	uint32 Sequence;
+
+	FHMCurrency() : Value(0), Sequence(0) {}
+	FHMCurrency(int32 InValue) : Value(InValue), Sequence(0) {}
+};
+
 /**
  *
  */
@@ -31,11 +49,26 @@ public:
 	/** --- Start HMPlayerState code --- */
 private:
 
+	/** The replicated properties use push model, mark them dirty when changing them (Net/HMPushModel.h). */
 	UPROPERTY(Replicated)
 	ETeamType m_TeamType;
 
-	UPROPERTY(Replicated)
-	int32 m_Currency;
+	/** Only changed by ApplyCurrencyTransaction. */
+	UPROPERTY(ReplicatedUsing = OnRep_Currency)
+	FHMCurrency m_Currency;
+
+	UFUNCTION()
+	void OnRep_Currency();
+
+	/** The ledger applies the transactions. */
+	friend class UHMCurrencyLedgerSubsystem;
+
+	/**
+	 * Set the currency and start the next transaction (server)
+	 *
+	 * @param int32 NewCurrency The currency after the frame's deltas
+	 */
+	void ApplyCurrencyTransaction(int32 NewCurrency);
 
 	/** The number of kills that the player has. */
 	UPROPERTY(Replicated)
@@ -51,7 +84,7 @@ private:
 
 public:
 
-	FORCEINLINE void ChangeTeamType(ETeamType NewTeamType) { m_TeamType = NewTeamType; }
+	void ChangeTeamType(ETeamType NewTeamType);
 	FORCEINLINE ETeamType GetTeamType() const { return m_TeamType; }
 
 	static bool IsFriendly(AHMPlayerState* A, AHMPlayerState* B) { return A == nullptr || B == nullptr || A->GetTeamType() == B->GetTeamType(); }
@@ -60,19 +93,22 @@ public:
 	 * Add a kill to the playerstate.
 	 * This gets called on the server so no need to add a ServerRPC.
 	 */
-	FORCEINLINE void AddKill() { m_Kills++; }
+	void AddKill();
 
 	/**
 	 * Add a death to the playerstate.
 	 * This gets called on the server so no need to add a ServerRPC.
 	 */
-	FORCEINLINE void AddDeath() { m_Deaths++; }
+	void AddDeath();
 
 	//void AddDown();
 
 	/** Get the amount of currency a player has. */
 	UFUNCTION(BlueprintPure, Category = "HMPlayerState")
-	FORCEINLINE int32 GetCurrency() const { return m_Currency; }
+	FORCEINLINE int32 GetCurrency() const { return m_Currency.Value; }
+
+	/** Get the sequence number of the last currency transaction. */
+	FORCEINLINE uint32 GetCurrencySequence() const { return m_Currency.Sequence; }
 
 	/** Get the kills of the playerstate. */
 	UFUNCTION(BlueprintPure, Category = "HMPlayerState")
@@ -83,29 +119,20 @@ public:
 	FORCEINLINE int32 GetDeaths() const { return m_Deaths; }
 
 	/**
-	 * Add currency to the player
+	 * Add currency to the player, applied with the rest of the frame's deltas by UHMCurrencyLedgerSubsystem (server)
 	 *
 	 * @param int32 CurrencyToAdd The amount of currency to add to the player
 	 */
-	UFUNCTION(BlueprintCallable, Category = "HMPlayerState")
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "HMPlayerState")
 	void AddCurrency(int32 CurrencyToAdd);
 
-	UFUNCTION(BlueprintCallable, Category = "HMPlayerState")
-	void SetCurrency(int32 NewCurrency);
-
-	/** --- Server RPC methods --- */
-private:
-
 	/**
-	 * Server: Add currency to the player
+	 * Set the currency of the player, applied with the rest of the frame's deltas by UHMCurrencyLedgerSubsystem (server)
 	 *
-	 * @param int32 CurrencyToAdd The amount of currency to add to the player
+	 * @param int32 NewCurrency The currency the player ends up with
 	 */
-	UFUNCTION(Server, Unreliable, WithValidation)
-	void Server_AddCurrency(int32 CurrencyToAdd);
-
-	UFUNCTION(Server, Unreliable, WithValidation)
-	void Server_SetCurrency(int32 NewCurrency);
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "HMPlayerState")
+	void SetCurrency(int32 NewCurrency);
 
 protected:
 
@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMCorpseSubsystem.generated.h"
+
+/**
+ * Keeps the ragdolls of dead characters within budget (every machine).
+ *
+ * At most m_MaxActiveRagdolls corpses simulate physics at once, a new ragdoll freezes the oldest simulating one. A ragdoll that
+ * settled (or simulated for m_MaxSimulateTime) is frozen into its last pose with physics and collision off. Once there are more
+ * than m_MaxCorpses corpses the oldest ones are removed - pooled zombies go back to the pool, other characters are destroyed.
+ * Dedicated servers never simulate ragdolls. The ragdoll/physics body counts are in "stat HordeMode" and hm.Corpses.Stats.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMCorpseSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMCorpseSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** How many ragdolls can simulate at once. */
+	UPROPERTY(Config)
+	int32 m_MaxActiveRagdolls;
+
+	/** How many corpses can be in the level at once. */
+	UPROPERTY(Config)
+	int32 m_MaxCorpses;
+
+	/** A ragdoll simulates at least this long before it can be frozen. */
+	UPROPERTY(Config)
+	float m_SettleTime;
+
+	/** A ragdoll that moves slower than this after m_SettleTime is frozen. */
+	UPROPERTY(Config)
+	float m_SettleSpeed;
+
+	/** A ragdoll is frozen after this long even if it didn't settle. */
+	UPROPERTY(Config)
+	float m_MaxSimulateTime;
+
+	bool m_bInitialized;
+
+	/** The corpses, oldest first. */
+	TArray<TWeakObjectPtr<class AHMCharacterBase>> m_Corpses;
+	TArray<float> m_DeathTimes;
+	TArray<bool> m_Simulating;
+
+	/** Counters for hm.Corpses.Stats */
+	int32 m_NumActiveRagdolls;
+	int32 m_NumPhysicsBodies;
+	int32 m_NumFrozen;
+	int32 m_NumEvicted;
+
+	/** Turn off the ragdoll's physics and keep its current pose. */
+	void FreezeCorpse(int32 Index);
+
+	/** Get rid of a corpse - back to the pool, destroyed or hidden until the server gets rid of it. */
+	void EvictCorpse(int32 Index);
+
+	/** Forget about a corpse. */
+	void RemoveCorpse(int32 Index);
+
+public:
+
+	/**
+	 * Add a character that died, called from Multi_Ragdoll
+	 *
+	 * @param AHMCharacterBase* Character The dead character
+	 * @param bool bSimulating Did the character start simulating its ragdoll?
+	 */
+	void AddCorpse(class AHMCharacterBase* Character, bool bSimulating);
+
+	/** Forget about a character's corpse without touching it (a pooled zombie that is reset). */
+	void RemoveCharacter(class AHMCharacterBase* Character);
+
+	/** Get the number of ragdolls that are simulating. */
+	FORCEINLINE int32 GetNumActiveRagdolls() const { return m_NumActiveRagdolls; }
+
+	/** Log the corpse counters. */
+	void DumpStats() const;
+};
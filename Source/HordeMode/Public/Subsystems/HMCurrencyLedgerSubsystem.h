@@ -0,0 +1,85 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMCurrencyLedgerSubsystem.generated.h"
+
+/**
+ * The only thing that changes the currency of players (server).
+ *
+ * Hits, kills and door payments add deltas to the ledger instead of changing the player state right away. Once per frame
+ * the deltas of every player are summed up and applied in one transaction: the player state gets the new value and the next
+ * sequence number (replicated together) and fires its change event once, no matter how many hits paid out that frame.
+ * Spend checks and takes the money in one step against the balance including this frame's deltas, so two purchases in the
+ * same frame can't both spend the same currency. The counters are in "stat HordeMode" and hm.Currency.Stats.
+ */
+UCLASS()
+class HORDEMODE_API UHMCurrencyLedgerSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMCurrencyLedgerSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	bool m_bInitialized;
+
+	/** The players with deltas this frame and the sum of their deltas, indexed the same. */
+	TArray<TWeakObjectPtr<class AHMPlayerState>> m_PendingPlayers;
+	TArray<int32> m_PendingDeltas;
+
+	/** Counters for hm.Currency.Stats */
+	int32 m_NumDeltas;
+	int32 m_NumTransactions;
+	int32 m_NumRejectedSpends;
+
+	/** Get the index of Player in the pending arrays, adds it if it has no deltas yet. */
+	int32 FindOrAddPending(class AHMPlayerState* Player);
+
+	/** Apply the pending deltas of every player. */
+	void Flush();
+
+public:
+
+	/**
+	 * Add currency to (or take it from) a player this frame (server)
+	 *
+	 * @param AHMPlayerState* Player The player to pay
+	 * @param int32 Delta The currency to add, negative to take currency (the balance doesn't go below 0)
+	 */
+	void AddDelta(class AHMPlayerState* Player, int32 Delta);
+
+	/**
+	 * Take up to MaxAmount from a player in one transaction, what the player can't afford isn't taken (server)
+	 *
+	 * @param AHMPlayerState* Player The player that pays
+	 * @param int32 MaxAmount The most to take
+	 * @return what was taken
+	 */
+	int32 Spend(class AHMPlayerState* Player, int32 MaxAmount);
+
+	/**
+	 * Get the currency a player has once this frame's deltas are applied (server)
+	 *
+	 * @param const AHMPlayerState* Player The player
+	 * @return the balance
+	 */
+	int32 GetBalance(const class AHMPlayerState* Player) const;
+
+	/** Log the ledger counters. */
+	void DumpStats() const;
+};
@@ -0,0 +1,113 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "HMEffectPoolSubsystem.generated.h"
+
+/** The components of one particle template. */
+USTRUCT()
+struct FHMEffectPool
+{
+	GENERATED_BODY()
+
+	/** Components that are done playing and can be reused. */
+	UPROPERTY()
+	TArray<class UParticleSystemComponent*> Free;
+
+	/** Components that are playing, oldest first. */
+	UPROPERTY()
+	TArray<class UParticleSystemComponent*> Active;
+};
+
+/**
+ * Keeps a pool of reusable particle system components per template so firing doesn't create and destroy a component
+ * (muzzle flash, tracer and impact) for every shot.
+ *
+ * Every template is capped to a number of concurrent effects (the oldest one gets restarted when the cap is hit) and impacts
+ * that are further away from the local view than m_MaxImpactDistance are skipped. Nothing is spawned on dedicated servers.
+ * The pool counters are in "stat HordeMode" and hm.EffectPool.Stats logs them.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMEffectPoolSubsystem final : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UHMEffectPoolSubsystem();
+
+	virtual void Deinitialize() override;
+
+private:
+
+	/** How many effects of one template can play at the same time. */
+	UPROPERTY(Config)
+	int32 m_MaxActivePerTemplate;
+
+	/** Impacts further away from the local view than this are skipped. */
+	UPROPERTY(Config)
+	float m_MaxImpactDistance;
+
+	UPROPERTY()
+	TMap<class UParticleSystem*, FHMEffectPool> m_Pools;
+
+	/** Pool counters */
+	int32 m_NumHits;
+	int32 m_NumMisses;
+	int32 m_NumRecycled;
+	int32 m_NumCulled;
+
+	/** The local view location and the frame it was looked up in. */
+	FVector m_ViewLocation;
+	uint64 m_ViewLocationFrame;
+	bool m_bHasViewLocation;
+
+	/** Get a component for Template that's ready to be activated, nullptr if effects aren't played in this world. */
+	class UParticleSystemComponent* AcquireComponent(class UParticleSystem* Template);
+
+	/** Is Location close enough to the local view to bother with an impact effect? */
+	bool IsInImpactRange(const FVector& Location);
+
+	UFUNCTION()
+	void OnEffectFinished(class UParticleSystemComponent* Component);
+
+public:
+
+	/**
+	 * Play an effect at a location
+	 *
+	 * @param UParticleSystem* Template The effect to play
+	 * @param const FVector& Location Where to play the effect
+	 * @param const FRotator& Rotation The rotation of the effect
+	 * @param bool bIsImpact Impacts get skipped when they're too far away from the local view
+	 * @return the component that plays the effect (owned by the pool, don't hold on to it) or nullptr if it was skipped
+	 */
+	class UParticleSystemComponent* SpawnAtLocation(class UParticleSystem* Template, const FVector& Location, const FRotator& Rotation = FRotator::ZeroRotator, bool bIsImpact = false);
+
+	/**
+	 * Play an effect attached to a component
+	 *
+	 * @param UParticleSystem* Template The effect to play
+	 * @param USceneComponent* AttachTo The component to attach to
+	 * @param FName SocketName The socket to attach to
+	 * @return the component that plays the effect (owned by the pool, don't hold on to it) or nullptr if it was skipped
+	 */
+	class UParticleSystemComponent* SpawnAttached(class UParticleSystem* Template, class USceneComponent* AttachTo, FName SocketName);
+
+	/** Log the pool counters. */
+	void DumpStats() const;
+
+	/** Get the number of effects that reused a pooled component. */
+	FORCEINLINE int32 GetNumHits() const { return m_NumHits; }
+
+	/** Get the number of effects that had to create a new component - the number of component allocations. */
+	FORCEINLINE int32 GetNumMisses() const { return m_NumMisses; }
+
+	/** Get the number of effects that restarted a playing component because the template was at its cap. */
+	FORCEINLINE int32 GetNumRecycled() const { return m_NumRecycled; }
+
+	/** Get the number of impacts that were skipped because they were too far away. */
+	FORCEINLINE int32 GetNumCulled() const { return m_NumCulled; }
+};
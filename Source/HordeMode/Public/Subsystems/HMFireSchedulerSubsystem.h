@@ -0,0 +1,82 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMFireSchedulerSubsystem.generated.h"
+
+/**
+ * Owns the next shot time of every firearm whose trigger is held (or that is finishing a burst).
+ *
+ * Every frame all shots that are due get fired, each with how long ago (within the frame) it should have been fired,
+ * so the rate of fire doesn't depend on the frame/tick rate - a 1200 RPM firearm fires 20 shots a second at 30 Hz and 120 Hz.
+ * Semi auto and burst are just a limited number of shots that keep going after the trigger is released.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMFireSchedulerSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMFireSchedulerSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** After a hitch at most this many seconds worth of shots get caught up on, the rest are skipped. */
+	UPROPERTY(Config)
+	float m_MaxCatchUpTime;
+
+	bool m_bInitialized;
+
+	/** --- Per firing firearm --- */
+
+	TArray<TWeakObjectPtr<class AHMFirearmBase>> m_Firearms;
+
+	/** The world time the next shot is due at. */
+	TArray<double> m_NextShotTimes;
+
+	/** Seconds between two shots. */
+	TArray<float> m_Intervals;
+
+	/** Shots left to fire, INDEX_NONE fires until the trigger is released. */
+	TArray<int32> m_ShotsRemaining;
+
+	/** Remove the firearm at Index (swaps with the last one). */
+	void RemoveAt(int32 Index);
+
+public:
+
+	/**
+	 * Start firing a firearm
+	 *
+	 * @param AHMFirearmBase* Firearm The firearm to fire, does nothing if it's already firing
+	 * @param float TimeBetweenShots Seconds between two shots
+	 * @param int32 NumShots How many shots to fire (these get fired even if the trigger is released), INDEX_NONE to fire until StopFiring
+	 * @param float EarliestShotTime The world time the first shot can be fired at (the last shot + TimeBetweenShots)
+	 */
+	void StartFiring(class AHMFirearmBase* Firearm, float TimeBetweenShots, int32 NumShots, float EarliestShotTime);
+
+	/** The trigger got released - stops a firearm that fires until released, a burst finishes first. */
+	void StopFiring(class AHMFirearmBase* Firearm);
+
+	/** Stop a firearm right away (reloading etc), a burst doesn't finish. Calls OnScheduledFireFinished if it was firing. */
+	void CancelFiring(class AHMFirearmBase* Firearm);
+
+	/** Is the firearm being fired by the scheduler? */
+	FORCEINLINE bool IsFiring(const class AHMFirearmBase* Firearm) const { return m_Firearms.IndexOfByKey(Firearm) != INDEX_NONE; }
+
+	/** Get the number of firearms that are being fired. */
+	FORCEINLINE int32 GetNumFiring() const { return m_Firearms.Num(); }
+};
@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "HMCommon.h"
+
+#include "HMFirearmRegistry.generated.h"
+
+/**
+ * Every firearm's stats, built once per world from the game state's firearm stats DataTable (DT_FirearmStats), and the
+ * hit zone table that every firearm resolves its hits with (DT_HitZones).
+ * Firearms only hold a FHMFirearmHandle into this instead of their own copy of FFirearmStats.
+ *
+ * The registry never changes after it was built so references to its entries stay valid for the whole world, a map with
+ * other tables gets its own registry. On clients the game state can replicate after the first firearms, until then the
+ * registry isn't built (IsBuilt) and firearms use the default stats and look themselves up again later.
+ * Index 0 always holds the default stats, unknown ids resolve to it.
+ */
+UCLASS()
+class HORDEMODE_API UHMFirearmRegistry final : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+
+	/** The full stats (text, cosmetics etc) of every firearm. */
+	UPROPERTY()
+	TArray<FFirearmStats> m_Stats;
+
+	/** The hot stats of every firearm, same index as m_Stats. */
+	TArray<FHMFirearmHotStats> m_HotStats;
+
+	/** Firearm id (row name) to index. */
+	TMap<FName, int32> m_Indices;
+
+	/** The table that the registry was built from. */
+	UPROPERTY()
+	class UDataTable* m_SourceTable;
+
+	/** How hits on every physical surface are resolved. */
+	FHMHitZoneTable m_HitZones;
+
+	UPROPERTY()
+	class UDataTable* m_HitZoneTable;
+
+	bool m_bBuilt;
+
+	/** Build the registry from the game state's table if that hasn't happened yet. */
+	void BuildIfNeeded(const UObject* WorldContextObject);
+
+public:
+	UHMFirearmRegistry();
+
+	/** Get the registry of the world that WorldContextObject is in. */
+	static UHMFirearmRegistry* Get(const UObject* WorldContextObject);
+
+	/** Get the stats that are used when a firearm couldn't be found. */
+	static const FFirearmStats& GetDefaultStats();
+
+	/** Get the hot stats that are used when a firearm couldn't be found. */
+	static const FHMFirearmHotStats& GetDefaultHotStats();
+
+	/** Get the hit zones that are used before the registry was built. */
+	static const FHMHitZoneTable& GetDefaultHitZones();
+
+	/**
+	 * Find a firearm in the registry
+	 *
+	 * @param const UObject* WorldContextObject Used to find the DataTable the first time the registry is used
+	 * @param FName FirearmID The row name of the firearm in the DataTable
+	 * @return the handle of the firearm, the default stats' handle if it doesn't exist or the registry isn't built yet
+	 */
+	FHMFirearmHandle FindFirearm(const UObject* WorldContextObject, FName FirearmID);
+
+	/** Get the full stats of a firearm. */
+	const FFirearmStats& GetStats(FHMFirearmHandle Handle) const;
+
+	/** Get the hot stats of a firearm. */
+	const FHMFirearmHotStats& GetHotStats(FHMFirearmHandle Handle) const;
+
+	/** Get the hit zone table (stays at the same address for the whole world). */
+	FORCEINLINE const FHMHitZoneTable& GetHitZones() const { return m_HitZones; }
+
+	/** Get Was the registry built from the game state's tables yet? */
+	FORCEINLINE bool IsBuilt() const { return m_bBuilt; }
+
+	/** Get the number of firearms in the registry (including the default). */
+	FORCEINLINE int32 GetNumFirearms() const { return m_Stats.Num(); }
+};
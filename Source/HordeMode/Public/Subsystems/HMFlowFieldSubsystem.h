@@ -0,0 +1,171 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMFlowFieldSubsystem.generated.h"
+
+/** The integration field towards one player. */
+struct FHMFlowField
+{
+	/** The path cost of every grid cell to the target, MAX_uint16 if the target can't be reached from the cell. */
+	TArray<uint16> Costs;
+
+	/** The field that is being integrated, swapped with Costs once it's done. */
+	TArray<uint16> PendingCosts;
+
+	/** The open list of the pending field (cell index, cost) - a heap ordered by cost. */
+	TArray<TPair<int32, uint16>> Open;
+
+	/** The cell of the target Costs was integrated from, INDEX_NONE until the first field is done. */
+	int32 TargetCell;
+
+	/** The cell of the target PendingCosts is integrated from, INDEX_NONE if nothing is pending. */
+	int32 PendingTargetCell;
+
+	FHMFlowField() : TargetCell(INDEX_NONE), PendingTargetCell(INDEX_NONE) {}
+
+	FORCEINLINE bool IsReady() const { return TargetCell != INDEX_NONE; }
+	FORCEINLINE bool IsIntegrating() const { return PendingTargetCell != INDEX_NONE; }
+};
+
+/**
+ * Flow field navigation for the horde (server).
+ *
+ * A coarse 2D grid is sampled from the navmesh once (m_MaxGridCellsPerFrame at a time) - every cell stores its height and which
+ * of its 8 neighbours can be walked to. Every alive player gets an integration field (Dijkstra from the player's cell) that is
+ * integrated again whenever the player moves to another cell, spread over frames with m_MaxCellsPerFrame and double buffered so
+ * zombies always sample a complete field. A field is seeded from the previous one, so only the cells that got closer to the player are relaxed.
+ *
+ * Zombies sample the cell they are in and steer towards the neighbour that is closest to the nearest player, so the cost of
+ * pathfinding depends on the number of players and the size of the level instead of the number of zombies.
+ * Levels with floors above each other aren't supported by the 2D grid (the navmesh closest to the middle of the bounds wins).
+ * The costs are in "stat HordeMode", hm.FlowField.Stats logs the grid/fields and hm.FlowField.Debug 1 draws the flow around the players.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMFlowFieldSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMFlowFieldSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** The size of a grid cell. */
+	UPROPERTY(Config)
+	float m_CellSize;
+
+	/** Neighbouring cells with a bigger height difference than this aren't connected. */
+	UPROPERTY(Config)
+	float m_MaxStepHeight;
+
+	/** The most cells that are integrated per frame (all fields together). */
+	UPROPERTY(Config)
+	int32 m_MaxCellsPerFrame;
+
+	/** The most grid cells that are sampled from/connected on the navmesh per frame (navmesh queries are a lot more expensive). */
+	UPROPERTY(Config)
+	int32 m_MaxGridCellsPerFrame;
+
+	/** The grid is never bigger than this many cells on a side (the cells get bigger instead). */
+	UPROPERTY(Config)
+	int32 m_MaxGridSize;
+
+	bool m_bInitialized;
+
+	/** The grid (the origin's Z is the middle of the navmesh bounds) */
+	FVector m_GridOrigin;
+	float m_GridHalfHeight;
+	float m_GridCellSize;
+	int32 m_GridSizeX;
+	int32 m_GridSizeY;
+
+	/** Navmesh height of every cell, MAX_flt if the cell isn't on the navmesh. */
+	TArray<float> m_CellHeights;
+
+	/** Bit N is set if neighbour N (see NeighbourOffsets) can be walked to, 0 if the cell isn't on the navmesh. */
+	TArray<uint8> m_CellNeighbours;
+
+	/**
+	 * How far building the grid got - cells [0, NumCells) are sampled from the navmesh first,
+	 * then [NumCells, 2 * NumCells) get connected to their neighbours. The grid is done once this reaches 2 * NumCells
+	 */
+	int32 m_GridBuildCursor;
+
+	/** Has the grid been set up (bounds, size) yet? */
+	bool m_bGridCreated;
+
+	/** The players and their integration fields. */
+	TArray<TWeakObjectPtr<APawn>> m_Targets;
+	TArray<FHMFlowField> m_Fields;
+
+	/** The field that gets integration budget first next frame. */
+	int32 m_NextField;
+
+	/** Counters for hm.FlowField.Stats, repairs are the integrations that were seeded from the previous field. */
+	int32 m_NumIntegrations;
+	int32 m_NumRepairs;
+	int32 m_NumSamples;
+
+	/** Size the grid to the navmesh bounds volumes, false if the level doesn't have any. */
+	bool CreateGrid();
+
+	/** Sample/connect up to Budget cells of the grid, returns the number of cells that were done. */
+	int32 BuildGrid(int32 Budget);
+
+	/** Connect a cell to its east/north neighbours (and those back to it) if they can be walked to. */
+	void ConnectCell(int32 Cell);
+
+	/** Add/remove targets for players that spawned/died and start integrating fields of targets that moved. */
+	void UpdateTargets();
+
+	/** Integrate up to Budget cells of Field, swaps the field in once it's done. */
+	int32 IntegrateField(FHMFlowField& Field, int32 Budget);
+
+	/** Get the cell Location is in, INDEX_NONE if it's outside the grid. */
+	int32 GetCell(const FVector& Location) const;
+
+	/** Get the cell Location is in, or a walkable neighbour of it if it isn't on the navmesh (standing on a prop etc). */
+	int32 GetWalkableCell(const FVector& Location) const;
+
+	FORCEINLINE bool IsCellWalkable(int32 Cell) const { return m_CellHeights[Cell] != MAX_flt; }
+
+	/** Get the center of a cell on the navmesh. */
+	FVector GetCellLocation(int32 Cell) const;
+
+	void DrawDebug() const;
+
+public:
+
+	/** Get Is the grid done sampling? */
+	FORCEINLINE bool IsGridReady() const { return m_bGridCreated && m_GridBuildCursor >= m_CellNeighbours.Num() * 2; }
+
+	/**
+	 * Get the direction a pawn at Location should move in to get to the nearest player
+	 *
+	 * @param const FVector& Location Where the pawn is
+	 * @param FVector& OutDirection The (2D) direction to move in
+	 * @param APawn*& OutTarget The player the pawn is moving to
+	 * @return false if Location isn't on the grid or no player can be reached from there
+	 */
+	bool GetSteeringDirection(const FVector& Location, FVector& OutDirection, APawn*& OutTarget);
+
+	/** Throw away the grid and the fields and sample the navmesh again (after the navmesh changed). */
+	void Rebuild();
+
+	/** Log the grid size and the field counters. */
+	void DumpStats() const;
+};
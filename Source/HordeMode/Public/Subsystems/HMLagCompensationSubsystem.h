@@ -0,0 +1,134 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMLagCompensationSubsystem.generated.h"
+
+/**
+ * Server side lag compensation for hitscan shots.
+ *
+ * Every frame the hit capsule of every registered AHMCharacterBase is recorded into a fixed size ring buffer (struct of arrays,
+ * frame major so one snapshot is a contiguous block). When a client shot gets validated the shot is tested against the capsules
+ * as they were at the client's timestamp and the candidate's mesh is traced with the ray moved into the character's current space,
+ * so the actual actors never get moved.
+ *
+ * All of the history is allocated once when the first character registers (so only on the server), recording and rewinding never allocate.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMLagCompensationSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMLagCompensationSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** How many frames of history to keep. */
+	UPROPERTY(Config)
+	int32 m_HistoryFrames;
+
+	/** How many characters can be tracked at once. */
+	UPROPERTY(Config)
+	int32 m_MaxCharacters;
+
+	/** How far back (in seconds) a shot is allowed to rewind. */
+	UPROPERTY(Config)
+	float m_MaxRewindTime;
+
+	/** The recorded capsule radius gets scaled by this for the broadphase since arms etc stick out of the capsule. */
+	UPROPERTY(Config)
+	float m_CapsuleInflation;
+
+	bool m_bInitialized;
+
+	/** Index of the newest frame in the ring buffer, INDEX_NONE until the first frame was recorded. */
+	int32 m_Head;
+
+	/** How many frames in the ring buffer hold valid data. */
+	int32 m_NumFrames;
+
+	/** Increases every recorded frame, used to know which frames a slot has valid data in. */
+	uint32 m_FrameCounter;
+
+	/** --- Per frame --- */
+
+	/** The server time of every recorded frame. [m_HistoryFrames] */
+	TArray<float> m_FrameTimes;
+
+	/** The capsule center of every slot for every frame. [m_HistoryFrames * m_MaxCharacters] */
+	TArray<FVector> m_Positions;
+
+	/** 1 if the slot was alive and collidable in that frame. [m_HistoryFrames * m_MaxCharacters] */
+	TArray<uint8> m_Collidable;
+
+	/** --- Per slot --- */
+
+	TArray<TWeakObjectPtr<class AHMCharacterBase>> m_Characters;
+	TArray<float> m_Radius;
+	TArray<float> m_HalfHeight;
+
+	/** The first frame (m_FrameCounter) the slot has valid data for. */
+	TArray<uint32> m_FirstFrame;
+
+	/** Slots that aren't being used. */
+	TArray<int32> m_FreeSlots;
+
+	/** Every slot below this index has been used at some point - no need to look past it. */
+	int32 m_NumUsedSlots;
+
+	/** Allocate the ring buffer. */
+	void AllocateHistory();
+
+	void RecordFrame();
+
+	/**
+	 * Find the two recorded frames around Time
+	 *
+	 * @return false if there's no history for Time
+	 */
+	bool FindFrames(float Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha, uint32& OutOlderFrameNumber) const;
+
+public:
+
+	/**
+	 * Start tracking a character. Called by AHMCharacterBase on the server.
+	 *
+	 * @return the slot for the character or INDEX_NONE if the buffer is full
+	 */
+	int32 RegisterCharacter(class AHMCharacterBase* Character);
+
+	/** Stop tracking the character in Slot. */
+	void UnregisterCharacter(int32 Slot);
+
+	/**
+	 * Trace a shot against the characters as they were at Time without moving any of them
+	 *
+	 * @param float Time The server time that the client fired at
+	 * @param const FVector& TraceStart Where the shot started
+	 * @param const FVector& TraceEnd Where the shot ended
+	 * @param const AActor* IgnoreActor The actor that fired the shot
+	 * @param FHitResult& OutHit The hit against the closest character's mesh (in the rewound position)
+	 * @return true if a character was hit
+	 */
+	bool RewindTrace(float Time, const FVector& TraceStart, const FVector& TraceEnd, const AActor* IgnoreActor, FHitResult& OutHit) const;
+
+	/** Get how far back a shot can be rewound. */
+	FORCEINLINE float GetMaxRewindTime() const { return m_MaxRewindTime; }
+
+	/** Get the number of characters that are being tracked. */
+	FORCEINLINE int32 GetNumTrackedCharacters() const { return m_NumUsedSlots - m_FreeSlots.Num(); }
+};
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMMeleeSubsystem.generated.h"
+
+/**
+ * Runs the melee attacks of every zombie (server).
+ *
+ * A zombie that is off cooldown and has a player within its melee range starts an attack, after the windup its hit window opens.
+ * Once per frame the open windows of all zombies are resolved in one pass against the positions of the live players (range + cone),
+ * a window hits every player at most once and stops at its first hit. Damage goes through AHMCharacterBase::TakeDamage.
+ * The cooldowns and windows live in flat arrays instead of a timer per zombie. The counters are in "stat HordeMode" and hm.Melee.Stats.
+ */
+UCLASS()
+class HORDEMODE_API UHMMeleeSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMMeleeSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	bool m_bInitialized;
+
+	/** The zombies and their attack state, all indexed the same. */
+	TArray<TWeakObjectPtr<class AHMAICharacterBase>> m_Attackers;
+
+	/** When the zombie can start its next attack. */
+	TArray<float> m_NextAttackTimes;
+
+	/** The hit window of the current attack, [start, end]. */
+	TArray<float> m_WindowStarts;
+	TArray<float> m_WindowEnds;
+
+	/** Is the zombie in an attack that didn't hit yet? */
+	TArray<bool> m_Attacking;
+
+	/** Counters for hm.Melee.Stats */
+	int32 m_NumAttacks;
+	int32 m_NumHits;
+	int32 m_NumWindowsResolved;
+
+	/** Forget about a zombie. */
+	void RemoveAttacker(int32 Index);
+
+public:
+
+	/** Add a zombie (server). */
+	void RegisterAttacker(class AHMAICharacterBase* Attacker);
+
+	/** Remove a zombie. */
+	void UnregisterAttacker(class AHMAICharacterBase* Attacker);
+
+	/** Log the attack counters. */
+	void DumpStats() const;
+};
@@ -0,0 +1,119 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMPerceptionSubsystem.generated.h"
+
+/**
+ * Sight for every zombie in one place instead of a perception component per AI controller (server).
+ *
+ * Every frame the next (zombie, player) pairs are checked round robin. Pairs out of sight radius or out of the zombie's
+ * vision cone are rejected without a trace, at most m_MaxTracesPerFrame visibility traces are done per frame.
+ * A zombie's target is the closest player it sees and is forgotten m_ForgetTime after it was last seen.
+ *
+ * The results are kept in a table indexed by the zombie's slot (AHMAICharacterBase::GetPerceptionSlot) that AHMAIController reads.
+ * The trace counts are in "stat HordeMode" and hm.Perception.Stats.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMPerceptionSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMPerceptionSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** How far a zombie can spot a player. */
+	UPROPERTY(Config)
+	float m_SightRadius;
+
+	/** How far a zombie can keep seeing a player it already sees. */
+	UPROPERTY(Config)
+	float m_LoseSightRadius;
+
+	/** Half angle (degrees) in front of a zombie it can spot a player in. */
+	UPROPERTY(Config)
+	float m_VisionHalfAngle;
+
+	/** How long a zombie keeps its target after it last saw it. */
+	UPROPERTY(Config)
+	float m_ForgetTime;
+
+	/** How many visibility traces can be done per frame. */
+	UPROPERTY(Config)
+	int32 m_MaxTracesPerFrame;
+
+	bool m_bInitialized;
+
+	/** The zombies by slot, a free slot has no zombie. */
+	TArray<TWeakObjectPtr<class AHMAICharacterBase>> m_Zombies;
+
+	/** The players (bit N is m_Players[N]) the zombie sees. */
+	TArray<uint32> m_VisibleMasks;
+
+	/** The target of the zombie, where and when it was last seen. */
+	TArray<TWeakObjectPtr<class AHMCharacterBase>> m_Targets;
+	TArray<FVector> m_LastSeenLocations;
+	TArray<float> m_LastSeenTimes;
+
+	/** Slots that aren't being used. */
+	TArray<int32> m_FreeSlots;
+
+	/** The players the visible masks refer to. */
+	TArray<TWeakObjectPtr<class AHMCharacterBase>> m_Players;
+
+	/** How many zombies see each player. */
+	TArray<int32> m_NumPerceivers;
+
+	/** The next (zombie, player) pair to check, Slot * m_Players.Num() + Player. */
+	int32 m_NextPair;
+
+	/** Counters for hm.Perception.Stats */
+	int32 m_NumTraces;
+	int32 m_NumChecks;
+	int32 m_NumTargets;
+
+	/** Forget what every zombie sees. */
+	void ResetVisibility();
+
+public:
+
+	/**
+	 * Start perceiving for a zombie (server)
+	 *
+	 * @return the slot of the zombie in the target table
+	 */
+	int32 RegisterZombie(class AHMAICharacterBase* Zombie);
+
+	/** Stop perceiving for the zombie in Slot. */
+	void UnregisterZombie(int32 Slot);
+
+	/** Get the player the zombie in Slot is after, nullptr if it doesn't know about any. */
+	FORCEINLINE class AHMCharacterBase* GetTarget(int32 Slot) const { return m_Targets.IsValidIndex(Slot) ? m_Targets[Slot].Get() : nullptr; }
+
+	/** Get where the zombie in Slot last saw its target. */
+	FORCEINLINE const FVector& GetLastSeenLocation(int32 Slot) const { return m_LastSeenLocations[Slot]; }
+
+	/** Get Can the zombie in Slot see Player right now? */
+	bool CanSee(int32 Slot, const class AHMCharacterBase* Player) const;
+
+	/** Get the number of zombies that see Player. */
+	int32 GetNumPerceivers(const class AHMCharacterBase* Player) const;
+
+	/** Log the perception counters. */
+	void DumpStats() const;
+};
@@ -0,0 +1,103 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+
+#include "HMProjectileSubsystem.generated.h"
+
+/**
+ * Simulates every projectile in the world (slow bullets, rockets etc) as an entry in a set of flat arrays, there's no actor
+ * or component per projectile so spawning one is just adding to the arrays.
+ *
+ * Every frame the projectiles integrate gravity and drag and all of their sweeps are submitted as one batch of async traces,
+ * the results are resolved the next frame (like UHMShotQueueSubsystem). The server owns the impacts, clients only simulate
+ * the projectiles for their trail effect - the firearm replicates a compact spawn message and the impacts.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMProjectileSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMProjectileSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** How many projectiles to reserve space for when the first one gets spawned. */
+	UPROPERTY(Config)
+	int32 m_ReservedProjectiles;
+
+	bool m_bInitialized;
+
+	/** The id of the next projectile that gets spawned on the server. */
+	uint16 m_NextId;
+
+	/** --- Per projectile --- */
+
+	TArray<uint16> m_Ids;
+	TArray<TWeakObjectPtr<class AHMFirearmBase>> m_Firearms;
+	TArray<FVector> m_Positions;
+	TArray<FVector> m_Velocities;
+	TArray<float> m_TimeLeft;
+	TArray<float> m_GravityZ;
+	TArray<float> m_Drag;
+	TArray<float> m_Radius;
+
+	/** The sweep of the last frame, invalid for projectiles that were spawned this frame. */
+	TArray<FTraceHandle> m_TraceHandles;
+
+	/** The trail effect (from UHMEffectPoolSubsystem), only on clients. */
+	TArray<TWeakObjectPtr<class UParticleSystemComponent>> m_Trails;
+
+	/** A projectile that hit something in last frame's sweeps. */
+	struct FImpact
+	{
+		int32 Index;
+		FHitResult Hit;
+	};
+
+	/** Reused every frame. */
+	TArray<FImpact> m_Impacts;
+
+	/** Resolve last frame's sweeps and remove the projectiles that hit something. */
+	void ResolveImpacts();
+
+	/** Move the projectiles and submit their sweeps. */
+	void IntegrateAndSweep(float DeltaTime);
+
+	/** Remove the projectile at Index (swaps with the last one). */
+	void RemoveAt(int32 Index);
+
+public:
+
+	/**
+	 * Launch a projectile
+	 *
+	 * @param AHMFirearmBase* Firearm The firearm that fired the projectile, it applies the impact
+	 * @param const FVector& Origin Where to launch from
+	 * @param const FVector& Direction The launch direction
+	 * @param const FProjectileData& Data How the projectile flies
+	 * @param int32 Id The id the server gave the projectile (clients), INDEX_NONE to make a new one (server)
+	 * @return the id of the projectile
+	 */
+	uint16 SpawnProjectile(class AHMFirearmBase* Firearm, const FVector& Origin, const FVector& Direction, const struct FProjectileData& Data, int32 Id = INDEX_NONE);
+
+	/** Remove a projectile without an impact (the server told us it hit something). */
+	void RemoveProjectile(uint16 Id);
+
+	/** Get the number of projectiles in flight. */
+	FORCEINLINE int32 GetNumProjectiles() const { return m_Ids.Num(); }
+};
@@ -0,0 +1,145 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+
+#include "HMShotQueueSubsystem.generated.h"
+
+/** A single hitscan shot waiting for its trace to be submitted/resolved. */
+struct FHMQueuedShot
+{
+	/** The firearm that fired the shot, the result is handed back to it. */
+	TWeakObjectPtr<class AHMFirearmBase> Firearm;
+
+	FVector TraceStart;
+	FVector TraceEnd;
+
+	FCollisionQueryParams QueryParams;
+	FCollisionResponseParams ResponseParams;
+
+	/** The server time the client fired at, -1 if the shot isn't lag compensated. */
+	float RewindTime;
+
+	/** Handle of the async trace once the shot has been submitted. */
+	FTraceHandle TraceHandle;
+
+	/** How many pellets (this and the shots right after it) were fired by the same trigger pull, 0 on all but the first pellet. */
+	int32 NumPellets;
+
+	FHMQueuedShot() : TraceStart(FVector::ZeroVector), TraceEnd(FVector::ZeroVector), RewindTime(-1.0f), NumPellets(1) {}
+
+	FORCEINLINE bool IsLagCompensated() const { return RewindTime >= 0.0f; }
+};
+
+/** The result of one pellet's trace, handed to AHMFirearmBase::ResolveShot. */
+struct FHMShotTraceResult
+{
+	FVector TraceEnd;
+
+	/** Only valid if bHit. */
+	FHitResult Hit;
+
+	bool bHit;
+
+	FHMShotTraceResult() : TraceEnd(FVector::ZeroVector), bHit(false) {}
+};
+
+/**
+ * Collects every hitscan shot fired during a frame (from all firearms) and submits them as one batch of async traces.
+ * The results come back the next frame and are resolved in a single pass (damage, currency, effects and replication).
+ * All pellets of a trigger pull (shotguns) are queued together and handed back to the firearm together.
+ *
+ * hm.BatchedShots 0 switches back to the old blocking trace per shot, hm.BenchShots <Frames> compares both paths.
+ */
+UCLASS()
+class HORDEMODE_API UHMShotQueueSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMShotQueueSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** Shots that were queued this frame and still have to be submitted. */
+	TArray<FHMQueuedShot> m_PendingShots;
+
+	/** Shots that were submitted last frame and are waiting for their results. */
+	TArray<FHMQueuedShot> m_InFlightShots;
+
+	bool m_bInitialized;
+
+	/** --- Benchmark --- */
+
+	/** Frames left in the current benchmark phase, 0 when no benchmark is running. */
+	int32 m_BenchFramesLeft;
+	int32 m_BenchFramesPerPhase;
+
+	/** 0 = sync phase, 1 = batched phase */
+	int32 m_BenchPhase;
+
+	/** The value of hm.BatchedShots before the benchmark started. */
+	int32 m_BenchPreviousMode;
+
+	/** Accumulated frame time (seconds), game thread shot time (seconds) and shot count for the current phase. */
+	double m_BenchFrameTime;
+	double m_BenchShotTime;
+	int32 m_BenchShots;
+
+	/** Results of the sync phase so we can print both side by side. */
+	double m_BenchSyncFrameTime;
+	double m_BenchSyncShotTime;
+	int32 m_BenchSyncShots;
+
+	void SubmitPendingShots();
+	void ResolveInFlightShots();
+
+	/** Trace a pellet right away. */
+	void TracePellet(const FHMQueuedShot& Pellet, FHMShotTraceResult& OutResult);
+
+	/** Get the result of a pellet from its world trace, lag compensated pellets get their character hit from UHMLagCompensationSubsystem. */
+	void GetPelletResult(const FHMQueuedShot& Pellet, const FHitResult* WorldHit, FHMShotTraceResult& OutResult) const;
+
+	void TickBenchmark(float DeltaTime);
+
+public:
+
+	/** Are shots currently being batched? (hm.BatchedShots) */
+	static bool IsBatchingEnabled();
+
+	/**
+	 * Queue a shot to be traced with the rest of this frame's shots
+	 *
+	 * @param AHMFirearmBase* Firearm The firearm that fired the shot, AHMFirearmBase::ResolveShot gets called on it with the results
+	 * @param const FVector& TraceStart Where the traces start
+	 * @param TArrayView<const FVector> TraceEnds Where the trace of every pellet ends (one for a normal shot)
+	 * @param const FCollisionQueryParams& QueryParams The query params for the traces
+	 * @param float RewindTime The server time the client fired at (see UHMLagCompensationSubsystem), -1 to not lag compensate the shot
+	 */
+	void QueueShot(class AHMFirearmBase* Firearm, const FVector& TraceStart, TArrayView<const FVector> TraceEnds, const FCollisionQueryParams& QueryParams, float RewindTime = -1.0f);
+
+	/** Trace a shot right away on the game thread and resolve it (the unbatched path) */
+	void TraceShotNow(class AHMFirearmBase* Firearm, const FVector& TraceStart, TArrayView<const FVector> TraceEnds, const FCollisionQueryParams& QueryParams, float RewindTime = -1.0f);
+
+	/** Time the sync path and then the batched path for Frames frames each and log the results. */
+	void StartBenchmark(int32 Frames);
+
+	/** Get the number of shots waiting to be submitted. */
+	FORCEINLINE int32 GetNumPendingShots() const { return m_PendingShots.Num(); }
+
+	/** Get the number of shots waiting for their trace results. */
+	FORCEINLINE int32 GetNumInFlightShots() const { return m_InFlightShots.Num(); }
+};
@@ -0,0 +1,128 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMCommon.h"
+
+#include "HMSignificanceSubsystem.generated.h"
+
+/**
+ * Buckets zombies by their distance to the nearest player and whether any player is looking at them (server).
+ *
+ * Zombies within m_NearDistance of a player always tick every frame. Further away zombies that a player looks at are Mid/Far,
+ * zombies that nobody looks at are Hidden and nearly dormant. The actor, movement component, mesh and AI controller of a zombie
+ * tick at the bucket's interval (the tick functions get the accumulated delta time so nothing moves slower, only coarser).
+ *
+ * m_MaxUpdatesPerFrame zombies are re-bucketed per frame (round robin). hm.Significance 0 puts every zombie back to Near,
+ * the bucket counts and skipped ticks are in "stat HordeMode" and hm.Significance.Bench measures the game thread time saved.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMSignificanceSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMSignificanceSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** Zombies closer than this to a player are always Near. */
+	UPROPERTY(Config)
+	float m_NearDistance;
+
+	/** Zombies a player looks at that are further away than this are Far. */
+	UPROPERTY(Config)
+	float m_MidDistance;
+
+	/** Half angle (degrees) of the cone a player counts as looking at. */
+	UPROPERTY(Config)
+	float m_ViewConeHalfAngle;
+
+	/** Tick intervals of the buckets (Near ticks every frame). */
+	UPROPERTY(Config)
+	float m_MidTickInterval;
+
+	UPROPERTY(Config)
+	float m_FarTickInterval;
+
+	UPROPERTY(Config)
+	float m_HiddenTickInterval;
+
+	/** How many zombies are re-bucketed per frame. */
+	UPROPERTY(Config)
+	int32 m_MaxUpdatesPerFrame;
+
+	bool m_bInitialized;
+
+	/** Was hm.Significance on last frame? */
+	bool m_bWasEnabled;
+
+	/** The zombies and their current bucket. */
+	TArray<TWeakObjectPtr<class AHMCharacterBase>> m_Characters;
+	TArray<EZombieSignificance> m_Significances;
+
+	/** The next zombie to re-bucket. */
+	int32 m_NextUpdate;
+
+	/** Zombies per bucket. */
+	int32 m_NumPerBucket[(int32)EZombieSignificance::MAX];
+
+	/** Tick functions (actor, movement, mesh, controller) that didn't run last frame because of the buckets. */
+	float m_TicksSkipped;
+
+	/** hm.Significance.Bench - 1 while it measures with the buckets off, 2 with them on */
+	int32 m_BenchmarkPhase;
+	double m_BenchmarkPhaseEndTime;
+	float m_BenchmarkSeconds;
+	double m_BenchmarkGameThreadTime[2];
+	int32 m_BenchmarkFrames[2];
+
+	/** Get the tick interval of a bucket. */
+	float GetTickInterval(EZombieSignificance Significance) const;
+
+	/** Set the tick interval of the zombie's tick functions. */
+	void ApplySignificance(class AHMCharacterBase* Character, EZombieSignificance Significance) const;
+
+	/** Put every zombie back in Near. */
+	void ResetSignificances();
+
+	/** Accumulate the game thread time for the benchmark and move it to the next phase. */
+	void UpdateBenchmark();
+
+	/** Is bucketing on (hm.Significance, turned off by the benchmark's first half)? */
+	bool IsEnabled() const;
+
+public:
+
+	/** Add a zombie (server). */
+	void RegisterCharacter(class AHMCharacterBase* Character);
+
+	/** Remove a zombie, it ticks every frame again. */
+	void UnregisterCharacter(class AHMCharacterBase* Character);
+
+	/** Get the number of zombies in a bucket. */
+	FORCEINLINE int32 GetNumInBucket(EZombieSignificance Significance) const { return m_NumPerBucket[(int32)Significance]; }
+
+	/**
+	 * Measure the average game thread time with the buckets off and then on
+	 *
+	 * @param float Seconds How long each half runs
+	 */
+	void StartBenchmark(float Seconds);
+
+	/** Log the bucket counts and the skipped ticks. */
+	void DumpStats() const;
+};
@@ -0,0 +1,184 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMCommon.h"
+
+#include "HMSpawnDirectorSubsystem.generated.h"
+
+/**
+ * Runs the waves on the server - intermission, spawning and waiting for the wave's zombies to be killed.
+ *
+ * Waves come from the game state's wave DataTable (waves past the end of the table repeat the last row with more zombies).
+ * A wave doesn't get spawned in one go, at most m_MaxAliveZombies are alive at once and every frame only spawns until
+ * either m_MaxSpawnsPerFrame zombies were spawned or m_SpawnBudgetMs was used up, so a big wave trickles in over a few frames.
+ *
+ * Zombies spawn at actors tagged m_SpawnPointTag, or on the navmesh around a random player if the level doesn't have any.
+ * The wave state is replicated through AHMGameStateBase, the spawn cost is in "stat HordeMode" and hm.SpawnDirector.Stats.
+ * Zombies come from UHMZombiePoolSubsystem unless hm.ZombiePool is 0, hm.SpawnDirector.Bench compares the two.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMSpawnDirectorSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMSpawnDirectorSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** The zombie that is spawned when a wave doesn't have one. */
+	UPROPERTY(Config)
+	TSubclassOf<class AHMAICharacterBase> m_DefaultZombieClass;
+
+	/** How many zombies can be alive at once, the rest of the wave waits. */
+	UPROPERTY(Config)
+	int32 m_MaxAliveZombies;
+
+	/** The most zombies that are spawned in one frame. */
+	UPROPERTY(Config)
+	int32 m_MaxSpawnsPerFrame;
+
+	/** No more zombies are spawned in a frame once spawning took this long (ms). */
+	UPROPERTY(Config)
+	float m_SpawnBudgetMs;
+
+	/** Waves after the last row of the wave table have this many more zombies than the wave before. */
+	UPROPERTY(Config)
+	int32 m_ExtraZombiesPerWave;
+
+	/** Actors with this tag are spawn points. */
+	UPROPERTY(Config)
+	FName m_SpawnPointTag;
+
+	/** Without spawn points zombies spawn on the navmesh in this radius around a random player. */
+	UPROPERTY(Config)
+	float m_FallbackSpawnRadius;
+
+	bool m_bInitialized;
+
+	/** The current wave, 0 before the first one. */
+	int32 m_Wave;
+
+	/** The current wave's settings. */
+	TSubclassOf<class AHMAICharacterBase> m_WaveZombieClass;
+	int32 m_WaveNumZombies;
+
+	/** Zombies of the current wave that haven't been spawned yet. */
+	int32 m_ZombiesToSpawn;
+
+	/** Zombies of the current wave that haven't been killed yet (alive or not spawned). */
+	int32 m_ZombiesRemaining;
+
+	/** The world time the current intermission ends. */
+	float m_WaveStartTime;
+
+	/** The zombies that are alive. */
+	TArray<TWeakObjectPtr<class AHMAICharacterBase>> m_AliveZombies;
+
+	/** Spawn point transforms, gathered the first time a zombie is spawned. */
+	TArray<FTransform> m_SpawnPoints;
+	bool m_bGatheredSpawnPoints;
+	int32 m_NextSpawnPoint;
+
+	/** Totals for hm.SpawnDirector.Stats */
+	int32 m_TotalSpawned;
+	double m_TotalSpawnTime;
+	double m_MaxSpawnTime;
+
+	/** The spawn and garbage collection cost of one half of hm.SpawnDirector.Bench. */
+	struct FBenchmarkResult
+	{
+		int32 NumSpawned;
+		double SpawnTime;
+		int32 NumGarbageCollections;
+		double GarbageCollectionTime;
+
+		FBenchmarkResult() : NumSpawned(0), SpawnTime(0.0), NumGarbageCollections(0), GarbageCollectionTime(0.0) {}
+	};
+
+	/** Waves left in the current half of the benchmark, 0 if it isn't running. */
+	int32 m_BenchmarkWavesLeft;
+	int32 m_BenchmarkNumWaves;
+
+	/** Is the second (pooled) half of the benchmark running? */
+	bool m_bBenchmarkPooled;
+
+	/** Is the benchmark waiting for the garbage collection at the end of a wave? */
+	bool m_bBenchmarkWaitingForGarbageCollection;
+
+	/** [0] unpooled, [1] pooled */
+	FBenchmarkResult m_BenchmarkResults[2];
+
+	double m_GarbageCollectionStartTime;
+	FDelegateHandle m_PreGarbageCollectHandle;
+	FDelegateHandle m_PostGarbageCollectHandle;
+
+	/** Should zombies come from UHMZombiePoolSubsystem? */
+	bool ShouldUsePool() const;
+
+	/** Start the intermission before Wave. */
+	void StartIntermission(int32 Wave);
+
+	/** Start spawning the current wave. */
+	void StartWave();
+
+	/** Remove dead (or destroyed) zombies from m_AliveZombies and count them as killed. */
+	void UpdateAliveZombies();
+
+	/** Spawn as many zombies as the budgets allow this frame. */
+	void SpawnZombies();
+
+	/** Find where the next zombie should spawn. */
+	bool GetSpawnTransform(FTransform& OutTransform);
+
+	/** Spawn a single zombie, nullptr if it couldn't be spawned (blocked spawn point etc). */
+	class AHMAICharacterBase* SpawnZombie(TSubclassOf<class AHMAICharacterBase> ZombieClass, const FTransform& Transform);
+
+	/** Copy the wave state to the game state so it's replicated. */
+	void UpdateGameState(EWaveState State);
+
+	/** Kill every alive zombie and get rid of its corpse right away (benchmark only). */
+	void KillZombiesForBenchmark();
+
+	/** A wave of the benchmark was killed, collect its garbage. */
+	void OnBenchmarkWaveFinished();
+
+	/** Start the next wave/half of the benchmark or log the result. */
+	void AdvanceBenchmark();
+
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+
+public:
+
+	/** Log the spawn totals. */
+	void DumpStats() const;
+
+	/**
+	 * Run NumWaves waves without the zombie pool and then NumWaves waves with it, without intermissions and killing
+	 * every zombie as soon as it spawns, then log the spawn and garbage collection cost of both halves (server)
+	 *
+	 * @param int32 NumWaves How many waves each half runs
+	 */
+	void StartBenchmark(int32 NumWaves);
+
+	/** Get the current wave. */
+	FORCEINLINE int32 GetWave() const { return m_Wave; }
+
+	/** Get the number of zombies that are alive. */
+	FORCEINLINE int32 GetNumAliveZombies() const { return m_AliveZombies.Num(); }
+};
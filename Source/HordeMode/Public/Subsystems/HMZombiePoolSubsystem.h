@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Russ 'trdwll' Treadwell
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "HMZombiePoolSubsystem.generated.h"
+
+/** The zombies of one class. */
+USTRUCT()
+struct FHMZombiePool
+{
+	GENERATED_BODY()
+
+	/** Zombies that are deactivated and can be reused. */
+	UPROPERTY()
+	TArray<class AHMAICharacterBase*> Free;
+
+	/** How many zombies the pool spawned for this class (free, alive and corpses). */
+	int32 NumZombies;
+
+	FHMZombiePool() : NumZombies(0) {}
+};
+
+/**
+ * Keeps dead zombies around so the next wave can reuse them instead of spawning new actors
+ * (component registration, physics bodies and the AI controller) and leaving the old ones to the garbage collector.
+ *
+ * A dead pooled zombie ragdolls like any other for m_CorpseTime, then gets hidden and deactivated until the spawn director
+ * needs a zombie of its class. The pool is filled during the intermission (m_MaxPrewarmPerFrame zombies per frame).
+ * Server only, hm.ZombiePool 0 turns it off and hm.ZombiePool.Stats logs the counters.
+ */
+UCLASS(config = Game)
+class HORDEMODE_API UHMZombiePoolSubsystem final : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHMZombiePoolSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** FTickableGameObject */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+private:
+
+	/** How long a dead zombie ragdolls before it goes back to the pool. */
+	UPROPERTY(Config)
+	float m_CorpseTime;
+
+	/** The most zombies that are spawned in one frame to fill the pool. */
+	UPROPERTY(Config)
+	int32 m_MaxPrewarmPerFrame;
+
+	bool m_bInitialized;
+
+	UPROPERTY()
+	TMap<UClass*, FHMZombiePool> m_Pools;
+
+	/** Dead pooled zombies and the world time they go back to the pool. */
+	TArray<TWeakObjectPtr<class AHMAICharacterBase>> m_Corpses;
+	TArray<float> m_CorpseReleaseTimes;
+
+	/** The class/number of zombies the pool is being filled with. */
+	UPROPERTY()
+	TSubclassOf<class AHMAICharacterBase> m_PrewarmClass;
+	int32 m_PrewarmCount;
+
+	/** Pool counters */
+	int32 m_NumHits;
+	int32 m_NumMisses;
+	int32 m_NumReleased;
+
+	/** Spawn a zombie for the pool (deactivated). */
+	class AHMAICharacterBase* SpawnPooledZombie(TSubclassOf<class AHMAICharacterBase> ZombieClass, const FTransform& Transform, bool bDeactivate);
+
+public:
+
+	/** Get Is the pool used (hm.ZombiePool)? */
+	static bool IsEnabled();
+
+	/**
+	 * Get a zombie of ZombieClass at Transform, reuses a deactivated one if there is one
+	 *
+	 * @param TSubclassOf<AHMAICharacterBase> ZombieClass The class of the zombie
+	 * @param const FTransform& Transform Where the zombie should be
+	 * @return nullptr if there's no room at Transform
+	 */
+	class AHMAICharacterBase* AcquireZombie(TSubclassOf<class AHMAICharacterBase> ZombieClass, const FTransform& Transform);
+
+	/** Deactivate a pooled zombie and make it available again. */
+	void ReleaseZombie(class AHMAICharacterBase* Zombie);
+
+	/** Called by a pooled zombie that died, it goes back to the pool after m_CorpseTime. */
+	void OnZombieDied(class AHMAICharacterBase* Zombie);
+
+	/** Put every corpse back in the pool now. */
+	void ReleaseCorpses();
+
+	/** Fill the pool up to Count zombies of ZombieClass over the next frames. */
+	void Prewarm(TSubclassOf<class AHMAICharacterBase> ZombieClass, int32 Count);
+
+	/** Log the pool counters. */
+	void DumpStats() const;
+};